@@ -0,0 +1,305 @@
+// SPSCQueue benchmark: the cached-index queue in common/spsc_queue.hpp against
+// the previous implementation (kept below as LegacySPSCQueue), moving 128-byte
+// GrsRobotCommand frames between two threads.
+//
+//   ./spsc_queue_bench [items] [producer_cpu consumer_cpu]
+//
+// Throughput rows stream `items` frames producer -> consumer. Latency rows
+// bounce one frame back and forth over two queues and report the round trip.
+// Pin the threads to different physical cores for cross-core numbers; on a
+// single CPU the threads just take turns.
+
+#include <pthread.h>
+#include <sched.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "protocol.hpp"
+#include "spsc_queue.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+constexpr size_t QUEUE_SIZE = 128;  // as used by the bridge
+
+// The queue before cached indices / batching / in-place access
+template <typename T, size_t Size>
+class LegacySPSCQueue {
+public:
+    LegacySPSCQueue() : head(0), tail(0) { buffer.resize(Size); }
+
+    bool push(const T& data) {
+        size_t current_head = head.load(std::memory_order_relaxed);
+        size_t next_head = (current_head + 1) & (Size - 1);
+        if (next_head == tail.load(std::memory_order_acquire)) return false;
+        buffer[current_head] = data;
+        head.store(next_head, std::memory_order_release);
+        return true;
+    }
+
+    std::optional<T> pop() {
+        const size_t current_tail = tail.load(std::memory_order_relaxed);
+        if (current_tail == head.load(std::memory_order_acquire)) return std::nullopt;
+        T data = buffer[current_tail];
+        tail.store((current_tail + 1) & (Size - 1), std::memory_order_release);
+        return data;
+    }
+
+private:
+    std::vector<T> buffer;
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+};
+
+int g_cpu[2] = {-1, -1};
+
+void pin(int which) {
+    if (g_cpu[which] < 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(g_cpu[which], &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// Busy-wait, but let the other thread run when both share one CPU
+inline void backoff(unsigned& spins) {
+    if (++spins > 64) {
+        spins = 0;
+        std::this_thread::yield();
+    }
+}
+
+GrsRobotCommand frame(uint64_t id) {
+    GrsRobotCommand c{};
+    c.cmd_id = id;
+    c.cmd_type = GRS_CMD_LIN;
+    c.coords[0] = double(id);
+    return c;
+}
+
+struct Throughput {
+    double secs;
+    uint64_t checksum;
+};
+
+// Runs producer and consumer on their own threads; each gets the item count
+template <typename Producer, typename Consumer>
+Throughput runPair(size_t items, Producer producer, Consumer consumer) {
+    std::atomic<int> ready{0};
+    uint64_t sum = 0;
+    Clock::time_point t0;
+    std::thread cons([&] {
+        pin(1);
+        ready++;
+        while (ready < 2) {}
+        sum = consumer(items);
+    });
+    pin(0);
+    ready++;
+    while (ready < 2) {}
+    t0 = Clock::now();
+    producer(items);
+    cons.join();
+    return {std::chrono::duration<double>(Clock::now() - t0).count(), sum};
+}
+
+constexpr size_t BATCH = 16;
+
+Throughput legacyCopy(size_t items) {
+    auto q = std::make_unique<LegacySPSCQueue<GrsRobotCommand, QUEUE_SIZE>>();
+    return runPair(items,
+        [&](size_t n) {
+            unsigned spins = 0;
+            for (size_t i = 1; i <= n; i++) {
+                GrsRobotCommand c = frame(i);
+                while (!q->push(c)) backoff(spins);
+            }
+        },
+        [&](size_t n) {
+            uint64_t sum = 0;
+            unsigned spins = 0;
+            for (size_t got = 0; got < n;) {
+                if (auto c = q->pop()) { sum += c->cmd_id; got++; }
+                else backoff(spins);
+            }
+            return sum;
+        });
+}
+
+Throughput cachedCopy(size_t items) {
+    auto q = std::make_unique<SPSCQueue<GrsRobotCommand, QUEUE_SIZE>>();
+    return runPair(items,
+        [&](size_t n) {
+            unsigned spins = 0;
+            for (size_t i = 1; i <= n; i++) {
+                GrsRobotCommand c = frame(i);
+                while (!q->push(c)) backoff(spins);
+            }
+        },
+        [&](size_t n) {
+            uint64_t sum = 0;
+            unsigned spins = 0;
+            GrsRobotCommand c;
+            for (size_t got = 0; got < n;) {
+                if (q->pop(c)) { sum += c.cmd_id; got++; }
+                else backoff(spins);
+            }
+            return sum;
+        });
+}
+
+Throughput cachedInPlace(size_t items) {
+    auto q = std::make_unique<SPSCQueue<GrsRobotCommand, QUEUE_SIZE>>();
+    return runPair(items,
+        [&](size_t n) {
+            unsigned spins = 0;
+            for (size_t i = 1; i <= n; i++) {
+                GrsRobotCommand* slot;
+                while (!(slot = q->prepare_push())) backoff(spins);
+                *slot = GrsRobotCommand{};
+                slot->cmd_id = i;
+                slot->cmd_type = GRS_CMD_LIN;
+                slot->coords[0] = double(i);
+                q->commit_push();
+            }
+        },
+        [&](size_t n) {
+            uint64_t sum = 0;
+            unsigned spins = 0;
+            for (size_t got = 0; got < n;) {
+                if (const GrsRobotCommand* c = q->peek()) {
+                    sum += c->cmd_id;
+                    q->commit_pop();
+                    got++;
+                } else {
+                    backoff(spins);
+                }
+            }
+            return sum;
+        });
+}
+
+Throughput cachedBatch(size_t items) {
+    auto q = std::make_unique<SPSCQueue<GrsRobotCommand, QUEUE_SIZE>>();
+    return runPair(items,
+        [&](size_t n) {
+            GrsRobotCommand batch[BATCH];
+            unsigned spins = 0;
+            for (size_t i = 1; i <= n;) {
+                size_t len = std::min(BATCH, n - i + 1);
+                for (size_t k = 0; k < len; k++) batch[k] = frame(i + k);
+                size_t done = 0;
+                while (done < len) {
+                    size_t pushed = q->try_push_n(batch + done, len - done);
+                    if (pushed == 0) backoff(spins);
+                    done += pushed;
+                }
+                i += len;
+            }
+        },
+        [&](size_t n) {
+            GrsRobotCommand batch[BATCH];
+            uint64_t sum = 0;
+            unsigned spins = 0;
+            for (size_t got = 0; got < n;) {
+                size_t len = q->pop_n(batch, BATCH);
+                if (len == 0) { backoff(spins); continue; }
+                for (size_t k = 0; k < len; k++) sum += batch[k].cmd_id;
+                got += len;
+            }
+            return sum;
+        });
+}
+
+// Round trip of one frame: A -> B -> A, `rounds` times
+template <typename Queue, typename Push, typename Pop>
+std::vector<double> pingPong(size_t rounds, Push push, Pop pop) {
+    auto ping = std::make_unique<Queue>();
+    auto pong = std::make_unique<Queue>();
+    std::vector<double> ns(rounds);
+    std::thread echo([&] {
+        pin(1);
+        unsigned spins = 0;
+        GrsRobotCommand c;
+        for (size_t i = 0; i < rounds; i++) {
+            while (!pop(*ping, c)) backoff(spins);
+            while (!push(*pong, c)) backoff(spins);
+        }
+    });
+    pin(0);
+    unsigned spins = 0;
+    GrsRobotCommand c = frame(1);
+    for (size_t i = 0; i < rounds; i++) {
+        auto t0 = Clock::now();
+        while (!push(*ping, c)) backoff(spins);
+        while (!pop(*pong, c)) backoff(spins);
+        ns[i] = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+    }
+    echo.join();
+    std::sort(ns.begin(), ns.end());
+    return ns;
+}
+
+void printHeader() {
+    std::printf("%-34s %12s %14s %10s\n", "Benchmark", "Time/op", "items/s", "vs legacy");
+    std::printf("%s\n", std::string(74, '-').c_str());
+}
+
+void reportThroughput(const char* name, size_t items, Throughput r, double legacyRate) {
+    uint64_t expect = uint64_t(items) * (items + 1) / 2;
+    double rate = items / r.secs;
+    std::printf("%-34s %9.1f ns %12.2f M %9.2fx%s\n", name, r.secs * 1e9 / items, rate / 1e6,
+                legacyRate > 0 ? rate / legacyRate : 1.0, r.checksum == expect ? "" : "  CHECKSUM MISMATCH");
+}
+
+void reportLatency(const char* name, const std::vector<double>& ns) {
+    auto at = [&](double p) { return ns[std::min(ns.size() - 1, size_t(p / 100.0 * ns.size()))]; };
+    std::printf("%-34s p50 %7.0f ns  p99 %7.0f ns  p99.9 %7.0f ns  max %8.0f ns\n",
+                name, at(50), at(99), at(99.9), ns.back());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t items = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 5000000;
+    if (argc > 3) {
+        g_cpu[0] = std::atoi(argv[2]);
+        g_cpu[1] = std::atoi(argv[3]);
+    }
+    size_t rounds = std::max<size_t>(items / 50, 1000);
+
+    std::printf("%zu x %zu-byte frames, queue size %zu, %u CPU(s), ",
+                items, sizeof(GrsRobotCommand), QUEUE_SIZE, std::thread::hardware_concurrency());
+    if (g_cpu[0] >= 0) std::printf("producer on CPU %d, consumer on CPU %d\n\n", g_cpu[0], g_cpu[1]);
+    else std::printf("threads not pinned\n\n");
+
+    printHeader();
+    Throughput legacy = legacyCopy(items);
+    double legacyRate = items / legacy.secs;
+    reportThroughput("legacy   push/pop (optional)", items, legacy, 0);
+    reportThroughput("cached   push/pop(T&)", items, cachedCopy(items), legacyRate);
+    reportThroughput("cached   prepare_push/peek", items, cachedInPlace(items), legacyRate);
+    reportThroughput("cached   try_push_n/pop_n x16", items, cachedBatch(items), legacyRate);
+
+    std::printf("\nRound trip, one frame in flight (%zu rounds)\n", rounds);
+    using Legacy = LegacySPSCQueue<GrsRobotCommand, QUEUE_SIZE>;
+    using Cached = SPSCQueue<GrsRobotCommand, QUEUE_SIZE>;
+    reportLatency("legacy", pingPong<Legacy>(rounds,
+        [](Legacy& q, const GrsRobotCommand& c) { return q.push(c); },
+        [](Legacy& q, GrsRobotCommand& c) {
+            auto v = q.pop();
+            if (v) c = *v;
+            return v.has_value();
+        }));
+    reportLatency("cached", pingPong<Cached>(rounds,
+        [](Cached& q, const GrsRobotCommand& c) { return q.push(c); },
+        [](Cached& q, GrsRobotCommand& c) { return q.pop(c); }));
+    return 0;
+}
@@ -0,0 +1,169 @@
+// Wire format benchmark: bytes/frame and frames/sec for the fixed 128-byte
+// structs versus the compact v1 encoding (see common/wire_codec.hpp).
+//
+//   ./wire_codec_bench [frames]
+//
+// "codec" measures encode+decode in memory, "stream" pushes the encoded frames
+// through a local socketpair and reassembles them on the other side, the way
+// network_server_func and TcpIOProvider do.
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "protocol.hpp"
+#include "wire_codec.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Typical interpreter traffic: I/O, waits, cartesian and axis motions
+std::vector<GrsRobotCommand> makeCommands(size_t n) {
+    std::vector<GrsRobotCommand> out(n);
+    for (size_t i = 0; i < n; i++) {
+        GrsRobotCommand& c = out[i];
+        c.cmd_id = i + 1;
+        switch (i % 4) {
+            case 0: c.cmd_type = GRS_CMD_OUTPUT; c.io_index = i % 8; c.io_value = i & 1; break;
+            case 1: c.cmd_type = GRS_CMD_WAIT; c.wait_time = 250.0; break;
+            case 2: c.cmd_type = GRS_CMD_LIN;
+                    c.coords[0] = 500.0 + i; c.coords[1] = 20.5; c.coords[2] = 600.0; break;
+            case 3: c.cmd_type = GRS_CMD_PTP;
+                    for (int k = 0; k < 6; k++) c.axes[k] = 10.0 * (k + 1);
+                    break;
+        }
+    }
+    return out;
+}
+
+// Bridge state stream: I/O only (poses zeroed) and with full poses published
+std::vector<GrsRobotState> makeStates(size_t n, bool withPose) {
+    std::vector<GrsRobotState> out(n);
+    for (size_t i = 0; i < n; i++) {
+        GrsRobotState& s = out[i];
+        s.frame_seq = static_cast<uint32_t>(i + 1);
+        s.seq_id = i / 10;
+        s.inputs = 0x01;
+        s.system_ready = 1;
+        if (withPose) {
+            for (int k = 0; k < 6; k++) {
+                s.current_pos[k] = 100.0 + k + i * 0.001;
+                s.current_axes[k] = 5.0 * k + i * 0.001;
+            }
+        }
+    }
+    return out;
+}
+
+struct Result {
+    double bytesPerFrame;
+    double framesPerSec;
+};
+
+template <typename T, typename Enc, typename Dec>
+Result runCodec(const std::vector<T>& frames, uint8_t format, Enc enc, Dec dec) {
+    std::vector<uint8_t> buf(frames.size() * grs_wire::MAX_FRAME);
+    auto t0 = Clock::now();
+    size_t len = 0;
+    for (const auto& f : frames) len += enc(f, format, buf.data() + len);
+    size_t off = 0, count = 0;
+    T out;
+    while (off < len) {
+        size_t used = dec(buf.data() + off, len - off, format, out);
+        if (used == 0 || used == grs_wire::BAD_FRAME) break;
+        off += used;
+        count++;
+    }
+    double secs = std::chrono::duration<double>(Clock::now() - t0).count();
+    if (count != frames.size()) std::fprintf(stderr, "decode mismatch: %zu/%zu\n", count, frames.size());
+    return {double(len) / frames.size(), frames.size() / secs};
+}
+
+// Encoded frames are written in 4 KiB batches and reassembled on the reader side
+template <typename T, typename Enc, typename Dec>
+Result runStream(const std::vector<T>& frames, uint8_t format, Enc enc, Dec dec) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) return {0, 0};
+
+    size_t total = 0;
+    auto t0 = Clock::now();
+    std::thread writer([&] {
+        uint8_t batch[4096];
+        size_t len = 0;
+        for (const auto& f : frames) {
+            if (len + grs_wire::MAX_FRAME > sizeof(batch)) {
+                if (write(sv[0], batch, len) < 0) break;
+                len = 0;
+            }
+            size_t n = enc(f, format, batch + len);
+            len += n;
+            total += n;
+        }
+        if (len && write(sv[0], batch, len) < 0) return;
+        shutdown(sv[0], SHUT_WR);
+    });
+
+    uint8_t rx[8192];
+    size_t rxLen = 0, count = 0;
+    T out;
+    for (;;) {
+        ssize_t n = read(sv[1], rx + rxLen, sizeof(rx) - rxLen);
+        if (n <= 0) break;
+        rxLen += n;
+        size_t off = 0, used;
+        while ((used = dec(rx + off, rxLen - off, format, out)) != 0 && used != grs_wire::BAD_FRAME) {
+            off += used;
+            count++;
+        }
+        std::memmove(rx, rx + off, rxLen - off);
+        rxLen -= off;
+    }
+    writer.join();
+    double secs = std::chrono::duration<double>(Clock::now() - t0).count();
+    close(sv[0]);
+    close(sv[1]);
+    if (count != frames.size()) std::fprintf(stderr, "stream mismatch: %zu/%zu\n", count, frames.size());
+    return {double(total) / frames.size(), frames.size() / secs};
+}
+
+void report(const char* name, Result fixed, Result compact) {
+    std::printf("%-22s %8.1f B %10.2f M/s   %8.1f B %10.2f M/s   %5.1fx smaller\n",
+                name, fixed.bytesPerFrame, fixed.framesPerSec / 1e6,
+                compact.bytesPerFrame, compact.framesPerSec / 1e6,
+                fixed.bytesPerFrame / compact.bytesPerFrame);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t n = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+    auto cmds = makeCommands(n);
+    auto states = makeStates(n, false);
+    auto posed = makeStates(n, true);
+
+    auto encC = [](const GrsRobotCommand& c, uint8_t f, uint8_t* p) { return grs_wire::encodeCommand(c, f, p); };
+    auto decC = [](const uint8_t* p, size_t len, uint8_t f, GrsRobotCommand& c) { return grs_wire::decodeCommand(p, len, f, c); };
+    auto encS = [](const GrsRobotState& s, uint8_t f, uint8_t* p) { return grs_wire::encodeState(s, f, p); };
+    auto decS = [](const uint8_t* p, size_t len, uint8_t f, GrsRobotState& s) { return grs_wire::decodeState(p, len, f, s); };
+
+    std::printf("%zu frames per run\n\n", n);
+    std::printf("%-22s %-25s   %-25s\n", "", "fixed 128-byte", "compact v1");
+
+    report("codec  command mix", runCodec(cmds, grs_wire::WIRE_FIXED, encC, decC),
+                                 runCodec(cmds, grs_wire::WIRE_COMPACT, encC, decC));
+    report("codec  state (I/O)", runCodec(states, grs_wire::WIRE_FIXED, encS, decS),
+                                 runCodec(states, grs_wire::WIRE_COMPACT, encS, decS));
+    report("codec  state (poses)", runCodec(posed, grs_wire::WIRE_FIXED, encS, decS),
+                                   runCodec(posed, grs_wire::WIRE_COMPACT, encS, decS));
+    report("stream command mix", runStream(cmds, grs_wire::WIRE_FIXED, encC, decC),
+                                 runStream(cmds, grs_wire::WIRE_COMPACT, encC, decC));
+    report("stream state (I/O)", runStream(states, grs_wire::WIRE_FIXED, encS, decS),
+                                 runStream(states, grs_wire::WIRE_COMPACT, encS, decS));
+    return 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cstdint>
+
+// Wakeup counter between the RT thread and the network thread's epoll loop.
+// notify() is a single non-blocking write(), safe to call every RT cycle.
+class EventFd {
+public:
+    EventFd() : fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {}
+    ~EventFd() { if (fd_ >= 0) close(fd_); }
+
+    EventFd(const EventFd&) = delete;
+    EventFd& operator=(const EventFd&) = delete;
+
+    int fd() const { return fd_; }
+
+    // Producer side
+    void notify() {
+        uint64_t one = 1;
+        ssize_t r = write(fd_, &one, sizeof(one));
+        (void)r;  // EAGAIN only when the counter is saturated — still readable
+    }
+
+    // Consumer side: clears the counter, returns how many notifies it held
+    uint64_t drain() {
+        uint64_t count = 0;
+        if (read(fd_, &count, sizeof(count)) != sizeof(count)) return 0;
+        return count;
+    }
+
+private:
+    int fd_;
+};
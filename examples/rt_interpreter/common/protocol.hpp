@@ -27,6 +27,31 @@ enum GrsCommandType : uint8_t {
     GRS_CMD_SET_ALL_OUTPUTS = 11,
 };
 
+// GrsRobotCommand::flags
+enum GrsCommandFlags : uint8_t {
+    GRS_CMD_FLAG_RESEND = 0x01,  // retransmission of an already sent cmd_id (drop if seen)
+    GRS_CMD_FLAG_HELLO  = 0x02,  // new client session, resets duplicate detection (NOP only);
+                                 // UDP: cmd_id = id before the first command, 0 if unknown
+    GRS_CMD_FLAG_FORMAT = 0x04,  // wire format request in io_value (NOP only, see wire_codec.hpp)
+    GRS_CMD_FLAG_SUBSCRIBE = 0x08,  // state-only session, never gets the command lease;
+                                    // wait_time = min. ms between state frames, 0 = all (NOP only)
+};
+
+// GrsRobotState::cmd_status, the bridge's command sequencer as of done_cmd_id
+enum GrsCommandStatus : uint8_t {
+    GRS_STATUS_IDLE      = 0,  // nothing accepted yet
+    GRS_STATUS_EXECUTING = 1,  // seq_id accepted, not finished (done_cmd_id < seq_id)
+    GRS_STATUS_DONE      = 2,  // everything accepted has finished
+    GRS_STATUS_ERROR     = 3,  // done_cmd_id failed (rejected, or motion aborted by EMG),
+                               // along with failed_count - 1 ids before it;
+                               // shown until the next command finishes
+};
+
+// GrsRobotState::link_flags
+enum GrsLinkFlags : uint8_t {
+    GRS_LINK_LEASE = 0x01,  // this connection holds the command lease (its commands are executed)
+};
+
 // Human-readable command type names for logging
 inline std::string grsCommandTypeName(uint8_t type) {
     static std::string names[] = {
@@ -47,11 +72,13 @@ struct GrsRobotCommand {
     uint8_t  io_value;         // 1   - I/O value (0 or 1)
     uint8_t  set_outputs;      // 1   - full output byte (for SET_ALL_OUTPUTS)
     uint8_t  soft_stops;       // 1   - soft emergency stop
-    uint8_t  reserved[3];      // 3   - future use
+    uint8_t  flags;            // 1   - GrsCommandFlags
+    uint8_t  reserved[2];      // 2   - future use
     double   wait_time;        // 8   - wait duration in ms (for WAIT)
     double   coords[6];        // 48  - x,y,z,a,b,c (for PTP/LIN/CIRC)
-    double   axes[6];          // 48  - A1,A2,A3,A4,A5,A6 (for axis commands)
-    uint8_t  padding[8];       // 8   - alignment to 128 bytes
+    double   axes[6];          // 48  - A1,A2,A3,A4,A5,A6 (for axis commands); CIRC: aux point x,y,z
+    uint64_t session;          // 8   - TCP hello/resume: the client's session token, echoed by
+                               //       every resume so the bridge keeps its lease (NOP only)
 };
 // sizeof(GrsRobotCommand) = 128
 
@@ -60,17 +87,21 @@ struct GrsRobotCommand {
 // Total: 128 bytes
 struct GrsRobotState {
     uint64_t seq_id;           // 8   - senkronizasyon ID
-    uint32_t timestamp;        // 4   - zaman damgası (ms)
+    uint32_t failed_count;     // 4   - with GRS_STATUS_ERROR: ids done_cmd_id - failed_count + 1
+                               //       .. done_cmd_id failed (EMG: the motion in progress and
+                               //       every one queued behind it), 0 otherwise
     uint8_t  inputs;           // 1   - digital input byte (EL1008)
     uint8_t  outputs;          // 1   - digital output byte (EL2008)
     uint8_t  is_hardware_emg;  // 1   - hardware emergency stop
     uint8_t  system_ready;     // 1   - system ready flag
     uint8_t  cmd_ack;          // 1   - last acknowledged cmd_type
-    uint8_t  cmd_status;       // 1   - 0=idle, 1=executing, 2=done, 3=error
-    uint8_t  reserved[2];      // 2   - future use
-    double   current_pos[6];   // 48  - current x,y,z,a,b,c
-    double   current_axes[6];  // 48  - current A1,A2,A3,A4,A5,A6
-    uint8_t  padding[12];      // 12  - alignment to 128 bytes
+    uint8_t  cmd_status;       // 1   - GrsCommandStatus
+    uint8_t  wire_format;      // 1   - format handshake reply (see wire_codec.hpp)
+    uint8_t  link_flags;       // 1   - GrsLinkFlags, set per connection by the bridge
+    double   current_pos[6];   // 48  - interpolated setpoint x,y,z,a,b,c
+    double   current_axes[6];  // 48  - interpolated setpoint A1,A2,A3,A4,A5,A6
+    uint32_t frame_seq;        // 4   - monotonic frame counter (stale-frame dropping over UDP)
+    uint64_t done_cmd_id;      // 8   - last cmd_id the RT loop finished executing
 };
 // sizeof(GrsRobotState) = 128
 
@@ -1,47 +1,149 @@
 #pragma once
 #include <atomic>
-#include <vector>
+#include <array>
+#include <cstddef>
+#include <new>
 #include <optional>
+#include <type_traits>
+#include <utility>
 
+// Wait-free single-producer / single-consumer ring (Size - 1 usable slots).
+//
+// Each side keeps a private copy of the other side's index and only reloads the
+// shared atomic when that copy says full/empty, so a steady stream costs one
+// cache-line transfer per batch instead of one per element. Indices and the
+// inline buffer live on separate cache lines.
+//
+// Besides copying push()/pop() there are batch calls (try_push_n/pop_n) that
+// publish many elements with one release store, and in-place access for large
+// frames: prepare_push()/commit_push() and emplace() on the producer side,
+// peek()/commit_pop() on the consumer side.
 template <typename T, size_t Size>
 class SPSCQueue {
 public:
     static_assert((Size & (Size - 1)) == 0, "for masking speed)");
+    static_assert(Size >= 2, "one slot is always kept free");
 
-    SPSCQueue() : head(0), tail(0) {
-        buffer.resize(Size);
-    }
+    static constexpr size_t capacity() { return Size - 1; }
+
+    // ── Producer ──────────────────────────────────────────────
 
-    // Producer
     bool push(const T& data) {
-        size_t current_head = head.load(std::memory_order_relaxed);
-        size_t next_head = (current_head + 1) & (Size - 1);
+        T* slot = prepare_push();
+        if (!slot) return false;
+        *slot = data;
+        commit_push();
+        return true;
+    }
 
-        if (next_head == tail.load(std::memory_order_acquire)) {
-            return false; 
+    // Constructs the element in its slot
+    template <typename... Args>
+    bool emplace(Args&&... args) {
+        T* slot = prepare_push();
+        if (!slot) return false;
+        if constexpr (std::is_trivially_destructible<T>::value) {
+            new (slot) T{std::forward<Args>(args)...};
+        } else {
+            *slot = T{std::forward<Args>(args)...};
         }
-
-        buffer[current_head] = data;
-        head.store(next_head, std::memory_order_release);
+        commit_push();
         return true;
     }
 
-    // Consumer 
-    std::optional<T> pop() {
-       const size_t current_tail = tail.load(std::memory_order_relaxed);
+    // Free slot to fill in place, nullptr if full. Nothing is visible to the
+    // consumer until commit_push().
+    T* prepare_push() {
+        const size_t current_head = head.load(std::memory_order_relaxed);
+        const size_t next_head = (current_head + 1) & (Size - 1);
+        if (next_head == tail_cache) {
+            tail_cache = tail.load(std::memory_order_acquire);
+            if (next_head == tail_cache) return nullptr;
+        }
+        return &buffer[current_head];
+    }
 
-        if (current_tail == head.load(std::memory_order_acquire)) {
-            return std::nullopt; 
+    void commit_push() {
+        head.store((head.load(std::memory_order_relaxed) + 1) & (Size - 1),
+                   std::memory_order_release);
+    }
+
+    // Pushes as many of the n items as fit, returns how many
+    size_t try_push_n(const T* items, size_t n) {
+        const size_t current_head = head.load(std::memory_order_relaxed);
+        size_t room = free_slots(current_head, tail_cache);
+        if (room < n) {
+            tail_cache = tail.load(std::memory_order_acquire);
+            room = free_slots(current_head, tail_cache);
         }
+        const size_t count = n < room ? n : room;
+        for (size_t i = 0; i < count; i++) {
+            buffer[(current_head + i) & (Size - 1)] = items[i];
+        }
+        if (count) head.store((current_head + count) & (Size - 1), std::memory_order_release);
+        return count;
+    }
 
-        T data = buffer[current_tail];
-        tail.store((current_tail + 1) & (Size - 1), std::memory_order_release);
+    // ── Consumer ──────────────────────────────────────────────
+
+    std::optional<T> pop() {
+        const T* front = peek();
+        if (!front) return std::nullopt;
+        std::optional<T> data(*front);
+        commit_pop();
         return data;
     }
 
+    bool pop(T& out) {
+        const T* front = peek();
+        if (!front) return false;
+        out = *front;
+        commit_pop();
+        return true;
+    }
+
+    // Oldest element, nullptr if empty. Stays owned by the queue until commit_pop().
+    T* peek() {
+        const size_t current_tail = tail.load(std::memory_order_relaxed);
+        if (current_tail == head_cache) {
+            head_cache = head.load(std::memory_order_acquire);
+            if (current_tail == head_cache) return nullptr;
+        }
+        return &buffer[current_tail];
+    }
+
+    void commit_pop() {
+        tail.store((tail.load(std::memory_order_relaxed) + 1) & (Size - 1),
+                   std::memory_order_release);
+    }
+
+    // Pops up to max elements into out, returns how many
+    size_t pop_n(T* out, size_t max) {
+        const size_t current_tail = tail.load(std::memory_order_relaxed);
+        size_t avail = (head_cache - current_tail) & (Size - 1);
+        if (avail < max) {
+            head_cache = head.load(std::memory_order_acquire);
+            avail = (head_cache - current_tail) & (Size - 1);
+        }
+        const size_t count = max < avail ? max : avail;
+        for (size_t i = 0; i < count; i++) {
+            out[i] = buffer[(current_tail + i) & (Size - 1)];
+        }
+        if (count) tail.store((current_tail + count) & (Size - 1), std::memory_order_release);
+        return count;
+    }
+
 private:
-    std::vector<T> buffer;
+    static size_t free_slots(size_t h, size_t t) {
+        return (t - h - 1) & (Size - 1);
+    }
+
+    // Producer line: head plus its private copy of tail
+    alignas(64) std::atomic<size_t> head{0};
+    size_t tail_cache = 0;
+
+    // Consumer line: tail plus its private copy of head
+    alignas(64) std::atomic<size_t> tail{0};
+    size_t head_cache = 0;
 
-    alignas(64) std::atomic<size_t> head;
-    alignas(64) std::atomic<size_t> tail;
+    alignas(64) std::array<T, Size> buffer{};
 };
@@ -0,0 +1,266 @@
+#ifndef WIRE_CODEC_HPP
+#define WIRE_CODEC_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include "protocol.hpp"
+
+// ═══════════════════════════════════════════════════════════════
+// Wire formats for GrsRobotCommand / GrsRobotState
+//
+// WIRE_FIXED   — the 128-byte packed structs, byte for byte (fallback)
+// WIRE_COMPACT — variable length, v1:
+//
+//   frame   := len:u8  body[len]
+//   body    := kind:u8 ...
+//   command := 0x01  cmd_id:varint  cmd_type:u8  ctl:u8  payload
+//              ctl bit0-5 = flags, bit7 = soft_stops
+//              payload: OUTPUT          io_index:u8 io_value:u8
+//                       SET_ALL_OUTPUTS set_outputs:u8
+//                       WAIT            wait_time:f64
+//                       PTP..SPLINE_REL pose
+//                       NOP             (empty)
+//   state   := 0x02  frame_seq:varint  seq_id:varint  done_lag:varint  failed_count:varint
+//              inputs:u8 outputs:u8 status:u8 cmd_ack:u8 cmd_status:u8 pose
+//              done_lag = seq_id - done_cmd_id (commands accepted but not finished)
+//              status bit0 = is_hardware_emg, bit1 = system_ready, bit2 = link lease
+//   pose    := mask:u16  f64 for every set bit
+//              bit0-5 = coords x..c, bit6-11 = axes A1..A6; zero fields are omitted
+//
+// varint is unsigned LEB128, all fixed-width fields are little endian
+// (same host-order assumption as the packed structs).
+//
+// Negotiation happens in WIRE_FIXED: the client sends a NOP with
+// GRS_CMD_FLAG_FORMAT and io_value = requested format; the server answers with
+// one fixed state frame whose wire_format = WIRE_REPLY | accepted format and
+// switches that connection to it. Everything after the reply uses the new format.
+// ═══════════════════════════════════════════════════════════════
+
+namespace grs_wire {
+
+constexpr uint8_t WIRE_FIXED   = 0;
+constexpr uint8_t WIRE_COMPACT = 1;
+constexpr uint8_t WIRE_REPLY   = 0x80;
+
+constexpr uint8_t KIND_COMMAND = 0x01;
+constexpr uint8_t KIND_STATE   = 0x02;
+
+// Largest encoded frame in any format (fixed structs are the upper bound)
+constexpr size_t MAX_FRAME = sizeof(GrsRobotCommand);
+static_assert(sizeof(GrsRobotCommand) == 128 && sizeof(GrsRobotState) == 128,
+              "wire structs must stay 128 bytes");
+
+// Returned by decode* for a frame that can never become valid
+constexpr size_t BAD_FRAME = static_cast<size_t>(-1);
+
+inline size_t putVarint(uint8_t* p, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = static_cast<uint8_t>(v) | 0x80;
+        v >>= 7;
+    }
+    p[n++] = static_cast<uint8_t>(v);
+    return n;
+}
+
+// Returns bytes consumed, 0 when the buffer ends early or the value overflows
+inline size_t getVarint(const uint8_t* p, size_t n, uint64_t& v) {
+    v = 0;
+    for (size_t i = 0; i < n && i < 10; i++) {
+        v |= static_cast<uint64_t>(p[i] & 0x7F) << (7 * i);
+        if (!(p[i] & 0x80)) return i + 1;
+    }
+    return 0;
+}
+
+template <typename T>
+inline size_t putRaw(uint8_t* p, T v) {
+    std::memcpy(p, &v, sizeof(T));
+    return sizeof(T);
+}
+
+template <typename T>
+inline T getRaw(const uint8_t* p) {
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+inline size_t putPose(uint8_t* p, const double coords[6], const double axes[6]) {
+    uint16_t mask = 0;
+    size_t n = sizeof(uint16_t);
+    for (int i = 0; i < 6; i++) {
+        if (coords[i] != 0.0) { mask |= 1u << i;       n += putRaw(p + n, coords[i]); }
+    }
+    for (int i = 0; i < 6; i++) {
+        if (axes[i] != 0.0)   { mask |= 1u << (6 + i); n += putRaw(p + n, axes[i]); }
+    }
+    putRaw(p, mask);
+    return n;
+}
+
+// Returns bytes consumed, BAD_FRAME if the pose runs past the end
+inline size_t getPose(const uint8_t* p, size_t n, double coords[6], double axes[6]) {
+    if (n < sizeof(uint16_t)) return BAD_FRAME;
+    uint16_t mask = getRaw<uint16_t>(p);
+    size_t off = sizeof(uint16_t);
+    for (int i = 0; i < 12; i++) {
+        double& dst = (i < 6) ? coords[i] : axes[i - 6];
+        if (!(mask & (1u << i))) { dst = 0.0; continue; }
+        if (off + sizeof(double) > n) return BAD_FRAME;
+        dst = getRaw<double>(p + off);
+        off += sizeof(double);
+    }
+    return off;
+}
+
+inline bool isMotion(uint8_t type) {
+    return type >= GRS_CMD_PTP && type <= GRS_CMD_SPLINE_REL;
+}
+
+// Encodes one frame into out (at least MAX_FRAME bytes), returns its size
+inline size_t encodeCommand(const GrsRobotCommand& cmd, uint8_t format, uint8_t* out) {
+    if (format != WIRE_COMPACT) {
+        std::memcpy(out, &cmd, sizeof(cmd));
+        return sizeof(cmd);
+    }
+
+    size_t n = 1;  // length byte written last
+    out[n++] = KIND_COMMAND;
+    n += putVarint(out + n, cmd.cmd_id);
+    out[n++] = cmd.cmd_type;
+    out[n++] = static_cast<uint8_t>((cmd.flags & 0x3F) | (cmd.soft_stops ? 0x80 : 0));
+
+    if (cmd.cmd_type == GRS_CMD_OUTPUT) {
+        out[n++] = cmd.io_index;
+        out[n++] = cmd.io_value;
+    } else if (cmd.cmd_type == GRS_CMD_SET_ALL_OUTPUTS) {
+        out[n++] = cmd.set_outputs;
+    } else if (cmd.cmd_type == GRS_CMD_WAIT) {
+        n += putRaw(out + n, cmd.wait_time);
+    } else if (isMotion(cmd.cmd_type)) {
+        n += putPose(out + n, cmd.coords, cmd.axes);
+    }
+
+    out[0] = static_cast<uint8_t>(n - 1);
+    return n;
+}
+
+// Returns bytes consumed, 0 if more data is needed, BAD_FRAME if malformed
+inline size_t decodeCommand(const uint8_t* p, size_t n, uint8_t format, GrsRobotCommand& cmd) {
+    if (format != WIRE_COMPACT) {
+        if (n < sizeof(cmd)) return 0;
+        std::memcpy(&cmd, p, sizeof(cmd));
+        return sizeof(cmd);
+    }
+
+    if (n < 1 || n < 1u + p[0]) return 0;
+    const size_t frame = 1u + p[0];
+    const uint8_t* b = p + 1;
+    const size_t len = p[0];
+
+    if (len < 1 || b[0] != KIND_COMMAND) return BAD_FRAME;
+    cmd = GrsRobotCommand{};
+    size_t off = 1;
+    uint64_t id = 0;  // no reference binding to packed members
+    size_t v = getVarint(b + off, len - off, id);
+    if (v == 0) return BAD_FRAME;
+    cmd.cmd_id = id;
+    off += v;
+    if (off + 2 > len) return BAD_FRAME;
+    cmd.cmd_type = b[off++];
+    cmd.flags = b[off] & 0x3F;
+    cmd.soft_stops = (b[off++] & 0x80) ? 1 : 0;
+
+    if (cmd.cmd_type == GRS_CMD_OUTPUT) {
+        if (off + 2 > len) return BAD_FRAME;
+        cmd.io_index = b[off++];
+        cmd.io_value = b[off++];
+    } else if (cmd.cmd_type == GRS_CMD_SET_ALL_OUTPUTS) {
+        if (off + 1 > len) return BAD_FRAME;
+        cmd.set_outputs = b[off++];
+    } else if (cmd.cmd_type == GRS_CMD_WAIT) {
+        if (off + sizeof(double) > len) return BAD_FRAME;
+        cmd.wait_time = getRaw<double>(b + off);
+        off += sizeof(double);
+    } else if (isMotion(cmd.cmd_type)) {
+        size_t used = getPose(b + off, len - off, cmd.coords, cmd.axes);
+        if (used == BAD_FRAME) return BAD_FRAME;
+        off += used;
+    }
+    return frame;
+}
+
+inline size_t encodeState(const GrsRobotState& st, uint8_t format, uint8_t* out) {
+    if (format != WIRE_COMPACT) {
+        std::memcpy(out, &st, sizeof(st));
+        return sizeof(st);
+    }
+
+    size_t n = 1;
+    out[n++] = KIND_STATE;
+    n += putVarint(out + n, st.frame_seq);
+    n += putVarint(out + n, st.seq_id);
+    n += putVarint(out + n, st.seq_id >= st.done_cmd_id ? st.seq_id - st.done_cmd_id : 0);
+    n += putVarint(out + n, st.failed_count);
+    out[n++] = st.inputs;
+    out[n++] = st.outputs;
+    out[n++] = static_cast<uint8_t>((st.is_hardware_emg ? 0x01 : 0) | (st.system_ready ? 0x02 : 0) |
+                                     ((st.link_flags & GRS_LINK_LEASE) ? 0x04 : 0));
+    out[n++] = st.cmd_ack;
+    out[n++] = st.cmd_status;
+    n += putPose(out + n, st.current_pos, st.current_axes);
+
+    out[0] = static_cast<uint8_t>(n - 1);
+    return n;
+}
+
+inline size_t decodeState(const uint8_t* p, size_t n, uint8_t format, GrsRobotState& st) {
+    if (format != WIRE_COMPACT) {
+        if (n < sizeof(st)) return 0;
+        std::memcpy(&st, p, sizeof(st));
+        return sizeof(st);
+    }
+
+    if (n < 1 || n < 1u + p[0]) return 0;
+    const size_t frame = 1u + p[0];
+    const uint8_t* b = p + 1;
+    const size_t len = p[0];
+
+    if (len < 1 || b[0] != KIND_STATE) return BAD_FRAME;
+    st = GrsRobotState{};
+    size_t off = 1;
+    uint64_t v64 = 0;
+    size_t v = getVarint(b + off, len - off, v64);
+    if (v == 0) return BAD_FRAME;
+    st.frame_seq = static_cast<uint32_t>(v64);
+    off += v;
+    v = getVarint(b + off, len - off, v64);
+    if (v == 0) return BAD_FRAME;
+    st.seq_id = v64;
+    off += v;
+    v = getVarint(b + off, len - off, v64);
+    if (v == 0 || v64 > st.seq_id) return BAD_FRAME;
+    st.done_cmd_id = st.seq_id - v64;
+    off += v;
+    v = getVarint(b + off, len - off, v64);
+    if (v == 0 || v64 > UINT32_MAX) return BAD_FRAME;
+    st.failed_count = static_cast<uint32_t>(v64);
+    off += v;
+    if (off + 5 > len) return BAD_FRAME;
+    st.inputs = b[off++];
+    st.outputs = b[off++];
+    st.is_hardware_emg = (b[off] & 0x01) ? 1 : 0;
+    st.system_ready = (b[off] & 0x02) ? 1 : 0;
+    st.link_flags = (b[off++] & 0x04) ? GRS_LINK_LEASE : 0;
+    st.cmd_ack = b[off++];
+    st.cmd_status = b[off++];
+    size_t used = getPose(b + off, len - off, st.current_pos, st.current_axes);
+    if (used == BAD_FRAME) return BAD_FRAME;
+    return frame;
+}
+
+} // namespace grs_wire
+
+#endif // WIRE_CODEC_HPP
@@ -0,0 +1,126 @@
+#ifndef CYCLE_STATS_HPP_
+#define CYCLE_STATS_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+
+// Timing of the RT cycle, recorded by the RT thread itself.
+// The RT thread is the only writer: plain relaxed load+store, no read-modify-write,
+// no locks. Any other thread may read the counters at any time; a snapshot taken
+// while the loop runs can be off by the cycle being recorded, never torn.
+
+// 1 µs linear buckets up to MAX_US, everything above lands in the last one
+class CycleHistogram {
+public:
+    static constexpr uint64_t MAX_US = 4000;
+
+    // RT side
+    void record(uint64_t ns) {
+        uint64_t us = ns / 1000;
+        size_t b = us < MAX_US ? static_cast<size_t>(us) : MAX_US;
+        bump(counts_[b], 1);
+        bump(total_, 1);
+        bump(sum_ns_, ns);
+        if (ns > max_ns_.load(std::memory_order_relaxed)) max_ns_.store(ns, std::memory_order_relaxed);
+    }
+
+    // Reader side
+    uint64_t count() const { return total_.load(std::memory_order_relaxed); }
+    uint64_t maxNs() const { return max_ns_.load(std::memory_order_relaxed); }
+    double meanUs() const {
+        uint64_t n = count();
+        return n ? sum_ns_.load(std::memory_order_relaxed) / 1000.0 / n : 0.0;
+    }
+
+    // Upper edge in µs of the bucket holding percentile p (0..100)
+    uint64_t percentileUs(double p) const {
+        uint64_t n = count();
+        if (n == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * n + 0.5);
+        if (rank < 1) rank = 1;
+        uint64_t seen = 0;
+        for (size_t b = 0; b <= MAX_US; b++) {
+            seen += counts_[b].load(std::memory_order_relaxed);
+            if (seen >= rank) return b < MAX_US ? b + 1 : maxNs() / 1000;
+        }
+        return maxNs() / 1000;
+    }
+
+    void print(std::ostream& os, const char* name) const {
+        os << "  " << std::left << std::setw(16) << name << std::right
+           << " mean " << std::fixed << std::setprecision(1) << std::setw(7) << meanUs()
+           << "  p50 " << std::setw(5) << percentileUs(50)
+           << "  p99 " << std::setw(5) << percentileUs(99)
+           << "  p99.9 " << std::setw(5) << percentileUs(99.9)
+           << "  max " << std::setw(5) << maxNs() / 1000 << " us" << std::endl;
+    }
+
+private:
+    template <typename T>
+    static void bump(std::atomic<T>& a, uint64_t by) {
+        a.store(static_cast<T>(a.load(std::memory_order_relaxed) + by), std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<uint32_t>, MAX_US + 1> counts_{};
+    std::atomic<uint64_t> total_{0};
+    std::atomic<uint64_t> sum_ns_{0};
+    std::atomic<uint64_t> max_ns_{0};
+};
+
+struct CycleStats {
+    CycleHistogram wakeup;   // how late clock_nanosleep returned after the deadline
+    CycleHistogram compute;  // wakeup to end of the cycle's work
+    std::atomic<uint64_t> overruns{0};  // cycles that finished past the next deadline
+    uint64_t period_ns = 0;
+    // Distributed clocks only
+    CycleHistogram dc_offset;            // |application time - reference clock|
+    std::atomic<uint64_t> sync0_misses{0};  // frames sent after SYNC0 of their cycle
+
+    // RT side
+    void record(uint64_t late_ns, uint64_t compute_ns) {
+        wakeup.record(late_ns);
+        compute.record(compute_ns);
+        if (late_ns + compute_ns > period_ns) {
+            overruns.store(overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+
+    void recordDc(int32_t offset_ns, bool missed_sync0) {
+        dc_offset.record(offset_ns < 0 ? -(int64_t)offset_ns : offset_ns);
+        if (missed_sync0) {
+            sync0_misses.store(sync0_misses.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+
+    void print(std::ostream& os) const {
+        uint64_t cycles = compute.count();
+        uint64_t over = overruns.load(std::memory_order_relaxed);
+        os << "[RT] Cycle stats: " << cycles << " cycles, period " << period_ns / 1000 << " us, "
+           << over << " overrun(s) (" << std::fixed << std::setprecision(3)
+           << (cycles ? 100.0 * over / cycles : 0.0) << "%)" << std::endl;
+        wakeup.print(os, "wakeup latency");
+        compute.print(os, "compute time");
+        if (dc_offset.count()) {
+            dc_offset.print(os, "DC offset");
+            os << "  " << sync0_misses.load(std::memory_order_relaxed) << " frame(s) sent after SYNC0" << std::endl;
+        }
+    }
+
+    // One line for periodic reports
+    void printSummary(std::ostream& os) const {
+        os << "[RT] " << compute.count() << " cycles, wakeup p99 " << wakeup.percentileUs(99)
+           << " us max " << wakeup.maxNs() / 1000 << " us, compute p99 " << compute.percentileUs(99)
+           << " us max " << compute.maxNs() / 1000 << " us, "
+           << overruns.load(std::memory_order_relaxed) << " overrun(s)";
+        if (dc_offset.count()) {
+            os << ", DC offset p99 " << dc_offset.percentileUs(99) << " us, "
+               << sync0_misses.load(std::memory_order_relaxed) << " SYNC0 miss(es)";
+        }
+        os << std::endl;
+    }
+};
+
+#endif //CYCLE_STATS_HPP_
@@ -0,0 +1,73 @@
+#ifndef DC_CLOCK_HPP_
+#define DC_CLOCK_HPP_
+
+#include <cstdint>
+
+// Locks the RT cycle onto the EtherCAT distributed clock (the bridge follows
+// the bus). The application time is the host clock minus a base that is
+// steered until it matches the DC reference clock; the loop sleeps on a grid
+// of whole periods in application time, so SYNC0 (reference clock multiples
+// + shift) always lands at the same point of the cycle.
+//
+// Per cycle the reference time returned for the previous frame is compared to
+// the application time that frame was sent with:
+//   - a large offset (start, clock jump) is stepped out at once
+//   - otherwise the base moves by a drift term, re-estimated every FILTER
+//     cycles from the mean change of the offset and capped at 0.1 % of the
+//     period, plus 1/GAIN of the offset (at least 1 ns) towards zero
+class DcClock {
+public:
+    static constexpr int FILTER = 100;
+    static constexpr int32_t STEP_NS = 20000;
+    static constexpr int32_t GAIN = 8;
+
+    explicit DcClock(uint64_t period_ns) : max_adjust_(static_cast<int64_t>(period_ns / 1000)) {}
+
+    uint64_t appTime(uint64_t host_ns) const { return host_ns - base_; }
+
+    // Returns how far the next wakeup moves (host ns) on top of the period
+    int64_t update(uint64_t prev_app_ns, uint32_t ref_ns, bool valid) {
+        if (!valid) return 0;
+        int32_t diff = static_cast<int32_t>(static_cast<uint32_t>(prev_app_ns) - ref_ns);
+        offset_ = diff;
+
+        if (!started_ || diff > STEP_NS || diff < -STEP_NS) {
+            started_ = true;
+            prev_diff_ = 0;
+            sum_delta_ = 0;
+            n_ = 0;
+            base_ += diff;
+            return diff;
+        }
+
+        sum_delta_ += diff - prev_diff_;
+        prev_diff_ = diff;
+        if (++n_ == FILTER) {
+            adjust_ += (sum_delta_ >= 0 ? sum_delta_ + FILTER / 2 : sum_delta_ - FILTER / 2) / FILTER;
+            if (adjust_ > max_adjust_) adjust_ = max_adjust_;
+            if (adjust_ < -max_adjust_) adjust_ = -max_adjust_;
+            sum_delta_ = 0;
+            n_ = 0;
+        }
+        int32_t correction = diff / GAIN;
+        if (correction == 0) correction = (diff > 0) - (diff < 0);
+        int64_t step = adjust_ + correction;
+        base_ += step;
+        return step;
+    }
+
+    int32_t offsetNs() const { return offset_; }      // last application - reference time
+    int64_t adjustNs() const { return adjust_; }      // drift correction per cycle
+
+private:
+    int64_t max_adjust_;
+    uint64_t base_ = 0;
+    bool started_ = false;
+    int32_t offset_ = 0;
+    int32_t prev_diff_ = 0;
+    int64_t sum_delta_ = 0;
+    int n_ = 0;
+    int64_t adjust_ = 0;
+};
+
+#endif //DC_CLOCK_HPP_
@@ -0,0 +1,84 @@
+#ifndef EC_MASTER_HPP_
+#define EC_MASTER_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The EtherCAT master as the RT loop sees it: one domain holding the EL1008
+// input byte and the EL2008 output byte. Backends:
+//   IgH  the real master through ecrt.h (built with WITH_IGH_MASTER)
+//   sim  in-memory process image with scripted inputs, output capture and a
+//        bus delay, so the whole interpreter -> TCP -> bridge path runs on any
+//        Linux box
+// activate()/release() run outside the loop; receive()/send() once per cycle
+// from the RT thread and must not allocate or block.
+class EcMaster {
+public:
+    virtual ~EcMaster() = default;
+
+    // Requests the master, registers the PDOs and activates; false on failure
+    virtual bool activate() = 0;
+    virtual void release() = 0;
+
+    // Start of cycle: fetch the frame and update the input image
+    virtual void receive() = 0;
+    // End of cycle: queue the output image and send the frame
+    virtual void send() = 0;
+
+    // Distributed clocks, RT side, only with DcConfig::enabled.
+    // Before send(): application time of this frame, then the slave clocks are
+    // synced to the reference clock; sync_reference first sets the reference
+    // clock to the application time (the bus follows the host).
+    virtual void syncClocks(uint64_t app_time_ns, bool sync_reference) = 0;
+    // After receive(): lower 32 bits of the reference clock read by the last
+    // sync; false while there is none
+    virtual bool referenceClockTime(uint32_t& ns) = 0;
+
+    virtual const char* name() const = 0;
+
+    // Process image, valid between activate() and release()
+    uint8_t readInputs() const { return *(pd_ + off_in_); }
+    void writeOutputs(uint8_t value) { *(pd_ + off_out_) = value; }
+
+protected:
+    uint8_t* pd_ = nullptr;
+    unsigned int off_in_ = 0;    // EL1008 channel byte
+    unsigned int off_out_ = 0;   // EL2008 channel byte
+};
+
+// A slave whose SYNC0 is driven by the distributed clock (e.g. a servo drive)
+struct DcSlave {
+    uint16_t position;
+    uint32_t vendor_id;
+    uint32_t product_code;
+    uint16_t assign_activate;   // 0x0700 = SYNC0 active for most Beckhoff drives
+};
+
+struct DcConfig {
+    bool enabled = false;
+    bool follow_reference = true;    // false: the reference clock follows the host clock
+    uint64_t cycle_ns = 1000000;     // SYNC0 period, the RT period
+    uint32_t sync0_shift_ns = 100000;  // SYNC0 fires this long after the cycle start
+    std::vector<DcSlave> slaves;
+};
+
+struct SimConfig {
+    // Lines "<ms> <byte>": EL1008 reads this byte from that time on (after
+    // activate). Bit 0 is the NC emergency stop contact, 1 = safe. Without a
+    // script the inputs stay 0x01.
+    std::string input_script;
+    // EL2008 output changes are written here on release, as "time_us,outputs"
+    std::string output_capture;
+    uint32_t latency_us = 0;   // one-way bus delay for both directions
+    bool loopback = false;     // input bits 1..7 follow the terminal's output bits 1..7
+    double dc_drift_ppm = 0;   // reference clock rate error against the host clock
+};
+
+#ifdef WITH_IGH_MASTER
+std::unique_ptr<EcMaster> makeIghMaster(const DcConfig& dc);
+#endif
+std::unique_ptr<EcMaster> makeSimMaster(const SimConfig& config);
+
+#endif //EC_MASTER_HPP_
@@ -4,20 +4,44 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <arpa/inet.h>
 #include <unistd.h>
+#include <sys/epoll.h>
+#include <cerrno>
 #include <iostream>
 #include <iomanip>
 #include <cstring>
 #include <atomic>
 #include <bitset>
+#include <chrono>
+#include <optional>
+#include <vector>
+#include <algorithm>
 #include "protocol.hpp"
 #include "spsc_queue.hpp"
+#include "event_fd.hpp"
+#include "wire_codec.hpp"
 
 
+// epoll loop: wakes on client traffic and on state_event, which the RT loop
+// signals after every queued GrsRobotState. Serves several clients at once:
+// the command lease holder plus state-only subscribers.
+// When a lease ends it sets abort_request (see rt_loop_func) and holds new
+// commands back until the RT loop has handled it; it never blocks on it.
 void network_server_func(SPSCQueue<GrsRobotState, 128>& s_q, 
                          SPSCQueue<GrsRobotCommand, 128>& c_q,
+                         std::atomic<bool>& abort_request,
+                         EventFd& state_event,
                          std::atomic<bool>& run);
 
+// Datagram variant: one 128-byte frame per packet, newest state only,
+// commands accepted strictly in cmd_id order (duplicates and anything after
+// a lost datagram are dropped and resent by the client)
+void udp_server_func(SPSCQueue<GrsRobotState, 128>& s_q,
+                     SPSCQueue<GrsRobotCommand, 128>& c_q,
+                     std::atomic<bool>& abort_request,
+                     EventFd& state_event,
+                     std::atomic<bool>& run);
 
 
 #endif //NETWORK_SERVER_HPP_
@@ -0,0 +1,30 @@
+#ifndef RT_CONFIG_HPP_
+#define RT_CONFIG_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Scheduling and memory setup of the RT thread, from the command line
+// (--rt-cpu, --rt-priority, --rt-period-us, --rt-stack-kb, --heap-prefault-mb).
+struct RtConfig {
+    int cpu = -1;                    // core for the RT thread (ideally isolcpus), -1: not pinned
+    int priority = 95;               // SCHED_FIFO priority
+    uint32_t period_us = 1000;       // cycle period
+    size_t stack_prefault_kb = 256;  // RT thread stack touched before the loop
+    size_t heap_prefault_mb = 16;    // heap touched and kept by malloc at startup
+
+    uint64_t periodNs() const { return (uint64_t)period_us * 1000; }
+    void print(std::ostream& os) const;
+};
+
+// Process-wide, from main before any thread starts: locks memory, keeps freed
+// heap in the process and pre-touches heap_prefault_mb, then moves the calling
+// thread (and so every thread it spawns) off the RT core.
+void prepareRtProcess(const RtConfig& config);
+
+// From the RT thread itself, before the loop: pins it, switches it to
+// SCHED_FIFO and prefaults its stack. Problems are reported, not fatal.
+void prepareRtThread(const RtConfig& config);
+
+#endif //RT_CONFIG_HPP_
@@ -0,0 +1,65 @@
+#ifndef RT_LOG_HPP_
+#define RT_LOG_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include "protocol.hpp"
+#include "spsc_queue.hpp"
+
+// Logging out of the SCHED_FIFO loop. The RT thread only fills fixed-size
+// binary records into a preallocated lock-free ring; formatting and the
+// (possibly blocking) terminal write happen in rt_log_func on a normal thread.
+// A full ring drops the record and counts it, it never waits.
+
+enum RtLogKind : uint8_t {
+    RT_LOG_TEXT   = 0,  // static message (text points to a string literal)
+    RT_LOG_MOTION = 1,  // motion command target: a = coords, b = axes
+    RT_LOG_POSE   = 2,  // global pose after a motion: a = pos, b = axes
+    RT_LOG_WAIT   = 3,  // WAIT command, value = ms
+    RT_LOG_ERROR  = 4,  // command failed, text = reason (string literal)
+};
+
+// RtLogRecord::parts
+enum RtLogParts : uint8_t {
+    RT_LOG_COORDS = 0x01,
+    RT_LOG_AXES   = 0x02,
+};
+
+struct RtLogRecord {
+    uint64_t    cycle;       // RT cycle counter
+    uint64_t    cmd_id;
+    uint8_t     kind;        // RtLogKind
+    uint8_t     cmd_type;    // GrsCommandType
+    uint8_t     parts;       // RtLogParts: which of a/b are meaningful
+    const char* text;        // RT_LOG_TEXT / RT_LOG_ERROR only
+    double      value;
+    double      a[6];
+    double      b[6];
+};
+
+class RtLog {
+public:
+    // ── RT side: no locks, no allocation, no syscalls ──
+    void text(uint64_t cycle, const char* literal);
+    void motion(uint64_t cycle, const GrsRobotCommand& cmd, uint8_t parts);
+    void pose(uint64_t cycle, uint64_t cmd_id, uint8_t parts, const double pos[6], const double axes[6]);
+    void wait(uint64_t cycle, uint64_t cmd_id, double ms);
+    void error(uint64_t cycle, uint64_t cmd_id, const char* reason);
+
+    // ── Reader side ──
+    // Formats everything queued so far, returns the number of records
+    size_t drain(std::ostream& os);
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    RtLogRecord* slot(uint64_t cycle, uint64_t cmd_id, uint8_t kind);
+
+    SPSCQueue<RtLogRecord, 1024> ring_;
+    std::atomic<uint64_t> dropped_{0};
+};
+
+// Reader thread: drains the ring every 10 ms until run is cleared, then once more
+void rt_log_func(RtLog& log, std::atomic<bool>& run);
+
+#endif //RT_LOG_HPP_
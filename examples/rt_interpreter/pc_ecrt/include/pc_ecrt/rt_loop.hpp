@@ -1,15 +1,29 @@
 #ifndef RT_LOOP_HPP_
-#define RTLOOP_HPP_
+#define RT_LOOP_HPP_
 #include <iostream>
 #include <iomanip>
 #include <chrono>
-#include <ecrt.h>
 #include "protocol.hpp"
 #include "spsc_queue.hpp"
+#include "event_fd.hpp"
 #include "bitset.hpp"
+#include "pc_ecrt/rt_log.hpp"
+#include "pc_ecrt/cycle_stats.hpp"
+#include "pc_ecrt/ec_master.hpp"
+#include "pc_ecrt/rt_config.hpp"
  
+// abort_request: set by the network thread when its client goes away. The
+// next cycle drops everything queued in c_q, stops the robot, fails the
+// unfinished ids and clears the outputs, then resets it.
 void rt_loop_func(SPSCQueue<GrsRobotState, 128>& s_q, 
             SPSCQueue<GrsRobotCommand, 128>& c_q,
+            std::atomic<bool>& abort_request,
+            EventFd& state_event,
+            RtLog& log,
+            CycleStats& stats,
+            EcMaster& ec,
+            const RtConfig& config,
+            const DcConfig& dc,
             std::atomic<bool>& run);
 
-#endif //RT_LOOP_HPP
+#endif //RT_LOOP_HPP_
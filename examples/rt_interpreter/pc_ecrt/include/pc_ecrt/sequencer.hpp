@@ -0,0 +1,69 @@
+#ifndef SEQUENCER_HPP_
+#define SEQUENCER_HPP_
+
+#include <cstdint>
+#include "protocol.hpp"
+#include "pc_ecrt/rt_log.hpp"
+#include "pc_ecrt/trajectory.hpp"
+
+// Executes GrsRobotCommands in program order, in cycles, on the RT thread.
+//
+//   motions      queue up in the trajectory planner (lookahead), done when the
+//                setpoint reaches the target
+//   WAIT         starts once the robot has stopped; a deadline in cycles, done
+//                when it expires. Everything behind it is held meanwhile.
+//   $OUT / NOP   applied once the robot has stopped and no WAIT runs
+//
+// A command that cannot be taken yet stays in the caller's queue. Invalid
+// commands fail in order (once everything before them has finished), and an
+// emergency stop aborts the motion in progress: the setpoint stops, every
+// queued motion fails, and all of them are reported as one failed range.
+// abort() is the bridge's own safety reaction when its client goes away.
+class CommandSequencer {
+public:
+    CommandSequencer(RtLog& log, uint64_t period_ns);
+
+    // The command at the head of the queue; true once it is taken (pop it)
+    bool offer(const GrsRobotCommand& cmd, uint64_t cycle, bool safe);
+
+    // Runs the active WAIT and motion by one cycle
+    void step(uint64_t cycle, bool safe);
+
+    // Client gone: stops the motion and the WAIT, clears the outputs and fails
+    // everything unfinished up to last_id (commands the caller dropped unrun)
+    void abort(uint64_t cycle, uint64_t last_id);
+
+    bool idle() const { return traj_.idle() && wait_id_ == 0; }
+    uint8_t outputs() const { return outputs_; }
+    const TrajectoryPlanner& trajectory() const { return traj_; }
+
+    // Reported in GrsRobotState
+    uint64_t acceptedId() const { return accepted_id_; }
+    uint64_t doneId() const { return done_id_; }
+    uint8_t lastType() const { return last_type_; }
+    uint8_t status() const;
+    // With status() ERROR: doneId() and this many - 1 ids before it failed
+    uint32_t failedCount() const { return failed_count_; }
+
+private:
+    static const char* invalid(const GrsRobotCommand& cmd);
+    void accept(const GrsRobotCommand& cmd);
+    void finish(uint64_t cmd_id, bool ok);
+    void fail(uint64_t first_id, uint64_t last_id);
+
+    RtLog& log_;
+    uint64_t period_ns_;
+    TrajectoryPlanner traj_;
+
+    uint8_t outputs_ = 0;
+    uint64_t wait_id_ = 0;        // active WAIT, 0: none
+    uint64_t wait_until_ = 0;     // cycle the active WAIT ends
+    uint64_t motion_id_ = 0;      // last motion handed to the planner
+
+    uint64_t accepted_id_ = 0;
+    uint64_t done_id_ = 0;
+    uint32_t failed_count_ = 0;   // done_id_ and the ids before it that failed with it
+    uint8_t last_type_ = GRS_CMD_NOP;
+};
+
+#endif //SEQUENCER_HPP_
@@ -0,0 +1,124 @@
+#ifndef TRAJECTORY_HPP_
+#define TRAJECTORY_HPP_
+
+#include <cstdint>
+#include <cstddef>
+#include "protocol.hpp"
+
+// Per-cycle setpoint generator for the RT loop.
+//
+// Motion commands become segments in a fixed ring. Each segment is planned once
+// when it is queued: a velocity profile over a normalized path parameter
+// s = 0..1, stored as up to 7 cubic pieces s(t) = c0 + c1 t + c2 t^2 + c3 t^3,
+// plus the geometry that maps s to a setpoint. A tick is then a piece lookup,
+// one Horner evaluation and a multiply-add per published value (an arc adds one
+// sin/cos pair).
+//
+//   PTP / *_REL   joint space: axes interpolated synchronously, all arrive together
+//   LIN / SPLINE  Cartesian straight line, orientation (a,b,c) blended along s
+//   CIRC          arc from the current point through an auxiliary point
+//                 (axes[0..2] = aux x,y,z) to the target; without an aux point
+//                 the move is linear
+//
+// The bridge has no kinematic model, so coords and axes are tracked side by
+// side: a command moves whichever of them it carries (a zero field keeps its
+// value, like before). Every segment starts and ends at rest.
+
+enum class ProfileShape : uint8_t {
+    TRAPEZOID,  // acceleration limited
+    SCURVE,     // jerk limited (7 phase)
+};
+
+struct AxisLimits {
+    double vel;    // units/s
+    double acc;    // units/s^2
+    double jerk;   // units/s^3 (S-curve only)
+};
+
+struct TrajectoryLimits {
+    ProfileShape shape = ProfileShape::SCURVE;
+    AxisLimits joint{90.0, 360.0, 3600.0};          // deg
+    AxisLimits linear{250.0, 1000.0, 10000.0};      // mm
+    AxisLimits orientation{90.0, 360.0, 3600.0};    // deg
+};
+
+// Velocity profile over s = 0..1
+struct MotionProfile {
+    struct Piece {
+        double t_end;   // end time of the piece, from segment start
+        double t0;      // start time
+        double c[4];
+    };
+    Piece piece[7];
+    int pieces = 0;
+    double duration = 0.0;
+
+    // Unit distance with the given limits (in s units)
+    void plan(ProfileShape shape, double vel, double acc, double jerk);
+};
+
+struct TrajectoryEvent {
+    uint64_t cmd_id = 0;   // 0: nothing finished this tick
+    uint8_t  parts = 0;    // bit0 coords moved, bit1 axes moved
+};
+
+class TrajectoryPlanner {
+public:
+    static constexpr size_t MAX_SEGMENTS = 32;
+
+    explicit TrajectoryPlanner(double dt, const TrajectoryLimits& limits = TrajectoryLimits{});
+
+    static bool isMotion(uint8_t cmd_type) {
+        return cmd_type >= GRS_CMD_PTP && cmd_type <= GRS_CMD_SPLINE_REL;
+    }
+
+    bool full() const { return count_ == MAX_SEGMENTS; }
+    bool idle() const { return count_ == 0; }
+    uint64_t activeId() const { return count_ ? ring_[head_].cmd_id : 0; }
+
+    // Plans and queues a motion command behind the ones already queued.
+    // False if the ring is full (the command stays with the caller).
+    bool push(const GrsRobotCommand& cmd);
+
+    // Advances the setpoint by one cycle
+    TrajectoryEvent step();
+
+    // Drops every queued segment; the setpoint stays where it is and the
+    // next motion starts from there
+    void abort();
+
+    const double* pos() const { return pos_; }
+    const double* axes() const { return axes_; }
+
+private:
+    enum Geometry : uint8_t { LINEAR, ARC };
+
+    struct Segment {
+        uint64_t cmd_id;
+        uint8_t  parts;
+        uint8_t  geometry;
+        MotionProfile profile;
+        double   start_pos[6], delta_pos[6];
+        double   start_axes[6], delta_axes[6];
+        // ARC: p(s) = center + r cos(s*sweep) u + r sin(s*sweep) v
+        double   center[3], u[3], v[3], radius, sweep;
+    };
+
+    void setpoint(const Segment& seg, double s);
+
+    double dt_;
+    TrajectoryLimits limits_;
+
+    Segment ring_[MAX_SEGMENTS];
+    size_t head_ = 0;
+    size_t count_ = 0;
+    double t_ = 0.0;       // time into the active segment
+    int piece_ = 0;        // active profile piece
+
+    double pos_[6] = {};
+    double axes_[6] = {};
+    double end_pos_[6] = {};   // where the last queued segment ends
+    double end_axes_[6] = {};
+};
+
+#endif //TRAJECTORY_HPP_
@@ -0,0 +1,95 @@
+#include "pc_ecrt/ec_master.hpp"
+#include <iostream>
+#include <ecrt.h>
+#include <time.h>
+
+namespace {
+
+uint64_t nowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+class IghMaster : public EcMaster {
+public:
+    explicit IghMaster(const DcConfig& dc) : dc_(dc) {}
+
+    bool activate() override {
+        ec_pdo_entry_reg_t domain_regs[] = {
+            {0, 1, 0x00000002, 0x03f03052, 0x6000, 0x01, &off_in_},
+            {0, 2, 0x00000002, 0x07d83052, 0x7000, 0x01, &off_out_},
+            {}
+        };
+
+        master_ = ecrt_request_master(0);
+        if (!master_) {
+            std::cerr << "[EC] Requesting master 0 failed" << std::endl;
+            return false;
+        }
+        domain_ = ecrt_master_create_domain(master_);
+        if (!domain_ || ecrt_domain_reg_pdo_entry_list(domain_, domain_regs)) {
+            std::cerr << "[EC] Domain / PDO entry registration failed" << std::endl;
+            return false;
+        }
+        if (dc_.enabled) {
+            for (const DcSlave& s : dc_.slaves) {
+                ec_slave_config_t* sc = ecrt_master_slave_config(master_, 0, s.position, s.vendor_id, s.product_code);
+                if (!sc) {
+                    std::cerr << "[EC] DC: no slave config for position " << s.position << std::endl;
+                    return false;
+                }
+                ecrt_slave_config_dc(sc, s.assign_activate, dc_.cycle_ns, dc_.sync0_shift_ns, 0, 0);
+            }
+            // SYNC0 start times are derived from the application time at activation
+            ecrt_master_application_time(master_, nowNs());
+        }
+        if (ecrt_master_activate(master_)) {
+            std::cerr << "[EC] Master activation failed" << std::endl;
+            return false;
+        }
+        pd_ = ecrt_domain_data(domain_);
+        return true;
+    }
+
+    void release() override {
+        if (master_) ecrt_release_master(master_);
+        master_ = nullptr;
+        domain_ = nullptr;
+        pd_ = nullptr;
+    }
+
+    void receive() override {
+        ecrt_master_receive(master_);
+        ecrt_domain_process(domain_);
+    }
+
+    void send() override {
+        ecrt_domain_queue(domain_);
+        ecrt_master_send(master_);
+    }
+
+    void syncClocks(uint64_t app_time_ns, bool sync_reference) override {
+        ecrt_master_application_time(master_, app_time_ns);
+        if (sync_reference) ecrt_master_sync_reference_clock(master_);
+        ecrt_master_sync_slave_clocks(master_);
+    }
+
+    bool referenceClockTime(uint32_t& ns) override {
+        return ecrt_master_reference_clock_time(master_, &ns) == 0;
+    }
+
+    const char* name() const override { return "IgH EtherCAT"; }
+
+private:
+    DcConfig dc_;
+    ec_master_t* master_ = nullptr;
+    ec_domain_t* domain_ = nullptr;
+};
+
+}
+
+
+std::unique_ptr<EcMaster> makeIghMaster(const DcConfig& dc) {
+    return std::make_unique<IghMaster>(dc);
+}
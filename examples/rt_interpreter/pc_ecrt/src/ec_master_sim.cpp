@@ -0,0 +1,196 @@
+#include "pc_ecrt/ec_master.hpp"
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <time.h>
+
+namespace {
+
+uint64_t nowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Stand-in for the bus and the two terminals. The master side is the process
+// image the RT loop reads and writes; the terminal side is what the EL1008 sees
+// on its pins and what the EL2008 drives. The two meet latency_us apart.
+class SimMaster : public EcMaster {
+public:
+    explicit SimMaster(const SimConfig& config) : config_(config) {}
+
+    bool activate() override {
+        script_.clear();
+        if (!config_.input_script.empty() && !loadScript()) return false;
+        if (script_.empty() || script_.front().at_ns > 0) script_.insert(script_.begin(), {0, 0x01});
+
+        capture_.clear();
+        capture_.reserve(MAX_CAPTURE);
+        dropped_ = 0;
+        in_flight_head_ = in_flight_count_ = 0;
+        next_input_ = 0;
+        terminal_out_ = 0;
+        queued_out_ = 0;
+        image_.fill(0);
+
+        off_in_ = 0;
+        off_out_ = 1;
+        pd_ = image_.data();
+        latency_ns_ = (uint64_t)config_.latency_us * 1000;
+        t0_ = nowNs();
+        ref_base_ = t0_;
+        ref_from_ = t0_;
+        ref_valid_ = false;
+        return true;
+    }
+
+    void release() override {
+        if (!config_.output_capture.empty()) {
+            std::ofstream out(config_.output_capture);
+            out << "time_us,outputs\n";
+            for (const Change& c : capture_) out << c.at_ns / 1000 << "," << int(c.value) << "\n";
+            std::cout << "[EC] Simulated EL2008: " << capture_.size() << " output change(s) written to "
+                      << config_.output_capture;
+            if (dropped_) std::cout << ", " << dropped_ << " beyond capacity not recorded";
+            std::cout << std::endl;
+        }
+        pd_ = nullptr;
+    }
+
+    void receive() override {
+        uint64_t t = nowNs() - t0_;
+
+        // Outputs sent at least one bus delay ago reach the EL2008
+        while (in_flight_count_ && in_flight_[in_flight_head_].at_ns <= t) {
+            drive(in_flight_[in_flight_head_].value, t);
+            in_flight_head_ = (in_flight_head_ + 1) % in_flight_.size();
+            in_flight_count_--;
+        }
+
+        // The frame carries what the EL1008 sampled one bus delay ago
+        uint64_t sampled = t > latency_ns_ ? t - latency_ns_ : 0;
+        while (next_input_ + 1 < script_.size() && script_[next_input_ + 1].at_ns <= sampled) next_input_++;
+        uint8_t in = script_[next_input_].value;
+        if (config_.loopback) in = (in & 0x01) | (terminal_out_ & 0xFE);
+        image_[off_in_] = in;
+    }
+
+    void send() override {
+        uint8_t out = image_[off_out_];
+        if (out == queued_out_) return;     // only changes travel, the rest is implied
+        queued_out_ = out;
+        uint64_t t = nowNs() - t0_;
+        if (latency_ns_ == 0 || in_flight_count_ == in_flight_.size()) {
+            drive(out, t);
+            return;
+        }
+        in_flight_[(in_flight_head_ + in_flight_count_) % in_flight_.size()] = {t + latency_ns_, out};
+        in_flight_count_++;
+    }
+
+    // The reference clock runs dc_drift_ppm off the host clock; a sync datagram
+    // samples it as the frame passes, one bus delay after send
+    void syncClocks(uint64_t app_time_ns, bool sync_reference) override {
+        uint64_t now = nowNs();
+        if (sync_reference) {
+            ref_base_ = app_time_ns;
+            ref_from_ = now;
+        }
+        ref_sample_ = refClock(now + latency_ns_);
+        ref_valid_ = true;
+    }
+
+    bool referenceClockTime(uint32_t& ns) override {
+        ns = (uint32_t)ref_sample_;
+        return ref_valid_;
+    }
+
+    const char* name() const override { return "simulated EtherCAT"; }
+
+private:
+    struct Change {
+        uint64_t at_ns;   // since activate()
+        uint8_t value;
+    };
+
+    static constexpr size_t MAX_CAPTURE = 1 << 16;
+
+    bool loadScript() {
+        std::ifstream in(config_.input_script);
+        if (!in) {
+            std::cerr << "[EC] Cannot open input script " << config_.input_script << std::endl;
+            return false;
+        }
+        std::string line;
+        int line_no = 0;
+        while (std::getline(in, line)) {
+            line_no++;
+            auto hash = line.find('#');
+            if (hash != std::string::npos) line.erase(hash);
+            std::istringstream fields(line);
+            double ms;
+            std::string byte;
+            if (!(fields >> ms)) continue;   // blank or comment
+            unsigned long value = 0;
+            try {
+                if (!(fields >> byte)) throw std::invalid_argument("missing value");
+                value = std::stoul(byte, nullptr, 0);
+            } catch (const std::exception&) {
+                value = 256;
+            }
+            if (ms < 0 || value > 0xFF || (!script_.empty() && ms * 1e6 < script_.back().at_ns)) {
+                std::cerr << "[EC] " << config_.input_script << ":" << line_no
+                          << ": expected \"<ms> <byte>\" in ascending time" << std::endl;
+                return false;
+            }
+            script_.push_back({(uint64_t)(ms * 1e6), (uint8_t)value});
+        }
+        std::cout << "[EC] Simulated EL1008: " << script_.size() << " input step(s) from "
+                  << config_.input_script << std::endl;
+        return true;
+    }
+
+    uint64_t refClock(uint64_t host_ns) const {
+        double elapsed = (double)(int64_t)(host_ns - ref_from_);
+        return ref_base_ + (int64_t)(elapsed * (1.0 + config_.dc_drift_ppm * 1e-6));
+    }
+
+    void drive(uint8_t value, uint64_t t) {
+        if (value == terminal_out_) return;
+        terminal_out_ = value;
+        if (capture_.size() < MAX_CAPTURE) capture_.push_back({t, value});
+        else dropped_++;
+    }
+
+    SimConfig config_;
+    std::array<uint8_t, 2> image_{};
+    uint64_t t0_ = 0;
+    uint64_t latency_ns_ = 0;
+
+    std::vector<Change> script_;
+    size_t next_input_ = 0;
+
+    std::array<Change, 256> in_flight_{};   // outputs on the wire
+    size_t in_flight_head_ = 0;
+    size_t in_flight_count_ = 0;
+    uint8_t queued_out_ = 0;
+    uint8_t terminal_out_ = 0;
+
+    std::vector<Change> capture_;   // reserved up front, never grows in the loop
+    uint64_t dropped_ = 0;
+
+    uint64_t ref_base_ = 0;     // reference clock reading at host time ref_from_
+    uint64_t ref_from_ = 0;
+    uint64_t ref_sample_ = 0;
+    bool ref_valid_ = false;
+};
+
+}
+
+
+std::unique_ptr<EcMaster> makeSimMaster(const SimConfig& config) {
+    return std::make_unique<SimMaster>(config);
+}
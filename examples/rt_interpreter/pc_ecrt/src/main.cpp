@@ -1,8 +1,10 @@
 #include <iostream>
 #include <thread>
 #include <atomic>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
 #include <signal.h>
-#include <sys/mman.h>
 #include "pc_ecrt/network_server.hpp"
 #include "pc_ecrt/rt_loop.hpp"
 
@@ -10,34 +12,125 @@
 std::atomic<bool> running{true};
 SPSCQueue<GrsRobotState, 128> state_queue;
 SPSCQueue<GrsRobotCommand, 128> command_queue;
+std::atomic<bool> abort_request{false};   // network -> RT: client gone, drop its commands
+EventFd state_event;
+RtLog rt_log;
+CycleStats cycle_stats;
 
 void signal_handler(int) { running = false; }
 
-int main() {
+// "pos:vendor:product[:assign_activate]", numbers in any C base (0x...)
+bool parseDcSlave(const char* arg, DcSlave& slave) {
+    char* end;
+    slave.position = (uint16_t)std::strtoul(arg, &end, 0);
+    if (*end != ':') return false;
+    slave.vendor_id = (uint32_t)std::strtoul(end + 1, &end, 0);
+    if (*end != ':') return false;
+    slave.product_code = (uint32_t)std::strtoul(end + 1, &end, 0);
+    slave.assign_activate = 0x0700;
+    if (*end == ':') slave.assign_activate = (uint16_t)std::strtoul(end + 1, &end, 0);
+    return *end == '\0';
+}
+
+int main(int argc, char* argv[]) {
+    bool use_udp = false;
+    bool show_stats = false;  // --stats: cycle timing every 10 s and on shutdown
+    bool use_sim = false;     // --sim: simulated EtherCAT master, no hardware needed
+    SimConfig sim;
+    RtConfig rt;
+    DcConfig dc;
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--udp") == 0) use_udp = true;
+        else if (std::strcmp(argv[i], "--stats") == 0) show_stats = true;
+        else if (std::strcmp(argv[i], "--sim") == 0) use_sim = true;
+        else if (std::strcmp(argv[i], "--sim-inputs") == 0 && has_value) sim.input_script = argv[++i];
+        else if (std::strcmp(argv[i], "--sim-capture") == 0 && has_value) sim.output_capture = argv[++i];
+        else if (std::strcmp(argv[i], "--sim-latency") == 0 && has_value) sim.latency_us = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--sim-loopback") == 0) sim.loopback = true;
+        else if (std::strcmp(argv[i], "--sim-dc-drift-ppm") == 0 && has_value) sim.dc_drift_ppm = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--dc") == 0) dc.enabled = true;
+        else if (std::strcmp(argv[i], "--dc-master-clock") == 0) dc.enabled = true, dc.follow_reference = false;
+        else if (std::strcmp(argv[i], "--dc-shift-us") == 0 && has_value) dc.sync0_shift_ns = std::atoi(argv[++i]) * 1000;
+        else if (std::strcmp(argv[i], "--dc-slave") == 0 && has_value) {
+            DcSlave slave;
+            if (!parseDcSlave(argv[++i], slave)) {
+                std::cerr << "--dc-slave expects pos:vendor:product[:assign_activate]" << std::endl;
+                return 1;
+            }
+            dc.slaves.push_back(slave);
+        }
+        else if (std::strcmp(argv[i], "--rt-cpu") == 0 && has_value) rt.cpu = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--rt-priority") == 0 && has_value) rt.priority = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--rt-period-us") == 0 && has_value) rt.period_us = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--rt-stack-kb") == 0 && has_value) rt.stack_prefault_kb = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--heap-prefault-mb") == 0 && has_value) rt.heap_prefault_mb = std::atoi(argv[++i]);
+    }
+    if (rt.period_us < 100 || rt.priority < 1 || rt.priority > 99) {
+        std::cerr << "--rt-period-us must be >= 100 and --rt-priority 1..99" << std::endl;
+        return 1;
+    }
+    dc.cycle_ns = rt.periodNs();
+    if (dc.enabled && dc.sync0_shift_ns >= dc.cycle_ns) {
+        std::cerr << "--dc-shift-us must be shorter than the period" << std::endl;
+        return 1;
+    }
+
+#ifdef WITH_IGH_MASTER
+    std::unique_ptr<EcMaster> ec = use_sim ? makeSimMaster(sim) : makeIghMaster(dc);
+#else
+    if (!use_sim) std::cout << "Built without the IgH master, using the simulated one" << std::endl;
+    std::unique_ptr<EcMaster> ec = makeSimMaster(sim);
+#endif
+
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
     signal(SIGPIPE, SIG_IGN);  // Prevent crash when TCP client disconnects
     
-    if (mlockall(MCL_CURRENT | MCL_FUTURE) == -1) {
-        std::cerr << "mlockall failed! Run with sudo." << std::endl;
-    }
+    // Before any thread exists: they all inherit the memory setup and stay off the RT core
+    prepareRtProcess(rt);
 
     std::cout << "Starting Holly Bridge Node..." << std::endl;
-    std::cout << "Protocol: Unified 128-byte (Motion + I/O)" << std::endl;
+    std::cout << "Protocol: Unified 128-byte (Motion + I/O) over "
+              << (use_udp ? "UDP" : "TCP") << ", master: " << ec->name() << std::endl;
+    rt.print(std::cout);
+    if (dc.enabled) {
+        std::cout << "Distributed clocks: " << (dc.follow_reference ? "cycle follows the reference clock"
+                                                                    : "reference clock follows the host")
+                  << ", SYNC0 shift " << dc.sync0_shift_ns / 1000 << " us, " << dc.slaves.size()
+                  << " SYNC0 slave(s)" << std::endl;
+    }
 
-    // RT Thread (Priority 95)
+    // RT Thread (SCHED_FIFO, pinned if --rt-cpu)
     std::thread rt_thread([&]() {
-        struct sched_param param;
-        param.sched_priority = 95;
-        pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
-        rt_loop_func(std::ref(state_queue), std::ref(command_queue), std::ref(running));
+        prepareRtThread(rt);
+        rt_loop_func(std::ref(state_queue), std::ref(command_queue), std::ref(abort_request), std::ref(state_event),
+                     std::ref(rt_log), std::ref(cycle_stats), std::ref(*ec), rt, dc, std::ref(running));
     });
 
+    // RT log reader (normal priority): formats what the RT thread recorded
+    std::thread log_thread(rt_log_func, std::ref(rt_log), std::ref(running));
+
     // Network Thread
-    std::thread nw_thread(network_server_func, std::ref(state_queue), std::ref(command_queue), std::ref(running));
+    std::thread nw_thread(use_udp ? udp_server_func : network_server_func,
+                          std::ref(state_queue), std::ref(command_queue), std::ref(abort_request),
+                          std::ref(state_event), std::ref(running));
+
+    // The histograms are read while the RT thread keeps writing them
+    auto last_report = std::chrono::steady_clock::now();
+    while (running) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (show_stats && std::chrono::steady_clock::now() - last_report >= std::chrono::seconds(10)) {
+            cycle_stats.printSummary(std::cout);
+            last_report = std::chrono::steady_clock::now();
+        }
+    }
 
     if (rt_thread.joinable()) rt_thread.join();
     if (nw_thread.joinable()) nw_thread.join();
+    if (log_thread.joinable()) log_thread.join();
+
+    if (show_stats) cycle_stats.print(std::cout);
 
     return 0;
 }
@@ -2,6 +2,28 @@
 
 namespace  {
 
+// Per-connection traffic counters, printed when the client leaves
+struct SessionStats {
+    uint64_t tx_frames = 0, tx_bytes = 0;
+    uint64_t rx_frames = 0, rx_bytes = 0;
+    uint64_t rx_reads = 0, tx_skipped = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    void print(uint64_t id, uint8_t wire) const {
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "[Network] Client #" << id << " session (" << (wire == grs_wire::WIRE_COMPACT ? "compact" : "fixed")
+                  << "): " << tx_frames << " state frames, "
+                  << std::fixed << std::setprecision(1)
+                  << (tx_frames ? double(tx_bytes) / tx_frames : 0.0) << " B/frame, "
+                  << (secs > 0 ? tx_frames / secs : 0.0) << " frames/s; "
+                  << rx_frames << " command frames, "
+                  << (rx_frames ? double(rx_bytes) / rx_frames : 0.0) << " B/frame in "
+                  << rx_reads << " reads";
+        if (tx_skipped) std::cout << ", " << tx_skipped << " state frames skipped (client not reading)";
+        std::cout << std::endl;
+    }
+};
+
 void logGrsCommand(const GrsRobotCommand& cmd) {
     std::cout << "  [GRS CMD #" << cmd.cmd_id << "] " 
               << grsCommandTypeName(cmd.cmd_type);
@@ -73,14 +95,302 @@ void logGrsCommand(const GrsRobotCommand& cmd) {
     std::cout << std::endl;
 }
 
+
+constexpr int MAX_EVENTS = 16;
+constexpr size_t MAX_CLIENTS = 8;
+// A client that does not take a single byte of state for this long is closed.
+// Only the lease holder is exempt — it just loses frames, like before.
+constexpr auto STALL_LIMIT = std::chrono::seconds(2);
+constexpr int SOCKET_SNDBUF = 64 * 1024;
+
+void watch(int ep, int op, int fd, uint32_t events) {
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = fd;
+    epoll_ctl(ep, op, fd, &ev);
+}
+
+GrsRobotState toExternalState(const GrsRobotState& state) {
+    GrsRobotState extState{};
+    extState.seq_id = state.seq_id;
+    extState.failed_count = state.failed_count;
+    extState.inputs = state.inputs;
+    extState.outputs = state.outputs;
+    extState.is_hardware_emg = state.is_hardware_emg;
+    extState.system_ready = state.system_ready;
+    extState.frame_seq = state.frame_seq;
+    extState.done_cmd_id = state.done_cmd_id;
+    extState.cmd_ack = state.cmd_ack;
+    extState.cmd_status = state.cmd_status;
+    // Interpolated setpoint, filled in by the RT loop every cycle
+    std::memcpy(extState.current_pos, state.current_pos, sizeof(extState.current_pos));
+    std::memcpy(extState.current_axes, state.current_axes, sizeof(extState.current_axes));
+    return extState;
+}
+
+// Safety reaction when the client in control goes away. It does not queue
+// behind the client's backlog: the RT loop sees the flag on its next cycle,
+// drops the queue, stops the robot and clears the outputs.
+void abortClient(std::atomic<bool>& abort_request) {
+    abort_request.store(true, std::memory_order_release);
+}
+
+struct TcpClient;
+
+// Only one client at a time has its commands executed: the lease holder.
+// Everyone else is a subscriber that receives state only. Whenever the lease
+// ends (holder gone or turned subscriber) the outputs are cleared; when the
+// holder's own session resumes on a new connection the lease moves there intact.
+class CommandLease {
+public:
+    explicit CommandLease(std::atomic<bool>& abort_request) : abort_(abort_request) {}
+
+    // True if c holds the lease afterwards
+    bool request(TcpClient& c);
+    void release(TcpClient& c);
+    // A released lease is still being cleared up by the RT loop; commands wait
+    bool aborting() const { return abort_.load(std::memory_order_acquire); }
+
+private:
+    std::atomic<bool>& abort_;
+    TcpClient* holder_ = nullptr;
+};
+
+// A connected TCP client on a non-blocking socket. State frames are appended to
+// tx and written when the socket has room; a client that stops reading only
+// loses state frames (the next one supersedes them), it never blocks the loop.
+struct TcpClient {
+    using Clock = std::chrono::steady_clock;
+
+    int fd = -1;
+    uint64_t id = 0;                       // connection number, for the log
+    sockaddr_in peer{};
+    uint8_t wire = grs_wire::WIRE_FIXED;  // negotiated by the client, starts fixed 128-byte
+    bool lease = false;                    // maintained by CommandLease
+    bool subscriber = false;               // sent GRS_CMD_FLAG_SUBSCRIBE
+    bool evicted = false;                  // its session resumed on a new connection
+    uint64_t session = 0;                  // token from its hello/resume, 0 = none (legacy)
+    Clock::duration interval{};            // subscriber decimation, 0 = every frame
+    Clock::time_point next_due;
+    Clock::time_point last_progress;       // last time tx drained or was empty
+    uint64_t rejected = 0;                 // commands refused (no lease)
+    // Large enough for a full RT queue worth of fixed-size frames, so a
+    // batched upload is taken in with a few reads
+    uint8_t rx[16384];
+    size_t rx_len = 0;
+    uint8_t tx[4096];
+    size_t tx_len = 0;
+    uint32_t interest = 0;
+    SessionStats stats;
+
+    void reset(int sock, uint64_t conn_id, const sockaddr_in& from) {
+        fd = sock;
+        id = conn_id;
+        peer = from;
+        wire = grs_wire::WIRE_FIXED;
+        lease = subscriber = evicted = false;
+        session = 0;
+        interval = Clock::duration::zero();
+        next_due = last_progress = Clock::now();
+        rejected = 0;
+        rx_len = tx_len = 0;
+        interest = EPOLLIN | EPOLLRDHUP;
+        stats = SessionStats{};
+    }
+
+    bool stalled(Clock::time_point now) const {
+        return !lease && tx_len > 0 && now - last_progress > STALL_LIMIT;
+    }
+
+    // Reads what the socket holds; false when the peer has gone
+    bool receive() {
+        while (rx_len < sizeof(rx)) {
+            ssize_t n = recv(fd, rx + rx_len, sizeof(rx) - rx_len, 0);
+            if (n > 0) {
+                rx_len += n;
+                stats.rx_reads++;
+                continue;
+            }
+            if (n == 0) return false;  // Client disconnected
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        return true;
+    }
+
+    // Ordinary state frames leave room for one control frame (format reply)
+    void queueState(const GrsRobotState& st, bool control = false) {
+        size_t limit = control ? sizeof(tx) : sizeof(tx) - grs_wire::MAX_FRAME;
+        if (tx_len + grs_wire::MAX_FRAME > limit) {
+            stats.tx_skipped++;
+            return;
+        }
+        GrsRobotState own = st;
+        own.link_flags = lease ? GRS_LINK_LEASE : 0;
+        size_t len = grs_wire::encodeState(own, wire, tx + tx_len);
+        tx_len += len;
+        stats.tx_frames++;
+        stats.tx_bytes += len;
+    }
+
+    // Subscribers with an interval only get the newest frame once it is due
+    void publish(const GrsRobotState& st, Clock::time_point now) {
+        if (now < next_due) return;
+        queueState(st);
+        next_due = now + interval;
+    }
+
+    bool flush() {
+        if (tx_len == 0) {
+            last_progress = Clock::now();
+            return true;
+        }
+        ssize_t sent = send(fd, tx, tx_len, MSG_NOSIGNAL);
+        if (sent < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        std::memmove(tx, tx + sent, tx_len - sent);
+        tx_len -= sent;
+        if (sent > 0) last_progress = Clock::now();
+        return true;
+    }
+
+    // Stop reading while rx is full (TCP flow control holds the client back),
+    // ask for EPOLLOUT only while tx has a backlog
+    void updateInterest(int ep) {
+        uint32_t want = EPOLLRDHUP;
+        if (rx_len < sizeof(rx)) want |= EPOLLIN;
+        if (tx_len > 0) want |= EPOLLOUT;
+        if (want != interest) {
+            watch(ep, EPOLL_CTL_MOD, fd, want);
+            interest = want;
+        }
+    }
+
+    // Decodes buffered command frames and hands them to the RT loop.
+    // While the RT queue is full or an abort is pending, frames stay in rx
+    // and are retried later.
+    // Commands from a client without the lease are dropped unacknowledged.
+    // Returns false on a malformed frame.
+    bool dispatch(SPSCQueue<GrsRobotCommand, 128>& ext_cmd_q, uint64_t& last_cmd_id,
+                  const GrsRobotState& last_state, CommandLease& cmd_lease) {
+        size_t off = 0;
+        bool ok = true;
+        for (;;) {
+            GrsRobotCommand extCmd;
+            size_t used = grs_wire::decodeCommand(rx + off, rx_len - off, wire, extCmd);
+            if (used == 0) break;
+            if (used == grs_wire::BAD_FRAME) { ok = false; break; }
+
+            // NOP is link control only (session hello / subscribe / format request), never forwarded
+            if (extCmd.cmd_type == GRS_CMD_NOP) {
+                if (extCmd.flags & GRS_CMD_FLAG_SUBSCRIBE) {
+                    subscriber = true;
+                    cmd_lease.release(*this);
+                    double ms = std::max(0.0, std::min(extCmd.wait_time, 60000.0));
+                    interval = std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double, std::milli>(ms));
+                    std::cout << "[Network] Client #" << id << " subscribed, ";
+                    if (ms > 0) std::cout << "one state frame per " << ms << " ms" << std::endl;
+                    else std::cout << "every state frame" << std::endl;
+                } else if (!subscriber && extCmd.session != 0) {
+                    // Hello or resume; a bare NOP (keepalive) never asks for the lease
+                    session = extCmd.session;
+                    if (!cmd_lease.request(*this)) {
+                        std::cout << "[Network] Client #" << id
+                                  << " refused the command lease, another session holds it" << std::endl;
+                    } else if (extCmd.flags & GRS_CMD_FLAG_HELLO) {
+                        last_cmd_id = 0;
+                    }
+                }
+                if (extCmd.flags & GRS_CMD_FLAG_FORMAT) {
+                    // Reply in the current format, then switch
+                    uint8_t accepted = (extCmd.io_value == grs_wire::WIRE_COMPACT)
+                                     ? grs_wire::WIRE_COMPACT : grs_wire::WIRE_FIXED;
+                    GrsRobotState reply = last_state;
+                    reply.wire_format = grs_wire::WIRE_REPLY | accepted;
+                    queueState(reply, true);
+                    wire = accepted;
+                    std::cout << "[Network] Client #" << id << " wire format: "
+                              << (wire == grs_wire::WIRE_COMPACT ? "compact v1" : "fixed 128-byte")
+                              << std::endl;
+                }
+                off += used;
+                stats.rx_frames++;
+                stats.rx_bytes += used;
+                continue;
+            }
+
+            // Legacy clients send no hello: their first command asks for the lease
+            if (!lease && (subscriber || !cmd_lease.request(*this))) {
+                if (rejected++ == 0) {
+                    std::cout << "[Network] Client #" << id
+                              << " has no command lease, dropping its commands" << std::endl;
+                }
+                off += used;
+                continue;
+            }
+
+            // Resent after a reconnect but already queued before the drop
+            if ((extCmd.flags & GRS_CMD_FLAG_RESEND) && extCmd.cmd_id <= last_cmd_id) {
+                std::cout << "  [GRS CMD #" << extCmd.cmd_id << "] duplicate dropped" << std::endl;
+                off += used;
+                continue;
+            }
+
+            // Push to command queue for rt_loop processing; if it is full, or the
+            // RT loop is about to drop it, the frame stays buffered for the next pass
+            if (cmd_lease.aborting() || !ext_cmd_q.push(extCmd)) break;
+            off += used;
+            stats.rx_frames++;
+            stats.rx_bytes += used;
+            last_cmd_id = extCmd.cmd_id;
+
+            // Log the command
+            logGrsCommand(extCmd);
+        }
+        std::memmove(rx, rx + off, rx_len - off);
+        rx_len -= off;
+        if (!ok) std::cout << "[Network] Malformed frame from client #" << id << ", closing connection" << std::endl;
+        return ok;
+    }
+};
+
+// A free lease goes to the first client asking. A held one only moves to a new
+// connection that resumes the holder's session (same token): the controlling
+// client coming back while the bridge has not yet noticed the old link is dead.
+// Anyone else is refused, the holder is never evicted by another session.
+bool CommandLease::request(TcpClient& c) {
+    if (holder_ == &c) return true;
+    if (holder_) {
+        if (c.session == 0 || c.session != holder_->session) return false;
+        std::cout << "[Network] Client #" << c.id << " resumes the session of client #"
+                  << holder_->id << ", command lease moved" << std::endl;
+        // The lease does not end, so the outputs stay as the session left them
+        holder_->lease = false;
+        holder_->evicted = true;
+    }
+    holder_ = &c;
+    c.lease = true;
+    std::cout << "[Network] Client #" << c.id << " holds the command lease" << std::endl;
+    return true;
+}
+
+void CommandLease::release(TcpClient& c) {
+    if (holder_ != &c) return;
+    holder_ = nullptr;
+    c.lease = false;
+    abortClient(abort_);
+    std::cout << "[Network] Command lease of client #" << c.id << " ended. Outputs cleared." << std::endl;
+}
+
 }
 
 
 void network_server_func(SPSCQueue<GrsRobotState, 128>& s_q, 
                          SPSCQueue<GrsRobotCommand, 128>& ext_cmd_q,
+                         std::atomic<bool>& abort_request,
+                         EventFd& state_event,
                          std::atomic<bool>& run) {
     
-    int server_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int server_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
     if (server_fd < 0) return;
 
     // (SO_REUSEADDR)
@@ -93,65 +403,273 @@ void network_server_func(SPSCQueue<GrsRobotState, 128>& s_q,
     address.sin_port = htons(12345);
 
     if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) return;
-    listen(server_fd, 3);
+    listen(server_fd, MAX_CLIENTS);
+
+    // One epoll set for everything: listen socket, the clients, and the RT thread's
+    // state eventfd. The thread sleeps in epoll_wait until one of them has work.
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if (ep < 0) {
+        close(server_fd);
+        return;
+    }
+    watch(ep, EPOLL_CTL_ADD, server_fd, EPOLLIN);
+    watch(ep, EPOLL_CTL_ADD, state_event.fd(), EPOLLIN);
 
-    std::cout << "[Network] Server listening on port 12345" << std::endl;
+    std::cout << "[Network] Server listening on port 12345 (up to " << MAX_CLIENTS << " clients)" << std::endl;
     std::cout << "[Network] Unified 128-byte protocol (Motion + I/O)" << std::endl;
 
+    // Highest cmd_id queued for the RT loop. Kept across connections so a client
+    // resuming after a link drop cannot get a command executed twice.
+    uint64_t last_cmd_id = 0;
+
+    // All client slots are allocated up front, the loop itself never allocates
+    std::vector<TcpClient> clients(MAX_CLIENTS);
+    std::vector<bool> lost(MAX_CLIENTS, false);
+    CommandLease cmd_lease(abort_request);
+    uint64_t next_id = 1;
+    GrsRobotState last_state{};
+    epoll_event events[MAX_EVENTS];
+
+    auto find_client = [&](int fd) -> int {
+        for (size_t k = 0; k < MAX_CLIENTS; k++) {
+            if (clients[k].fd == fd) return static_cast<int>(k);
+        }
+        return -1;
+    };
+
+    auto drop_client = [&](TcpClient& client) {
+        client.stats.print(client.id, client.wire);
+        if (client.rejected) {
+            std::cout << "[Network] Client #" << client.id << ": " << client.rejected
+                      << " command(s) dropped without lease" << std::endl;
+        }
+        close(client.fd);  // also removes it from the epoll set
+        client.fd = -1;
+        std::cout << "[Network] Client #" << client.id << " disconnected." << std::endl;
+        // Clears all outputs if it was the one in control (safety)
+        cmd_lease.release(client);
+    };
+
     while (run) {
-        int client_socket = accept(server_fd, nullptr, nullptr);
-        if (client_socket < 0) continue;
-
-        // TCP_NODELAY
-        int flag = 1;
-        setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, (char *)&flag, sizeof(int));
-
-        std::cout << "[Network] Client connected!" << std::endl;
-
-        while (client_socket > 0 && run) {
-            // 1. State — send 128-byte GrsRobotState to client
-                auto state = s_q.pop();
-                if (state) {
-                    GrsRobotState extState{};
-                    extState.seq_id = state->seq_id;
-                    extState.timestamp = state->timestamp;
-                    extState.inputs = state->inputs;
-                    extState.outputs = state->outputs;
-                    extState.is_hardware_emg = state->is_hardware_emg;
-                    extState.system_ready = state->system_ready;
-                    ssize_t sent = send(client_socket, &extState, sizeof(GrsRobotState), MSG_NOSIGNAL);
-                    if (sent <= 0) break;  // Client disconnected
+        // The timeout only bounds how long a shutdown request can go unnoticed
+        int n = epoll_wait(ep, events, MAX_EVENTS, 100);
+        if (n < 0 && errno != EINTR) break;
+
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            uint32_t ev = events[i].events;
+
+            if (fd == state_event.fd()) {
+                state_event.drain();
+            } else if (fd == server_fd) {
+                sockaddr_in from{};
+                socklen_t from_len = sizeof(from);
+                int sock;
+                while ((sock = accept4(server_fd, (sockaddr*)&from, &from_len,
+                                       SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    from_len = sizeof(from);
+                    int slot = find_client(-1);
+                    if (slot < 0) {
+                        std::cout << "[Network] Client limit reached, connection refused" << std::endl;
+                        close(sock);
+                        continue;
+                    }
+
+                    // TCP_NODELAY
+                    int flag = 1;
+                    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (char *)&flag, sizeof(int));
+                    // Bounded kernel buffer: a client that stops reading shows up as
+                    // a tx backlog within a fraction of a second instead of megabytes later
+                    int sndbuf = SOCKET_SNDBUF;
+                    setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+                    TcpClient& client = clients[slot];
+                    client.reset(sock, next_id++, from);
+                    lost[slot] = false;
+                    watch(ep, EPOLL_CTL_ADD, sock, EPOLLIN | EPOLLRDHUP);
+
+                    char ip[INET_ADDRSTRLEN];
+                    inet_ntop(AF_INET, &from.sin_addr, ip, sizeof(ip));
+                    std::cout << "[Network] Client #" << client.id << " connected from "
+                              << ip << ":" << ntohs(from.sin_port) << std::endl;
+                }
+            } else {
+                int k = find_client(fd);
+                if (k < 0) continue;
+                if (ev & EPOLLIN) lost[k] = lost[k] || !clients[k].receive();
+                if (ev & EPOLLOUT) lost[k] = lost[k] || !clients[k].flush();
+                if (ev & (EPOLLERR | EPOLLHUP)) lost[k] = true;
+            }
+        }
+
+        // 1. Commands — handled before the state fan-out, so frames queued in this
+        // pass already carry a lease granted by the hello. Frames left over from a
+        // full RT queue are retried here, at the latest on the next state tick.
+        for (size_t k = 0; k < MAX_CLIENTS; k++) {
+            if (clients[k].fd < 0 || lost[k]) continue;
+            lost[k] = !clients[k].dispatch(ext_cmd_q, last_cmd_id, last_state, cmd_lease);
+        }
+
+        // 2. State — full-rate clients get every frame the RT loop queued, oldest
+        // first; decimated subscribers only the newest one, once it is due
+        bool have_state = false;
+        while (const GrsRobotState* state = s_q.peek()) {
+            last_state = toExternalState(*state);
+            s_q.commit_pop();
+            have_state = true;
+            for (auto& client : clients) {
+                if (client.fd >= 0 && client.interval == TcpClient::Clock::duration::zero()) {
+                    client.queueState(last_state);
                 }
-             
-            // 2. Command — recv 128-byte GrsRobotCommand from client
-            GrsRobotCommand extCmd;
-            int valread = recv(client_socket, &extCmd, sizeof(GrsRobotCommand), MSG_DONTWAIT);
-            
-            if (valread == (int)sizeof(GrsRobotCommand)) {
-                // Log the command
-                logGrsCommand(extCmd);
-
-                // Push to command queue for rt_loop processing
-                ext_cmd_q.push(extCmd);
-
-            } else if (valread == 0) {
-                // Client disconnected
-                break;
             }
-            // valread < 0 means EAGAIN (no data available) — normal for non-blocking
-            
-            // If queue is empty, relax the processor
-            if (!s_q.pop()) usleep(500);
-        }
-        close(client_socket);
-        
-        // Clear all outputs when client disconnects (safety)
-        GrsRobotCommand clearCmd{};
-        clearCmd.set_outputs = 0;
-        clearCmd.soft_stops = 0;
-        ext_cmd_q.push(clearCmd);
-        
-        std::cout << "[Network] Client disconnected. Outputs cleared." << std::endl;
+        }
+        auto now = TcpClient::Clock::now();
+        if (have_state) {
+            for (auto& client : clients) {
+                if (client.fd >= 0 && client.interval > TcpClient::Clock::duration::zero()) {
+                    client.publish(last_state, now);
+                }
+            }
+        }
+
+        // 3. Write out, then drop whoever left, was replaced or stopped reading
+        for (size_t k = 0; k < MAX_CLIENTS; k++) {
+            TcpClient& client = clients[k];
+            if (client.fd < 0) continue;
+            if (!lost[k]) lost[k] = !client.flush();
+            if (!lost[k] && client.stalled(now)) {
+                std::cout << "[Network] Client #" << client.id << " stopped reading state, closing connection"
+                          << std::endl;
+                lost[k] = true;
+            }
+            if (lost[k] || client.evicted) {
+                drop_client(client);
+                lost[k] = false;
+            } else {
+                client.updateInterest(ep);
+            }
+        }
     }
+
+    for (auto& client : clients) {
+        if (client.fd >= 0) drop_client(client);
+    }
+    close(ep);
     close(server_fd);
 }
+
+
+void udp_server_func(SPSCQueue<GrsRobotState, 128>& s_q,
+                     SPSCQueue<GrsRobotCommand, 128>& ext_cmd_q,
+                     std::atomic<bool>& abort_request,
+                     EventFd& state_event,
+                     std::atomic<bool>& run) {
+
+    int udp_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (udp_fd < 0) return;
+
+    int opt = 1;
+    setsockopt(udp_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    sockaddr_in address;
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(12345);
+
+    if (bind(udp_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        close(udp_fd);
+        return;
+    }
+
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if (ep < 0) {
+        close(udp_fd);
+        return;
+    }
+    watch(ep, EPOLL_CTL_ADD, udp_fd, EPOLLIN);
+    watch(ep, EPOLL_CTL_ADD, state_event.fd(), EPOLLIN);
+    epoll_event events[MAX_EVENTS];
+
+    std::cout << "[Network] UDP server listening on port 12345" << std::endl;
+    std::cout << "[Network] Unified 128-byte protocol, one frame per datagram" << std::endl;
+
+    const auto CLIENT_TIMEOUT = std::chrono::seconds(2);
+
+    sockaddr_in client{};
+    bool have_client = false;
+    auto last_rx = std::chrono::steady_clock::now();
+    uint64_t last_cmd_id = 0;   // highest cmd_id accepted in this session
+
+    while (run) {
+        int n_ev = epoll_wait(ep, events, MAX_EVENTS, 100);
+        if (n_ev < 0 && errno != EINTR) break;
+        for (int i = 0; i < n_ev; i++) {
+            if (events[i].data.fd == state_event.fd()) state_event.drain();
+        }
+
+        // 1. Commands — drain all pending datagrams
+        GrsRobotCommand extCmd;
+        sockaddr_in from{};
+        socklen_t from_len = sizeof(from);
+        ssize_t n;
+        while ((n = recvfrom(udp_fd, &extCmd, sizeof(extCmd), MSG_DONTWAIT,
+                             (sockaddr*)&from, &from_len)) >= 0) {
+            from_len = sizeof(from);
+            if (n != (ssize_t)sizeof(GrsRobotCommand)) continue;
+
+            if (!have_client || from.sin_addr.s_addr != client.sin_addr.s_addr ||
+                from.sin_port != client.sin_port) {
+                char ip[INET_ADDRSTRLEN];
+                inet_ntop(AF_INET, &from.sin_addr, ip, sizeof(ip));
+                std::cout << "[Network] UDP client " << ip << ":" << ntohs(from.sin_port)
+                          << " connected!" << std::endl;
+                client = from;
+                have_client = true;
+                last_cmd_id = 0;
+            }
+            last_rx = std::chrono::steady_clock::now();
+
+            // NOP is link control only (hello / keepalive), never forwarded.
+            // A hello carries the id before the client's first command, 0 if
+            // it does not know it yet (then its first command sets it).
+            if (extCmd.cmd_type == GRS_CMD_NOP) {
+                if (extCmd.flags & GRS_CMD_FLAG_HELLO) last_cmd_id = extCmd.cmd_id;
+                continue;
+            }
+
+            // seq_id acknowledges everything up to it, so only the next id in
+            // sequence may be accepted. A resend of something already queued
+            // (its ack got lost) is dropped, and so is anything after a lost
+            // datagram: the client resends from the lost one on.
+            if (last_cmd_id != 0 && extCmd.cmd_id != last_cmd_id + 1) continue;
+
+            // RT queue full, or the RT loop is about to drop it after a timeout:
+            // leave it unacknowledged, the client retransmits it
+            if (abort_request.load(std::memory_order_acquire) || !ext_cmd_q.push(extCmd)) continue;
+            last_cmd_id = extCmd.cmd_id;
+
+            logGrsCommand(extCmd);
+        }
+
+        // 2. State — skip to the newest frame, older ones are already stale
+        GrsRobotState latest{};
+        bool fresh = false;
+        while (s_q.pop(latest)) fresh = true;
+
+        if (fresh && have_client) {
+            GrsRobotState extState = toExternalState(latest);
+            sendto(udp_fd, &extState, sizeof(extState), MSG_DONTWAIT,
+                   (sockaddr*)&client, sizeof(client));
+        }
+
+        // 3. Silent client — same safety reaction as a TCP disconnect
+        if (have_client && std::chrono::steady_clock::now() - last_rx > CLIENT_TIMEOUT) {
+            have_client = false;
+            abortClient(abort_request);
+
+            std::cout << "[Network] UDP client timed out. Outputs cleared." << std::endl;
+        }
+    }
+    close(ep);
+    close(udp_fd);
+}
@@ -0,0 +1,85 @@
+#include "pc_ecrt/rt_config.hpp"
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <alloca.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+// std::thread stacks are 8 MB, stay well inside
+constexpr size_t MAX_STACK_PREFAULT_KB = 4096;
+
+void touchPages(volatile char* p, size_t bytes) {
+    long page = sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < bytes; i += page) p[i] = 0;
+}
+
+}
+
+
+void RtConfig::print(std::ostream& os) const {
+    os << "RT thread: SCHED_FIFO " << priority << ", period " << period_us << " us, ";
+    if (cpu >= 0) os << "CPU " << cpu;
+    else os << "not pinned";
+    os << ", stack prefault " << stack_prefault_kb << " KiB, heap prefault " << heap_prefault_mb
+       << " MiB" << std::endl;
+}
+
+void prepareRtProcess(const RtConfig& config) {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) == -1) {
+        std::cerr << "mlockall failed! Run with sudo." << std::endl;
+    }
+
+    // One arena, never trimmed, never mmap'ed per allocation: memory touched here
+    // stays resident and is what later allocations get
+    mallopt(M_ARENA_MAX, 1);
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    if (config.heap_prefault_mb) {
+        size_t bytes = config.heap_prefault_mb << 20;
+        if (char* heap = static_cast<char*>(std::malloc(bytes))) {
+            touchPages(heap, bytes);
+            std::free(heap);
+        } else {
+            std::cerr << "Heap prefault of " << config.heap_prefault_mb << " MiB failed" << std::endl;
+        }
+    }
+
+    if (config.cpu < 0) return;
+    cpu_set_t others;
+    CPU_ZERO(&others);
+    if (sched_getaffinity(0, sizeof(others), &others) != 0 || !CPU_ISSET(config.cpu, &others)) {
+        std::cerr << "CPU " << config.cpu << " is not available to this process" << std::endl;
+        return;
+    }
+    CPU_CLR(config.cpu, &others);
+    if (CPU_COUNT(&others) == 0) {
+        std::cerr << "CPU " << config.cpu << " is the only one, other threads share it" << std::endl;
+        return;
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(others), &others);
+}
+
+void prepareRtThread(const RtConfig& config) {
+    if (config.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(config.cpu, &set);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err) std::cerr << "Pinning the RT thread to CPU " << config.cpu << " failed: " << std::strerror(err) << std::endl;
+    }
+
+    struct sched_param param;
+    param.sched_priority = config.priority;
+    int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (err) std::cerr << "SCHED_FIFO " << config.priority << " failed: " << std::strerror(err) << std::endl;
+
+    // Fault the stack in now rather than on the first deep call in the loop
+    size_t kb = config.stack_prefault_kb < MAX_STACK_PREFAULT_KB ? config.stack_prefault_kb : MAX_STACK_PREFAULT_KB;
+    if (kb) touchPages(static_cast<volatile char*>(alloca(kb << 10)), kb << 10);
+}
@@ -0,0 +1,133 @@
+#include "pc_ecrt/rt_log.hpp"
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <unistd.h>
+
+namespace {
+
+const char* coordNames[] = {"X","Y","Z","A","B","C"};
+const char* axisNames[]  = {"A1","A2","A3","A4","A5","A6"};
+
+void printSix(std::ostream& os, const char* label, const char* const names[], const double v[6]) {
+    os << label << "={";
+    for (int i = 0; i < 6; i++) {
+        if (i > 0) os << ", ";
+        os << names[i] << "=" << std::fixed << std::setprecision(2) << v[i];
+    }
+    os << "}";
+}
+
+}
+
+
+RtLogRecord* RtLog::slot(uint64_t cycle, uint64_t cmd_id, uint8_t kind) {
+    RtLogRecord* r = ring_.prepare_push();
+    if (!r) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    r->cycle = cycle;
+    r->cmd_id = cmd_id;
+    r->kind = kind;
+    r->cmd_type = GRS_CMD_NOP;
+    r->parts = 0;
+    r->text = nullptr;
+    r->value = 0.0;
+    return r;
+}
+
+void RtLog::text(uint64_t cycle, const char* literal) {
+    if (RtLogRecord* r = slot(cycle, 0, RT_LOG_TEXT)) {
+        r->text = literal;
+        ring_.commit_push();
+    }
+}
+
+void RtLog::motion(uint64_t cycle, const GrsRobotCommand& cmd, uint8_t parts) {
+    if (RtLogRecord* r = slot(cycle, cmd.cmd_id, RT_LOG_MOTION)) {
+        r->cmd_type = cmd.cmd_type;
+        r->parts = parts;
+        std::memcpy(r->a, cmd.coords, sizeof(r->a));
+        std::memcpy(r->b, cmd.axes, sizeof(r->b));
+        ring_.commit_push();
+    }
+}
+
+void RtLog::pose(uint64_t cycle, uint64_t cmd_id, uint8_t parts, const double pos[6], const double axes[6]) {
+    if (RtLogRecord* r = slot(cycle, cmd_id, RT_LOG_POSE)) {
+        r->parts = parts;
+        std::memcpy(r->a, pos, sizeof(r->a));
+        std::memcpy(r->b, axes, sizeof(r->b));
+        ring_.commit_push();
+    }
+}
+
+void RtLog::wait(uint64_t cycle, uint64_t cmd_id, double ms) {
+    if (RtLogRecord* r = slot(cycle, cmd_id, RT_LOG_WAIT)) {
+        r->cmd_type = GRS_CMD_WAIT;
+        r->value = ms;
+        ring_.commit_push();
+    }
+}
+
+void RtLog::error(uint64_t cycle, uint64_t cmd_id, const char* reason) {
+    if (RtLogRecord* r = slot(cycle, cmd_id, RT_LOG_ERROR)) {
+        r->text = reason;
+        ring_.commit_push();
+    }
+}
+
+size_t RtLog::drain(std::ostream& os) {
+    size_t count = 0;
+    while (const RtLogRecord* r = ring_.peek()) {
+        switch (r->kind) {
+            case RT_LOG_TEXT:
+                os << "[RT] " << r->text;
+                break;
+            case RT_LOG_MOTION:
+                os << "  [RT MOTION] " << grsCommandTypeName(r->cmd_type) << " #" << r->cmd_id;
+                if (r->parts & RT_LOG_COORDS) printSix(os, " target", coordNames, r->a);
+                if (r->parts & RT_LOG_AXES) printSix(os, " target_axes", axisNames, r->b);
+                break;
+            case RT_LOG_POSE:
+                if (r->parts & RT_LOG_COORDS) printSix(os, "  [RT POS]    global", coordNames, r->a);
+                if (r->parts == (RT_LOG_COORDS | RT_LOG_AXES)) os << "\n";
+                if (r->parts & RT_LOG_AXES) printSix(os, "  [RT AXES]   global", axisNames, r->b);
+                break;
+            case RT_LOG_WAIT:
+                os << "  [RT WAIT]   #" << r->cmd_id << " duration=" << std::fixed
+                   << std::setprecision(0) << r->value << "ms";
+                break;
+            case RT_LOG_ERROR:
+                os << "  [RT ERROR]  #" << r->cmd_id << " " << r->text;
+                break;
+            default:
+                os << "  [RT] unknown log record kind " << int(r->kind);
+                break;
+        }
+        os << "  (cycle " << r->cycle << ")\n";
+        ring_.commit_pop();
+        count++;
+    }
+    if (count) os.flush();
+    return count;
+}
+
+void rt_log_func(RtLog& log, std::atomic<bool>& run) {
+    uint64_t reported = 0;
+    auto report_drops = [&]() {
+        uint64_t dropped = log.dropped();
+        if (dropped != reported) {
+            std::cout << "[RT] " << (dropped - reported) << " log record(s) dropped, ring full" << std::endl;
+            reported = dropped;
+        }
+    };
+    while (run) {
+        log.drain(std::cout);
+        report_drops();
+        usleep(10000);
+    }
+    log.drain(std::cout);
+    report_drops();
+}
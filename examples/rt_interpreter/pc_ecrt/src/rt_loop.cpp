@@ -1,102 +1,32 @@
-#include <iostream>
-#include <iomanip>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
-#include <ecrt.h>
+#include "pc_ecrt/ec_master.hpp"
+#include "pc_ecrt/dc_clock.hpp"
+#include "pc_ecrt/rt_config.hpp"
+#include "pc_ecrt/rt_log.hpp"
+#include "pc_ecrt/cycle_stats.hpp"
+#include "pc_ecrt/sequencer.hpp"
 #include "protocol.hpp"
 #include "spsc_queue.hpp"
+#include "event_fd.hpp"
 #include "bitset.hpp"
 
 namespace{
-    
-ec_master_t *master = NULL;
-ec_domain_t *domain = NULL;
-uint8_t *domain_pd = NULL;
-
-unsigned int off_el1008_in;
-unsigned int off_el2008_out;
-  
-ec_pdo_entry_reg_t domain_regs[] = {
-    {0, 1, 0x00000002, 0x03f03052, 0x6000, 0x01, &off_el1008_in},
-    {0, 2, 0x00000002, 0x07d83052, 0x7000, 0x01, &off_el2008_out},
-    {}
-};  
-    
-double g_pos[6]  = {0,0,0,0,0,0};  // X, Y, Z, A, B, C
-double g_axes[6] = {0,0,0,0,0,0};  // A1, A2, A3, A4, A5, A6
-   
-// Update global position from a motion command and log the change
-void updateAndLogPosition(const GrsRobotCommand& cmd) {
-    const char* coordNames[] = {"X","Y","Z","A","B","C"};
-    const char* axisNames[]  = {"A1","A2","A3","A4","A5","A6"};
-
-    // Check which fields this command carries
-    bool hasCoords = false, hasAxes = false;
-    for (int i = 0; i < 6; i++) {
-        if (cmd.coords[i] != 0.0) hasCoords = true;
-        if (cmd.axes[i] != 0.0) hasAxes = true;
-    }
 
-    // Determine if relative motion
-    bool isRelative = (cmd.cmd_type == GRS_CMD_PTP_REL ||
-                       cmd.cmd_type == GRS_CMD_LIN_REL ||
-                       cmd.cmd_type == GRS_CMD_CIRC_REL ||
-                       cmd.cmd_type == GRS_CMD_SPLINE_REL);
-
-    // Update global position
-    if (hasCoords) {
-        for (int i = 0; i < 6; i++) {
-            if (isRelative)
-                g_pos[i] += cmd.coords[i];
-            else if (cmd.coords[i] != 0.0)
-                g_pos[i] = cmd.coords[i];
-        }
-    }
-    if (hasAxes) {
-        for (int i = 0; i < 6; i++) {
-            if (isRelative)
-                g_axes[i] += cmd.axes[i];
-            else if (cmd.axes[i] != 0.0)
-                g_axes[i] = cmd.axes[i];
-        }
-    }
+int64_t elapsedNs(const timespec& from, const timespec& to) {
+    return (int64_t)(to.tv_sec - from.tv_sec) * 1000000000 + (to.tv_nsec - from.tv_nsec);
+}
 
-    // Log the command target
-    std::cout << "  [RT MOTION] " << grsCommandTypeName(cmd.cmd_type);
-    if (hasCoords) {
-        std::cout << " target={";
-        for (int i = 0; i < 6; i++) {
-            if (i > 0) std::cout << ", ";
-            std::cout << coordNames[i] << "=" << std::fixed << std::setprecision(2) << cmd.coords[i];
-        }
-        std::cout << "}";
-    }
-    if (hasAxes) {
-        std::cout << " target_axes={";
-        for (int i = 0; i < 6; i++) {
-            if (i > 0) std::cout << ", ";
-            std::cout << axisNames[i] << "=" << std::fixed << std::setprecision(2) << cmd.axes[i];
-        }
-        std::cout << "}";
-    }
-    std::cout << std::endl;
-
-    // Log the current global position after update
-    if (hasCoords) {
-        std::cout << "  [RT POS]    global={";
-        for (int i = 0; i < 6; i++) {
-            if (i > 0) std::cout << ", ";
-            std::cout << coordNames[i] << "=" << std::fixed << std::setprecision(2) << g_pos[i];
-        }
-        std::cout << "}" << std::endl;
-    }
-    if (hasAxes) {
-        std::cout << "  [RT AXES]   global={";
-        for (int i = 0; i < 6; i++) {
-            if (i > 0) std::cout << ", ";
-            std::cout << axisNames[i] << "=" << std::fixed << std::setprecision(2) << g_axes[i];
-        }
-        std::cout << "}" << std::endl;
-    }
+uint64_t toNs(const timespec& t) {
+    return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+timespec fromNs(uint64_t ns) {
+    timespec t;
+    t.tv_sec = ns / 1000000000ULL;
+    t.tv_nsec = ns % 1000000000ULL;
+    return t;
 }
 
 
@@ -105,37 +35,60 @@ void updateAndLogPosition(const GrsRobotCommand& cmd) {
 
 void rt_loop_func(SPSCQueue<GrsRobotState, 128>& s_q,
                   SPSCQueue<GrsRobotCommand, 128>& ext_cmd_q,
+                  std::atomic<bool>& abort_request,
+                  EventFd& state_event,
+                  RtLog& log,
+                  CycleStats& stats,
+                  EcMaster& ec,
+                  const RtConfig& config,
+                  const DcConfig& dc,
                   std::atomic<bool>& run)
 {
-    master = ecrt_request_master(0);
-    if (!master) return;
-    domain = ecrt_master_create_domain(master);
-    if (!domain || ecrt_domain_reg_pdo_entry_list(domain, domain_regs)) return;
-    if (ecrt_master_activate(master)) return;
-    domain_pd = ecrt_domain_data(domain);
+    if (!ec.activate()) {
+        run = false;
+        return;
+    }
 
     struct timespec wakeup_time;
     clock_gettime(CLOCK_MONOTONIC, &wakeup_time);
-    const uint64_t PERIOD_NS = 1000000; // 1ms
+    const uint64_t PERIOD_NS = config.periodNs();
+    stats.period_ns = PERIOD_NS;
+    struct timespec woke, finished;
 
-    uint8_t last_client_cmd = 0; 
-    uint64_t last_id = 0;
+    // With distributed clocks the wakeups sit on whole periods of application
+    // time, which DcClock keeps on the reference clock
+    DcClock dc_clock(PERIOD_NS);
+    uint64_t wakeup_ns = toNs(wakeup_time);
+    if (dc.enabled) wakeup_ns -= wakeup_ns % PERIOD_NS;
+    int64_t dc_step = 0;        // wakeup correction from the last reference clock sample
+    uint64_t dc_app_time = 0;   // application time the last frame went out with
 
-    std::cout << "[RT] Bridge Active. Mode: Hardware Interlock (EMG Priority)" << std::endl;
+    CommandSequencer seq(log, PERIOD_NS);
+    uint32_t frame_seq = 0;
+
+    uint64_t cycle = 0;
+
+    log.text(cycle, "Bridge Active. Mode: Hardware Interlock (EMG Priority)");
 
     while (run) {
-        wakeup_time.tv_nsec += PERIOD_NS;
-        while (wakeup_time.tv_nsec >= 1000000000) {
-            wakeup_time.tv_sec++;
-            wakeup_time.tv_nsec -= 1000000000;
-        }
+        wakeup_ns += PERIOD_NS + dc_step;
+        wakeup_time = fromNs(wakeup_ns);
         clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup_time, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &woke);
+        cycle++;
+
+        ec.receive();
 
-        ecrt_master_receive(master);
-        ecrt_domain_process(domain);
+        // --- 0. distributed clocks: compare the last frame's application time
+        //        with the reference clock it came back with ---
+        if (dc.enabled && dc.follow_reference) {
+            uint32_t ref_time;
+            bool valid = dc_app_time != 0 && ec.referenceClockTime(ref_time);
+            dc_step = dc_clock.update(dc_app_time, ref_time, valid);
+        }
 
         // --- 1. (EL1008) ---
-        uint8_t raw_input = *(domain_pd + off_el1008_in);
+        uint8_t raw_input = ec.readInputs();
         
         // Log IN: if see 00000001 (not pressed), that is NC button.
         // NC Button logic: 1 = (SAFE), 0 = (EMG)
@@ -148,67 +101,82 @@ void rt_loop_func(SPSCQueue<GrsRobotState, 128>& s_q,
         //     last_id = cmd->cmd_id;
         // }
 
-        // --- 2b. Extended GRS Commands (Motion/Wait) ---
-        auto ext_cmd = ext_cmd_q.pop();
-        if (ext_cmd) {
-            last_id = ext_cmd->cmd_id;
-            
-            // Handle I/O commands via set_outputs
-            if (ext_cmd->cmd_type == GRS_CMD_OUTPUT || 
-                ext_cmd->cmd_type == GRS_CMD_SET_ALL_OUTPUTS) {
-                // Update output byte from extended command
-                if (ext_cmd->cmd_type == GRS_CMD_OUTPUT) {
-                    if (ext_cmd->io_value)
-                        last_client_cmd |= (1u << ext_cmd->io_index);
-                    else
-                        last_client_cmd &= ~(1u << ext_cmd->io_index);
-                } else {
-                    last_client_cmd = ext_cmd->set_outputs;
-                }
-            }
-            
-            // Log and update global position for motion commands
-            if (ext_cmd->cmd_type >= GRS_CMD_PTP && 
-                ext_cmd->cmd_type <= GRS_CMD_SPLINE_REL) {
-                updateAndLogPosition(*ext_cmd);
-            }
-            
-            // Log WAIT commands
-            if (ext_cmd->cmd_type == GRS_CMD_WAIT) {
-                std::cout << "  [RT WAIT]   duration=" << std::fixed 
-                          << std::setprecision(0) << ext_cmd->wait_time << "ms" << std::endl;
+        // --- 2a. Client gone: the safety reaction overtakes the queue instead of
+        //         waiting behind the departed client's WAITs and motions ---
+        if (abort_request.load(std::memory_order_acquire)) {
+            uint64_t last_id = 0;
+            while (const GrsRobotCommand* dropped = ext_cmd_q.peek()) {
+                last_id = std::max<uint64_t>(last_id, dropped->cmd_id);
+                ext_cmd_q.commit_pop();
             }
+            seq.abort(cycle, last_id);
+            abort_request.store(false, std::memory_order_release);
         }
 
+        // --- 2b. Extended GRS Commands (Motion/Wait) ---
+        // Read in place, the slot is released once the sequencer takes the
+        // command; one it cannot take yet stays queued (backpressure to the client)
+        if (const GrsRobotCommand* ext_cmd = ext_cmd_q.peek()) {
+            if (seq.offer(*ext_cmd, cycle, is_system_safe)) ext_cmd_q.commit_pop();
+        }
+
+        // --- 2c. WAIT deadline and interpolation, one cycle ---
+        seq.step(cycle, is_system_safe);
+
         // --- 3. priority ---
         uint8_t final_output = 0;
 
         if (is_system_safe) {
             // if it is just safety, client said it happened
-            final_output = last_client_cmd;
+            final_output = seq.outputs();
         } else {
             // if button  is pressed, output: 0!
             final_output = 0;
-            // Not: last_client_cmd  is not zero, when safety is fixed, and client says ON, it can continues 
+            // Not: seq.outputs() is not zero, when safety is fixed, and client says ON, it can continues 
         }
 
         // --- 4. (EL2008) ---
-        *(domain_pd + off_el2008_out) = final_output;
+        ec.writeOutputs(final_output);
 
         // --- 5. feedback ---
-        GrsRobotState st{};
-        st.seq_id = last_id;
-        st.timestamp = (uint32_t)wakeup_time.tv_nsec;
-        st.inputs = raw_input;
-        st.outputs = final_output;
-        st.is_hardware_emg = !is_system_safe; 
-        st.system_ready = is_system_safe; 
-        
-        s_q.push(st);
+        // Built directly in the queue slot. A full queue drops the frame,
+        // the network side sees the gap in frame_seq.
+        ++frame_seq;
+        if (GrsRobotState* st = s_q.prepare_push()) {
+            *st = GrsRobotState{};
+            st->seq_id = seq.acceptedId();
+            st->done_cmd_id = seq.doneId();
+            st->cmd_ack = seq.lastType();
+            st->cmd_status = seq.status();
+            st->failed_count = seq.failedCount();
+            st->inputs = raw_input;
+            st->outputs = final_output;
+            st->is_hardware_emg = !is_system_safe; 
+            st->system_ready = is_system_safe; 
+            st->frame_seq = frame_seq;
+            for (int i = 0; i < 6; i++) {
+                st->current_pos[i] = seq.trajectory().pos()[i];
+                st->current_axes[i] = seq.trajectory().axes()[i];
+            }
+            s_q.commit_push();
+        }
+        state_event.notify();  // wake the network thread
+
+        if (dc.enabled) {
+            timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            dc_app_time = dc_clock.appTime(toNs(now));
+            ec.syncClocks(dc_app_time, !dc.follow_reference);
+            // Drives sample at SYNC0, sync0_shift_ns into the cycle: the frame must be out by then
+            stats.recordDc(dc_clock.offsetNs(), elapsedNs(wakeup_time, now) > (int64_t)dc.sync0_shift_ns);
+        }
+        ec.send();
 
-        ecrt_domain_queue(domain);
-        ecrt_master_send(master);
+        // --- 6. timing: wakeup lateness, work done, overrun of the next deadline ---
+        clock_gettime(CLOCK_MONOTONIC, &finished);
+        int64_t late = elapsedNs(wakeup_time, woke);
+        stats.record(late > 0 ? (uint64_t)late : 0, (uint64_t)elapsedNs(woke, finished));
     }
-    ecrt_release_master(master);
+    ec.release();
 }
 
@@ -0,0 +1,136 @@
+#include "pc_ecrt/sequencer.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Longest WAIT accepted, about 11 days
+constexpr double MAX_WAIT_MS = 1e9;
+
+}
+
+
+CommandSequencer::CommandSequencer(RtLog& log, uint64_t period_ns)
+    : log_(log), period_ns_(period_ns), traj_(period_ns * 1e-9) {}
+
+uint8_t CommandSequencer::status() const {
+    if (accepted_id_ == 0) return GRS_STATUS_IDLE;
+    if (failed_count_ != 0) return GRS_STATUS_ERROR;
+    return done_id_ == accepted_id_ ? GRS_STATUS_DONE : GRS_STATUS_EXECUTING;
+}
+
+// Reason as a string literal (it goes to the RT log as is), nullptr if valid
+const char* CommandSequencer::invalid(const GrsRobotCommand& cmd) {
+    if (cmd.cmd_type > GRS_CMD_SET_ALL_OUTPUTS) return "unknown command type";
+    if (cmd.cmd_type == GRS_CMD_OUTPUT && cmd.io_index >= 8) return "output index out of range";
+    if (cmd.cmd_type == GRS_CMD_WAIT &&
+        !(cmd.wait_time >= 0.0 && cmd.wait_time <= MAX_WAIT_MS)) return "invalid wait time";
+    if (TrajectoryPlanner::isMotion(cmd.cmd_type)) {
+        for (int i = 0; i < 6; i++) {
+            if (!std::isfinite(cmd.coords[i]) || !std::isfinite(cmd.axes[i])) return "non-finite target";
+        }
+    }
+    return nullptr;
+}
+
+bool CommandSequencer::offer(const GrsRobotCommand& cmd, uint64_t cycle, bool safe) {
+    bool motion = TrajectoryPlanner::isMotion(cmd.cmd_type);
+    const char* reason = invalid(cmd);
+    if (!reason && motion && !safe) reason = "emergency stop active";
+
+    if (reason) {
+        if (!idle()) return false;   // fail in order
+        accept(cmd);
+        log_.error(cycle, cmd.cmd_id, reason);
+        finish(cmd.cmd_id, false);
+        return true;
+    }
+
+    if (motion) {
+        // Motions look ahead past each other, never past a WAIT
+        if (wait_id_ != 0 || !traj_.push(cmd)) return false;
+        accept(cmd);
+        motion_id_ = cmd.cmd_id;
+        uint8_t parts = 0;
+        bool circ = cmd.cmd_type == GRS_CMD_CIRC || cmd.cmd_type == GRS_CMD_CIRC_REL;
+        for (int i = 0; i < 6; i++) {
+            if (cmd.coords[i] != 0.0) parts |= RT_LOG_COORDS;
+            if (cmd.axes[i] != 0.0 && !circ) parts |= RT_LOG_AXES;  // CIRC: axes = aux point
+        }
+        log_.motion(cycle, cmd, parts);
+        return true;
+    }
+
+    if (!idle()) return false;
+    accept(cmd);
+    switch (cmd.cmd_type) {
+        case GRS_CMD_WAIT:
+            wait_id_ = cmd.cmd_id;
+            wait_until_ = cycle + static_cast<uint64_t>(std::ceil(cmd.wait_time * 1e6 / period_ns_));
+            log_.wait(cycle, cmd.cmd_id, cmd.wait_time);
+            break;
+        case GRS_CMD_OUTPUT:
+            if (cmd.io_value) outputs_ |= (1u << cmd.io_index);
+            else outputs_ &= ~(1u << cmd.io_index);
+            finish(cmd.cmd_id, true);
+            break;
+        case GRS_CMD_SET_ALL_OUTPUTS:
+            outputs_ = cmd.set_outputs;
+            finish(cmd.cmd_id, true);
+            break;
+        default:
+            finish(cmd.cmd_id, true);
+            break;
+    }
+    return true;
+}
+
+void CommandSequencer::step(uint64_t cycle, bool safe) {
+    if (!safe && !traj_.idle()) {
+        // Motions finish in order and nothing passes them, so the one in
+        // progress is the next id after done_id_ and the last one queued is
+        // motion_id_: all of them fail together
+        traj_.abort();
+        log_.error(cycle, motion_id_, "motion aborted by emergency stop");
+        fail(done_id_ + 1, motion_id_);
+    }
+
+    if (wait_id_ != 0 && cycle >= wait_until_) {
+        finish(wait_id_, true);
+        wait_id_ = 0;
+    }
+
+    TrajectoryEvent reached = traj_.step();
+    if (reached.cmd_id != 0) {
+        log_.pose(cycle, reached.cmd_id, reached.parts, traj_.pos(), traj_.axes());
+        finish(reached.cmd_id, true);
+    }
+}
+
+void CommandSequencer::abort(uint64_t cycle, uint64_t last_id) {
+    traj_.abort();
+    wait_id_ = 0;
+    outputs_ = 0;
+    last_id = std::max(last_id, accepted_id_);
+    if (last_id > done_id_) {
+        // The dropped commands count as accepted, so the range reads as failed
+        log_.error(cycle, last_id, "aborted, client gone");
+        accepted_id_ = last_id;
+        fail(done_id_ + 1, last_id);
+    }
+}
+
+void CommandSequencer::accept(const GrsRobotCommand& cmd) {
+    accepted_id_ = cmd.cmd_id;
+    last_type_ = cmd.cmd_type;
+}
+
+void CommandSequencer::finish(uint64_t cmd_id, bool ok) {
+    done_id_ = cmd_id;
+    failed_count_ = ok ? 0 : 1;
+}
+
+void CommandSequencer::fail(uint64_t first_id, uint64_t last_id) {
+    done_id_ = last_id;
+    failed_count_ = static_cast<uint32_t>(last_id - first_id + 1);
+}
@@ -0,0 +1,244 @@
+#include "pc_ecrt/trajectory.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr double EPS = 1e-9;
+constexpr double PI = 3.14159265358979323846;
+
+bool isRelative(uint8_t type) {
+    return type == GRS_CMD_PTP_REL || type == GRS_CMD_LIN_REL ||
+           type == GRS_CMD_CIRC_REL || type == GRS_CMD_SPLINE_REL;
+}
+
+bool isCirc(uint8_t type) {
+    return type == GRS_CMD_CIRC || type == GRS_CMD_CIRC_REL;
+}
+
+bool anySet(const double v[6], int n = 6) {
+    for (int i = 0; i < n; i++) {
+        if (v[i] != 0.0) return true;
+    }
+    return false;
+}
+
+// Zero means "keep" for absolute targets, relative targets always add
+void target(const double start[6], const double cmd[6], bool relative, double out[6]) {
+    for (int i = 0; i < 6; i++) {
+        if (relative) out[i] = start[i] + cmd[i];
+        else out[i] = (cmd[i] != 0.0) ? cmd[i] : start[i];
+    }
+}
+
+double dot(const double a[3], const double b[3]) { return a[0]*b[0] + a[1]*b[1] + a[2]*b[2]; }
+
+void cross(const double a[3], const double b[3], double out[3]) {
+    out[0] = a[1]*b[2] - a[2]*b[1];
+    out[1] = a[2]*b[0] - a[0]*b[2];
+    out[2] = a[0]*b[1] - a[1]*b[0];
+}
+
+}
+
+
+void MotionProfile::plan(ProfileShape shape, double vel, double acc, double jerk) {
+    struct Phase { double t, a0, j; };
+    Phase phase[7];
+    int n = 0;
+
+    if (shape == ProfileShape::TRAPEZOID) {
+        if (vel * vel / acc > 1.0) vel = std::sqrt(acc);     // triangle, no cruise
+        double ta = vel / acc;
+        double tc = (1.0 - vel * vel / acc) / vel;
+        phase[n++] = {ta, acc, 0.0};
+        phase[n++] = {tc, 0.0, 0.0};
+        phase[n++] = {ta, -acc, 0.0};
+    } else {
+        // Accel + decel distance when cruising at v; a is capped where the jerk
+        // ramps alone already reach v
+        auto peakAcc = [&](double v) { return std::min(acc, std::sqrt(v * jerk)); };
+        auto rampDistance = [&](double v) { double a = peakAcc(v); return v * (v / a + a / jerk); };
+        if (rampDistance(vel) > 1.0) {
+            double lo = 0.0, hi = vel;
+            for (int i = 0; i < 60; i++) {
+                double mid = 0.5 * (lo + hi);
+                (rampDistance(mid) > 1.0 ? hi : lo) = mid;
+            }
+            vel = lo;
+        }
+        double a = peakAcc(vel);
+        double tj = a / jerk;
+        double tca = std::max(0.0, vel / a - tj);
+        double tc = std::max(0.0, (1.0 - rampDistance(vel)) / vel);
+        phase[n++] = {tj, 0.0, jerk};
+        phase[n++] = {tca, a, 0.0};
+        phase[n++] = {tj, a, -jerk};
+        phase[n++] = {tc, 0.0, 0.0};
+        phase[n++] = {tj, 0.0, -jerk};
+        phase[n++] = {tca, -a, 0.0};
+        phase[n++] = {tj, -a, jerk};
+    }
+
+    // Integrate the phases into cubic pieces, skipping empty ones
+    double s = 0.0, v = 0.0, t = 0.0;
+    pieces = 0;
+    for (int i = 0; i < n; i++) {
+        const Phase& ph = phase[i];
+        if (ph.t <= 0.0) continue;
+        Piece& p = piece[pieces++];
+        p.t0 = t;
+        p.t_end = t + ph.t;
+        p.c[0] = s;
+        p.c[1] = v;
+        p.c[2] = ph.a0 / 2.0;
+        p.c[3] = ph.j / 6.0;
+        s += ph.t * (v + ph.t * (ph.a0 / 2.0 + ph.t * ph.j / 6.0));
+        v += ph.t * (ph.a0 + ph.t * ph.j / 2.0);
+        t = p.t_end;
+    }
+    duration = t;
+}
+
+
+TrajectoryPlanner::TrajectoryPlanner(double dt, const TrajectoryLimits& limits)
+    : dt_(dt), limits_(limits) {}
+
+bool TrajectoryPlanner::push(const GrsRobotCommand& cmd) {
+    if (full()) return false;
+
+    Segment& seg = ring_[(head_ + count_) % MAX_SEGMENTS];
+    bool relative = isRelative(cmd.cmd_type);
+    bool circ = isCirc(cmd.cmd_type);
+    bool hasCoords = anySet(cmd.coords);
+    bool hasAxes = !circ && anySet(cmd.axes);   // CIRC: axes hold the aux point
+
+    seg.cmd_id = cmd.cmd_id;
+    seg.parts = (hasCoords ? 0x01 : 0) | (hasAxes ? 0x02 : 0);
+    seg.geometry = LINEAR;
+
+    std::copy(end_pos_, end_pos_ + 6, seg.start_pos);
+    std::copy(end_axes_, end_axes_ + 6, seg.start_axes);
+    if (hasCoords) target(end_pos_, cmd.coords, relative, end_pos_);
+    if (hasAxes) target(end_axes_, cmd.axes, relative, end_axes_);
+    for (int i = 0; i < 6; i++) {
+        seg.delta_pos[i] = end_pos_[i] - seg.start_pos[i];
+        seg.delta_axes[i] = end_axes_[i] - seg.start_axes[i];
+    }
+
+    double path = std::sqrt(dot(seg.delta_pos, seg.delta_pos));
+
+    // Arc through the aux point: circumcenter of start, aux, end
+    if (circ && hasCoords && anySet(cmd.axes, 3)) {
+        const double* p0 = seg.start_pos;
+        double aux[3], a[3], b[3], n[3];
+        for (int i = 0; i < 3; i++) {
+            aux[i] = relative ? p0[i] + cmd.axes[i] : cmd.axes[i];
+            a[i] = aux[i] - p0[i];
+            b[i] = end_pos_[i] - p0[i];
+        }
+        cross(a, b, n);
+        double nn = dot(n, n);
+        if (nn > EPS * dot(a, a) * dot(b, b)) {
+            double bn[3], na[3];
+            cross(b, n, bn);
+            cross(n, a, na);
+            double aa = dot(a, a), bb = dot(b, b);
+            double off[3];
+            for (int i = 0; i < 3; i++) {
+                off[i] = (aa * bn[i] + bb * na[i]) / (2.0 * nn);
+                seg.center[i] = p0[i] + off[i];
+            }
+            seg.radius = std::sqrt(dot(off, off));
+            // u points from the center to the start, v completes the plane in
+            // the direction of travel (start -> aux -> end turns about n)
+            double nlen = std::sqrt(nn);
+            for (int i = 0; i < 3; i++) {
+                seg.u[i] = -off[i] / seg.radius;
+                n[i] /= nlen;
+            }
+            cross(n, seg.u, seg.v);
+            double e[3] = {end_pos_[0] - seg.center[0], end_pos_[1] - seg.center[1], end_pos_[2] - seg.center[2]};
+            double sweep = std::atan2(dot(e, seg.v), dot(e, seg.u));
+            if (sweep <= 0.0) sweep += 2.0 * PI;
+            seg.sweep = sweep;
+            seg.geometry = ARC;
+            path = seg.radius * sweep;
+        }
+    }
+
+    // Scale every limit into path-parameter units; the slowest component sets the pace
+    double vel = std::numeric_limits<double>::infinity(), acc = vel, jerk = vel;
+    auto limit = [&](double dist, const AxisLimits& l) {
+        dist = std::fabs(dist);
+        if (dist < EPS) return;
+        vel = std::min(vel, l.vel / dist);
+        acc = std::min(acc, l.acc / dist);
+        jerk = std::min(jerk, l.jerk / dist);
+    };
+    limit(path, limits_.linear);
+    for (int i = 3; i < 6; i++) limit(seg.delta_pos[i], limits_.orientation);
+    for (int i = 0; i < 6; i++) limit(seg.delta_axes[i], limits_.joint);
+
+    if (std::isinf(vel)) {
+        seg.profile.pieces = 0;     // nothing moves, completes on the next tick
+        seg.profile.duration = 0.0;
+    } else {
+        seg.profile.plan(limits_.shape, vel, acc, jerk);
+    }
+
+    count_++;
+    return true;
+}
+
+TrajectoryEvent TrajectoryPlanner::step() {
+    TrajectoryEvent ev;
+    if (count_ == 0) return ev;
+
+    const Segment& seg = ring_[head_];
+    const MotionProfile& p = seg.profile;
+    t_ += dt_;
+    if (t_ >= p.duration) {
+        setpoint(seg, 1.0);
+        ev.cmd_id = seg.cmd_id;
+        ev.parts = seg.parts;
+        head_ = (head_ + 1) % MAX_SEGMENTS;
+        count_--;
+        t_ = 0.0;
+        piece_ = 0;
+        return ev;
+    }
+
+    while (piece_ < p.pieces - 1 && t_ > p.piece[piece_].t_end) piece_++;
+    const MotionProfile::Piece& pc = p.piece[piece_];
+    double tau = t_ - pc.t0;
+    setpoint(seg, ((pc.c[3] * tau + pc.c[2]) * tau + pc.c[1]) * tau + pc.c[0]);
+    return ev;
+}
+
+void TrajectoryPlanner::abort() {
+    head_ = 0;
+    count_ = 0;
+    t_ = 0.0;
+    piece_ = 0;
+    std::copy(pos_, pos_ + 6, end_pos_);
+    std::copy(axes_, axes_ + 6, end_axes_);
+}
+
+void TrajectoryPlanner::setpoint(const Segment& seg, double s) {
+    for (int i = 0; i < 6; i++) {
+        pos_[i] = seg.start_pos[i] + s * seg.delta_pos[i];
+        axes_[i] = seg.start_axes[i] + s * seg.delta_axes[i];
+    }
+    if (seg.geometry == ARC) {
+        if (s >= 1.0) {
+            // Land exactly on the commanded target
+            for (int i = 0; i < 3; i++) pos_[i] = seg.start_pos[i] + seg.delta_pos[i];
+            return;
+        }
+        double c = seg.radius * std::cos(s * seg.sweep);
+        double sn = seg.radius * std::sin(s * seg.sweep);
+        for (int i = 0; i < 3; i++) pos_[i] = seg.center[i] + c * seg.u[i] + sn * seg.v[i];
+    }
+}
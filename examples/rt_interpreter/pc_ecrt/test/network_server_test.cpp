@@ -0,0 +1,256 @@
+// Reads a non-zero interpolated setpoint back through the TCP and UDP
+// servers: the current_pos/current_axes the RT loop fills in must reach
+// clients unchanged. Then checks that the TCP command lease only moves to a
+// resume of the holder's session, and that losing the holder asks the RT loop
+// for the abort without waiting on the command queue. Binds port 12345, so no
+// bridge may be running.
+
+#include <poll.h>
+#include <thread>
+#include "pc_ecrt/network_server.hpp"
+
+namespace {
+
+SPSCQueue<GrsRobotState, 128> state_queue;
+SPSCQueue<GrsRobotCommand, 128> command_queue;
+std::atomic<bool> abort_request{false};
+
+using ServerFunc = void (*)(SPSCQueue<GrsRobotState, 128>&, SPSCQueue<GrsRobotCommand, 128>&,
+                            std::atomic<bool>&, EventFd&, std::atomic<bool>&);
+
+GrsRobotState setpoint() {
+    GrsRobotState st{};
+    st.system_ready = 1;
+    for (int i = 0; i < 6; i++) {
+        st.current_pos[i] = 100.25 + i;
+        st.current_axes[i] = -12.5 * (i + 1);
+    }
+    return st;
+}
+
+// One state frame from the RT loop
+void publishSetpoint(EventFd& state_event) {
+    if (GrsRobotState* slot = state_queue.prepare_push()) {
+        *slot = setpoint();
+        state_queue.commit_push();
+        state_event.notify();
+    }
+}
+
+// Feeds the setpoint as the RT loop would until a state frame arrives
+bool readBack(int fd, EventFd& state_event, GrsRobotState& out) {
+    for (int tries = 0; tries < 200; tries++) {
+        publishSetpoint(state_event);
+        pollfd pfd{fd, POLLIN, 0};
+        if (poll(&pfd, 1, 10) <= 0) continue;
+        return recv(fd, &out, sizeof(out), MSG_WAITALL) == static_cast<ssize_t>(sizeof(out));
+    }
+    return false;
+}
+
+sockaddr_in bridgeAddress() {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(12345);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return addr;
+}
+
+// A TCP connection that has sent one NOP, -1 if the server is not up yet
+int connectWithNop(uint8_t flags, uint64_t session) {
+    sockaddr_in addr = bridgeAddress();
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    GrsRobotCommand nop{};
+    nop.cmd_type = GRS_CMD_NOP;
+    nop.flags = flags;
+    nop.session = session;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        send(fd, &nop, sizeof(nop), MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(nop))) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Whether one of the next state frames carries the lease flag; the server may
+// take a few passes to read the NOP. Frames already queued are skipped.
+bool holdsLease(int fd, EventFd& state_event) {
+    uint8_t stale[4096];
+    while (recv(fd, stale, sizeof(stale), MSG_DONTWAIT) > 0) {}
+    for (int frames = 0; frames < 20; frames++) {
+        GrsRobotState st{};
+        if (!readBack(fd, state_event, st)) return false;
+        if (st.link_flags & GRS_LINK_LEASE) return true;
+    }
+    return false;
+}
+
+// True if the server closed fd
+bool closedByServer(int fd, EventFd& state_event) {
+    uint8_t buf[4096];
+    for (int tries = 0; tries < 100; tries++) {
+        publishSetpoint(state_event);  // keeps the server's loop turning
+        ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n == 0) return true;
+        usleep(5000);
+    }
+    return false;
+}
+
+// Stands in for the RT loop: whether the server asked it to drop the client's commands
+bool abortRequested() {
+    return abort_request.exchange(false);
+}
+
+bool checkLease() {
+    std::atomic<bool> run{true};
+    EventFd state_event;
+    std::thread thread(network_server_func, std::ref(state_queue), std::ref(command_queue),
+                       std::ref(abort_request), std::ref(state_event), std::ref(run));
+
+    int holder = -1;
+    for (int attempt = 0; attempt < 50 && holder < 0; attempt++) {
+        holder = connectWithNop(GRS_CMD_FLAG_HELLO, 1);
+        if (holder < 0) usleep(20000);
+    }
+    abortRequested();
+
+    const char* failure = nullptr;
+    int keepalive = connectWithNop(0, 0);
+    int other = connectWithNop(GRS_CMD_FLAG_HELLO, 2);
+    int stranger = connectWithNop(0, 3);
+    if (holder < 0 || !holdsLease(holder, state_event)) {
+        failure = "the first hello got no lease";
+    } else if (holdsLease(keepalive, state_event) || !holdsLease(holder, state_event)) {
+        failure = "a bare NOP took the lease";
+    } else if (holdsLease(other, state_event) || holdsLease(stranger, state_event) ||
+               !holdsLease(holder, state_event)) {
+        failure = "another session took the lease";
+    } else {
+        int resumed = connectWithNop(0, 1);
+        if (!holdsLease(resumed, state_event) || !closedByServer(holder, state_event)) {
+            failure = "the holder's resume did not get the lease";
+        } else if (abortRequested()) {
+            failure = "moving the lease to the resumed session cleared the outputs";
+        }
+        close(resumed);
+    }
+    for (int fd : {holder, keepalive, other, stranger}) close(fd);
+
+    run = false;
+    state_event.notify();
+    thread.join();
+
+    if (failure) {
+        std::cerr << "lease: " << failure << std::endl;
+        return false;
+    }
+    std::cout << "lease: only the holder's session resumes it" << std::endl;
+    return true;
+}
+
+// The holder leaves while the RT queue is full of its commands (a WAIT holds
+// them): the abort must be requested at once, not queued behind them
+bool checkAbort() {
+    GrsRobotCommand cmd;
+    while (command_queue.pop(cmd)) {}
+    GrsRobotCommand held{};
+    held.cmd_type = GRS_CMD_OUTPUT;
+    while (command_queue.push(held)) held.cmd_id++;
+    abort_request = false;
+
+    std::atomic<bool> run{true};
+    EventFd state_event;
+    std::thread thread(network_server_func, std::ref(state_queue), std::ref(command_queue),
+                       std::ref(abort_request), std::ref(state_event), std::ref(run));
+
+    int holder = -1;
+    for (int attempt = 0; attempt < 50 && holder < 0; attempt++) {
+        holder = connectWithNop(GRS_CMD_FLAG_HELLO, 7);
+        if (holder < 0) usleep(20000);
+    }
+    bool leased = holder >= 0 && holdsLease(holder, state_event);
+    close(holder);
+
+    bool requested = false;
+    for (int tries = 0; tries < 100 && !requested; tries++) {
+        publishSetpoint(state_event);
+        requested = abort_request.load();
+        usleep(5000);
+    }
+    // The server must still be serving: a new client gets state
+    int next = connectWithNop(GRS_CMD_FLAG_HELLO, 8);
+    GrsRobotState st{};
+    bool serving = next >= 0 && readBack(next, state_event, st);
+    close(next);
+
+    run = false;
+    state_event.notify();
+    thread.join();
+    while (command_queue.pop(cmd)) {}
+    abort_request = false;
+
+    if (!leased || !requested || !serving) {
+        std::cerr << "abort: " << (!leased ? "no lease" : !requested ? "not requested with a full queue"
+                                                                      : "server stopped serving") << std::endl;
+        return false;
+    }
+    std::cout << "abort: requested at once with a full queue" << std::endl;
+    return true;
+}
+
+bool check(const char* name, ServerFunc server, int type) {
+    std::atomic<bool> run{true};
+    EventFd state_event;
+    std::thread thread(server, std::ref(state_queue), std::ref(command_queue),
+                       std::ref(abort_request), std::ref(state_event), std::ref(run));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(12345);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    GrsRobotState got{};
+    bool ok = false;
+    // The server needs a moment to bind
+    for (int attempt = 0; attempt < 50 && !ok; attempt++) {
+        int fd = socket(AF_INET, type, 0);
+        if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            GrsRobotCommand hello{};
+            hello.cmd_type = GRS_CMD_NOP;
+            hello.flags = GRS_CMD_FLAG_HELLO;
+            ok = send(fd, &hello, sizeof(hello), MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof(hello)) &&
+                 readBack(fd, state_event, got);
+        }
+        close(fd);
+        if (!ok) usleep(20000);
+    }
+
+    run = false;
+    state_event.notify();
+    thread.join();
+
+    if (!ok) {
+        std::cerr << name << ": no state frame from the server" << std::endl;
+        return false;
+    }
+    GrsRobotState want = setpoint();
+    if (std::memcmp(got.current_pos, want.current_pos, sizeof(want.current_pos)) != 0 ||
+        std::memcmp(got.current_axes, want.current_axes, sizeof(want.current_axes)) != 0) {
+        std::cerr << name << ": setpoint lost, got x=" << got.current_pos[0]
+                  << " A1=" << got.current_axes[0] << std::endl;
+        return false;
+    }
+    std::cout << name << ": setpoint read back" << std::endl;
+    return true;
+}
+
+}
+
+int main() {
+    bool ok = check("tcp", network_server_func, SOCK_STREAM);
+    ok = check("udp", udp_server_func, SOCK_DGRAM) && ok;
+    ok = checkLease() && ok;
+    ok = checkAbort() && ok;
+    return ok ? 0 : 1;
+}
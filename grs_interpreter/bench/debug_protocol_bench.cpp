@@ -0,0 +1,156 @@
+// JSON vs binary grs_step debug protocol, the way an HMI uses it: poll
+// getVariables + getIO and wait for both answers.
+//
+//   round trip  client thread <-> protocol over a socketpair, requests/s
+//   encode      server side only, variables + io events to /dev/null, polls/s
+//
+// Usage: debug_protocol_bench [variables=40] [seconds per case=2]
+
+#include "debug/debug_protocol.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+using grs_debug::DebugRequest;
+
+namespace {
+
+grs_debug::VariableMap makeVariables(int n) {
+    grs_debug::VariableMap vars;
+    for (int i = 0; i < n; i++) {
+        std::string name = "VAR_" + std::to_string(i);
+        switch (i % 5) {
+            case 0: vars[name] = i * 7; break;
+            case 1: vars[name] = i * 1.25; break;
+            case 2: vars[name] = (i & 2) != 0; break;
+            case 3: vars[name] = common::Position{i * 1.0, 20.5, 300.25, 0.0, 90.0, 180.0}; break;
+            default: vars[name] = common::Axis{10.0, 20.0, 30.0, 40.0, 50.0, double(i)}; break;
+        }
+    }
+    return vars;
+}
+
+// Requests as the client would send them
+std::string requestBytes(bool binary, DebugRequest::Type type) {
+    if (!binary) {
+        return type == DebugRequest::Type::GET_VARIABLES ? "{\"cmd\":\"getVariables\"}\n" : "{\"cmd\":\"getIO\"}\n";
+    }
+    std::string frame(5, '\0');
+    uint32_t len = 1;
+    std::memcpy(&frame[0], &len, 4);
+    frame[4] = static_cast<char>(type);
+    return frame;
+}
+
+// Reads until `count` whole responses arrived; only the framing is parsed
+bool readResponses(int fd, bool binary, int count, std::string& buf, uint64_t& bytes) {
+    char chunk[65536];
+    while (count > 0) {
+        size_t used = 0;
+        while (count > 0) {
+            if (binary) {
+                if (buf.size() - used < 4) break;
+                uint32_t len;
+                std::memcpy(&len, buf.data() + used, 4);
+                if (buf.size() - used < 4 + len) break;
+                used += 4 + len;
+            } else {
+                size_t nl = buf.find('\n', used);
+                if (nl == std::string::npos) break;
+                used = nl + 1;
+            }
+            count--;
+        }
+        bytes += used;
+        buf.erase(0, used);
+        if (count == 0) break;
+        ssize_t n = ::read(fd, chunk, sizeof(chunk));
+        if (n <= 0) return false;
+        buf.append(chunk, n);
+    }
+    return true;
+}
+
+void serve(grs_debug::DebugProtocol& proto, const grs_debug::VariableMap& vars) {
+    DebugRequest request;
+    grs_debug::IOSnapshot io{0x01, 0x05, true, true};
+    while (proto.readRequest(request)) {
+        if (request.type == DebugRequest::Type::GET_VARIABLES) proto.variables(vars);
+        else if (request.type == DebugRequest::Type::GET_IO) proto.io(io);
+        else break;
+        proto.flush();
+    }
+}
+
+void roundTrip(bool binary, const grs_debug::VariableMap& vars, double seconds) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        std::perror("socketpair");
+        std::exit(1);
+    }
+    auto proto = binary ? grs_debug::makeBinaryProtocol(sv[1], sv[1]) : grs_debug::makeJsonProtocol(sv[1], sv[1]);
+    std::thread server([&] { serve(*proto, vars); });
+
+    std::string poll = requestBytes(binary, DebugRequest::Type::GET_VARIABLES) +
+                       requestBytes(binary, DebugRequest::Type::GET_IO);
+    std::string buf;
+    uint64_t polls = 0, bytes = 0;
+    auto start = Clock::now();
+    auto deadline = start + std::chrono::duration<double>(seconds);
+    while (Clock::now() < deadline) {
+        if (::write(sv[0], poll.data(), poll.size()) != (ssize_t)poll.size()) break;
+        if (!readResponses(sv[0], binary, 2, buf, bytes)) break;
+        polls++;
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    ::shutdown(sv[0], SHUT_WR);
+    server.join();
+    ::close(sv[0]);
+    ::close(sv[1]);
+
+    std::printf("  %-6s round trip  %9.0f polls/s  %8.0f msgs/s  %6llu bytes/poll\n",
+                binary ? "binary" : "json", polls / elapsed, 2 * polls / elapsed,
+                (unsigned long long)(polls ? bytes / polls : 0));
+}
+
+void encodeOnly(bool binary, const grs_debug::VariableMap& vars, double seconds) {
+    int devnull = ::open("/dev/null", O_WRONLY);
+    auto proto = binary ? grs_debug::makeBinaryProtocol(-1, devnull) : grs_debug::makeJsonProtocol(-1, devnull);
+    grs_debug::IOSnapshot io{0x01, 0x05, true, true};
+    uint64_t polls = 0;
+    auto start = Clock::now();
+    auto deadline = start + std::chrono::duration<double>(seconds);
+    while (Clock::now() < deadline) {
+        for (int i = 0; i < 100; i++) {
+            proto->variables(vars);
+            proto->io(io);
+            proto->flush();
+        }
+        polls += 100;
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    ::close(devnull);
+    std::printf("  %-6s encode      %9.0f polls/s  %8.2f us/poll\n",
+                binary ? "binary" : "json", polls / elapsed, 1e6 * elapsed / polls);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    int n = argc > 1 ? std::atoi(argv[1]) : 40;
+    double seconds = argc > 2 ? std::atof(argv[2]) : 2.0;
+    grs_debug::VariableMap vars = makeVariables(n);
+
+    std::printf("debug protocol, %d variables (INT/REAL/BOOL/POS/AXIS), %.1f s per case\n", n, seconds);
+    for (bool binary : {false, true}) encodeOnly(binary, vars, seconds);
+    for (bool binary : {false, true}) roundTrip(binary, vars, seconds);
+    return 0;
+}
@@ -83,6 +83,7 @@ class FunctionDeclaration : public ASTNode{
     FunctionDeclaration(const std::string& name);
     ASTNodeType getType()const override{ return ASTNodeType::FunctionDeclaration;}
     void accept(ASTVisitor& visitor)override;
+    const std::string& getName()const{return name_;}
     private:
     std::string name_;
 };
@@ -0,0 +1,48 @@
+#ifndef BATCH_RUNNER_HPP_
+#define BATCH_RUNNER_HPP_
+
+#include <string>
+#include <vector>
+
+// ═══════════════════════════════════════════════════════════════
+// grs_step --batch — headless regression run over many programs.
+//
+// Every program runs in a child process, up to jobs at a time, against its own
+// LocalIOProvider with auto-ACK; its stdout goes to /dev/null. Its
+// RobotCommand stream is compared with <program>.golden:
+//
+//   <line> <TYPE> <target> <key>=<value>...   motions, keys in orderParams() order
+//   <line> WAIT <ms>
+//   <line> OUT <index> TRUE|FALSE
+//   <line> ERROR <message>                   parse or runtime error
+//   END outputs=0x<hex>                      output word after the run
+//
+// <program>.inputs scripts the inputs: "<ms> <word>" per line in ascending
+// time, '#' comments, the format of the bridge's --sim-inputs. Time only
+// advances with WAIT; an entry is applied once the WAITs before reach it.
+//
+// With a coverage path the programs' statement and branch counts are merged
+// into one lcov file; a program that timed out does not contribute.
+// ═══════════════════════════════════════════════════════════════
+
+namespace grs_batch{
+
+    struct BatchOptions{
+        std::vector<std::string> patterns;   // directories (every .txt/.grs in them) or globs
+        unsigned jobs = 0;                   // 0: one per core
+        std::string goldenDir;               // empty: next to each program
+        bool updateGolden = false;           // write the streams instead of comparing
+        double timeoutSeconds = 10.0;        // per program
+        std::string coveragePath;            // lcov file for the whole suite, empty: none
+        bool coverageAppend = false;         // add to the counts already in it
+    };
+
+    // Runs the suite and prints one line per program plus a summary to stdout.
+    // 0 when every program passed (or was recorded with updateGolden).
+    // A program that overruns its timeout is killed and reported as TIMEOUT.
+    // Forks, so call it before starting any threads.
+    int runBatch(const BatchOptions& options);
+
+}
+
+#endif //BATCH_RUNNER_HPP_
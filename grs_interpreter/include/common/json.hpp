@@ -0,0 +1,394 @@
+#ifndef COMMON_JSON_HPP_
+#define COMMON_JSON_HPP_
+
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+
+namespace common{
+
+// Streaming JSON for the grs_step --debug protocol (one object per line).
+// Neither side allocates per message:
+//   JsonReader  indexes the members of one object in place; values are views
+//               into the line, nested objects/arrays are kept as raw text
+//   JsonWriter  formats into a fixed buffer that reaches the fd only on
+//               flush() or when the buffer is full, so a whole command
+//               response costs one write()
+class JsonReader{
+    public:
+        enum class Type { String, Number, Bool, Null, Object, Array };
+
+        struct Member{
+            std::string_view key;    // as written, without quotes
+            std::string_view raw;    // strings without quotes (still escaped), others verbatim
+            Type type;
+        };
+
+        static constexpr size_t kMaxMembers = 32;
+
+        // false if the text is not a single JSON object
+        bool parse(std::string_view text){
+            text_ = text;
+            pos_ = 0;
+            count_ = 0;
+            skipSpace();
+            if(!consume('{')) return false;
+            skipSpace();
+            if(consume('}')) return trailingSpaceOnly();
+            while(true){
+                skipSpace();
+                std::string_view key;
+                if(!readString(key)) return false;
+                skipSpace();
+                if(!consume(':')) return false;
+                skipSpace();
+                Member m{key, {}, Type::Null};
+                if(!readValue(m)) return false;
+                if(count_ < kMaxMembers) members_[count_++] = m;
+                skipSpace();
+                if(consume(',')) continue;
+                if(consume('}')) return trailingSpaceOnly();
+                return false;
+            }
+        }
+
+        const Member* find(std::string_view key) const{
+            for(size_t i = 0; i < count_; i++){
+                if(members_[i].key == key) return &members_[i];
+            }
+            return nullptr;
+        }
+
+        bool has(std::string_view key) const { return find(key) != nullptr; }
+
+        // Raw string contents; empty if absent or not a string. Fine for
+        // identifiers such as "cmd" that never contain escapes.
+        std::string_view getString(std::string_view key) const{
+            const Member* m = find(key);
+            return m && m->type == Type::String ? m->raw : std::string_view{};
+        }
+
+        // Unescaped string into out (which keeps its capacity between calls)
+        bool getString(std::string_view key, std::string& out) const{
+            const Member* m = find(key);
+            if(!m || m->type != Type::String) return false;
+            return unescape(m->raw, out);
+        }
+
+        // Accepts 5, 5.0 and "5" (some clients send every value as a string)
+        bool getInt(std::string_view key, long long& out) const{
+            const Member* m = find(key);
+            if(!m || (m->type != Type::Number && m->type != Type::String) || m->raw.empty()) return false;
+            char buf[32];
+            size_t n = m->raw.size() < sizeof(buf) - 1 ? m->raw.size() : sizeof(buf) - 1;
+            std::memcpy(buf, m->raw.data(), n);
+            buf[n] = '\0';
+            char* end;
+            double d = std::strtod(buf, &end);
+            if(end == buf || *end != '\0') return false;
+            out = static_cast<long long>(d);
+            return true;
+        }
+
+        bool getBool(std::string_view key, bool& out) const{
+            const Member* m = find(key);
+            if(!m || m->type != Type::Bool) return false;
+            out = m->raw == "true";
+            return true;
+        }
+
+        size_t size() const { return count_; }
+        const Member& operator[](size_t i) const { return members_[i]; }
+
+        static bool unescape(std::string_view raw, std::string& out){
+            out.clear();
+            for(size_t i = 0; i < raw.size(); i++){
+                char c = raw[i];
+                if(c != '\\'){ out += c; continue; }
+                if(++i == raw.size()) return false;
+                switch(raw[i]){
+                    case '"':  out += '"'; break;
+                    case '\\': out += '\\'; break;
+                    case '/':  out += '/'; break;
+                    case 'b':  out += '\b'; break;
+                    case 'f':  out += '\f'; break;
+                    case 'n':  out += '\n'; break;
+                    case 'r':  out += '\r'; break;
+                    case 't':  out += '\t'; break;
+                    case 'u': {
+                        if(i + 4 >= raw.size()) return false;
+                        unsigned cp = 0;
+                        for(int k = 1; k <= 4; k++){
+                            char h = raw[i + k];
+                            cp <<= 4;
+                            if(h >= '0' && h <= '9') cp |= h - '0';
+                            else if(h >= 'a' && h <= 'f') cp |= h - 'a' + 10;
+                            else if(h >= 'A' && h <= 'F') cp |= h - 'A' + 10;
+                            else return false;
+                        }
+                        i += 4;
+                        // UTF-8; surrogate pairs are passed through as two code points
+                        if(cp < 0x80) out += static_cast<char>(cp);
+                        else if(cp < 0x800){
+                            out += static_cast<char>(0xC0 | (cp >> 6));
+                            out += static_cast<char>(0x80 | (cp & 0x3F));
+                        } else {
+                            out += static_cast<char>(0xE0 | (cp >> 12));
+                            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                            out += static_cast<char>(0x80 | (cp & 0x3F));
+                        }
+                        break;
+                    }
+                    default: return false;
+                }
+            }
+            return true;
+        }
+
+    private:
+        std::string_view text_;
+        size_t pos_ = 0;
+        Member members_[kMaxMembers];
+        size_t count_ = 0;
+
+        void skipSpace(){
+            while(pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\t' ||
+                                          text_[pos_] == '\r' || text_[pos_] == '\n')) pos_++;
+        }
+
+        bool consume(char c){
+            if(pos_ < text_.size() && text_[pos_] == c){ pos_++; return true; }
+            return false;
+        }
+
+        bool trailingSpaceOnly(){
+            skipSpace();
+            return pos_ == text_.size();
+        }
+
+        // At an opening quote: the contents up to the closing one
+        bool readString(std::string_view& out){
+            if(!consume('"')) return false;
+            size_t start = pos_;
+            while(pos_ < text_.size()){
+                char c = text_[pos_];
+                if(c == '\\') pos_ += 2;
+                else if(c == '"'){
+                    out = text_.substr(start, pos_ - start);
+                    pos_++;
+                    return true;
+                }
+                else pos_++;
+            }
+            return false;
+        }
+
+        bool readValue(Member& m){
+            if(pos_ >= text_.size()) return false;
+            char c = text_[pos_];
+            if(c == '"'){
+                m.type = Type::String;
+                return readString(m.raw);
+            }
+            if(c == '{' || c == '['){
+                m.type = c == '{' ? Type::Object : Type::Array;
+                size_t start = pos_;
+                int depth = 0;
+                while(pos_ < text_.size()){
+                    char d = text_[pos_];
+                    if(d == '"'){
+                        std::string_view skipped;
+                        if(!readString(skipped)) return false;
+                        continue;
+                    }
+                    if(d == '{' || d == '[') depth++;
+                    else if(d == '}' || d == ']'){
+                        if(--depth == 0){
+                            pos_++;
+                            m.raw = text_.substr(start, pos_ - start);
+                            return true;
+                        }
+                    }
+                    pos_++;
+                }
+                return false;
+            }
+            size_t start = pos_;
+            while(pos_ < text_.size() && text_[pos_] != ',' && text_[pos_] != '}' &&
+                  text_[pos_] != ' ' && text_[pos_] != '\t' && text_[pos_] != '\r' && text_[pos_] != '\n') pos_++;
+            m.raw = text_.substr(start, pos_ - start);
+            if(m.raw == "true" || m.raw == "false") m.type = Type::Bool;
+            else if(m.raw == "null") m.type = Type::Null;
+            else if(!m.raw.empty() && (m.raw[0] == '-' || (m.raw[0] >= '0' && m.raw[0] <= '9'))) m.type = Type::Number;
+            else return false;
+            return true;
+        }
+};
+
+class JsonWriter{
+    public:
+        static constexpr size_t kBufferSize = 16384;
+        static constexpr int kMaxDepth = 16;
+
+        explicit JsonWriter(int fd = STDOUT_FILENO) : fd_(fd) {}
+        ~JsonWriter(){ flush(); }
+
+        JsonWriter(const JsonWriter&) = delete;
+        JsonWriter& operator=(const JsonWriter&) = delete;
+
+        JsonWriter& beginObject(){ open('{'); return *this; }
+        JsonWriter& endObject(){ close('}'); return *this; }
+        JsonWriter& beginArray(){ open('['); return *this; }
+        JsonWriter& endArray(){ close(']'); return *this; }
+
+        JsonWriter& key(std::string_view k){
+            separate();
+            quoted(k);
+            put(':');
+            afterKey_ = true;
+            return *this;
+        }
+
+        JsonWriter& value(std::string_view s){ separate(); quoted(s); return *this; }
+        JsonWriter& value(const char* s){ return value(std::string_view(s)); }
+        JsonWriter& value(const std::string& s){ return value(std::string_view(s)); }
+        JsonWriter& value(bool b){ separate(); put(b ? "true" : "false"); return *this; }
+        JsonWriter& value(int v){ return value(static_cast<long long>(v)); }
+        JsonWriter& value(unsigned v){ return value(static_cast<unsigned long long>(v)); }
+        JsonWriter& value(long v){ return value(static_cast<long long>(v)); }
+        JsonWriter& value(unsigned long v){ return value(static_cast<unsigned long long>(v)); }
+        JsonWriter& value(long long v){ separate(); format("%lld", v); return *this; }
+        JsonWriter& value(unsigned long long v){ separate(); format("%llu", v); return *this; }
+        JsonWriter& value(double v){ separate(); format("%.15g", v); return *this; }
+        JsonWriter& null(){ separate(); put("null"); return *this; }
+
+        // An already formatted JSON value (e.g. LatencyHistogram::toJson())
+        JsonWriter& raw(std::string_view json){ separate(); put(json); return *this; }
+
+        template<typename T>
+        JsonWriter& member(std::string_view k, const T& v){ key(k); return value(v); }
+
+        // A string value assembled in pieces: beginString(), text()/textf()..., endString()
+        JsonWriter& beginString(){ separate(); put('"'); return *this; }
+        JsonWriter& text(std::string_view s){ escaped(s); return *this; }
+        JsonWriter& textf(const char* fmt, ...) __attribute__((format(printf, 2, 3))){
+            char tmp[256];
+            va_list ap;
+            va_start(ap, fmt);
+            int n = std::vsnprintf(tmp, sizeof(tmp), fmt, ap);
+            va_end(ap);
+            if(n > 0) escaped(std::string_view(tmp, static_cast<size_t>(n) < sizeof(tmp) ? n : sizeof(tmp) - 1));
+            return *this;
+        }
+        JsonWriter& endString(){ put('"'); return *this; }
+
+        // Ends the current top-level message
+        void endLine(){
+            put('\n');
+            depth_ = 0;
+            first_[0] = true;
+            afterKey_ = false;
+        }
+
+        void flush(){
+            size_t off = 0;
+            while(off < len_){
+                ssize_t n = ::write(fd_, buf_ + off, len_ - off);
+                if(n <= 0) break;
+                off += static_cast<size_t>(n);
+            }
+            if(len_) flushes_++;
+            len_ = 0;
+        }
+
+        uint64_t flushCount() const { return flushes_; }
+
+    private:
+        int fd_;
+        char buf_[kBufferSize];
+        size_t len_ = 0;
+        bool first_[kMaxDepth + 1] = {true};
+        int depth_ = 0;
+        bool afterKey_ = false;
+        uint64_t flushes_ = 0;
+
+        void put(char c){
+            if(len_ == kBufferSize) flush();
+            buf_[len_++] = c;
+        }
+
+        void put(std::string_view s){
+            if(len_ + s.size() > kBufferSize) flush();
+            if(s.size() > kBufferSize){
+                for(char c : s) put(c);
+                return;
+            }
+            std::memcpy(buf_ + len_, s.data(), s.size());
+            len_ += s.size();
+        }
+
+        void format(const char* fmt, ...) __attribute__((format(printf, 2, 3))){
+            char tmp[64];
+            va_list ap;
+            va_start(ap, fmt);
+            int n = std::vsnprintf(tmp, sizeof(tmp), fmt, ap);
+            va_end(ap);
+            if(n > 0) put(std::string_view(tmp, static_cast<size_t>(n) < sizeof(tmp) ? n : sizeof(tmp) - 1));
+        }
+
+        // Comma before every element but the first of its object/array
+        void separate(){
+            if(afterKey_){ afterKey_ = false; return; }
+            if(depth_ > 0){
+                if(!first_[depth_]) put(',');
+                first_[depth_] = false;
+            }
+        }
+
+        void open(char c){
+            separate();
+            put(c);
+            if(depth_ < kMaxDepth) depth_++;
+            first_[depth_] = true;
+        }
+
+        void close(char c){
+            put(c);
+            if(depth_ > 0) depth_--;
+        }
+
+        void quoted(std::string_view s){
+            put('"');
+            escaped(s);
+            put('"');
+        }
+
+        void escaped(std::string_view s){
+            static const char hex[] = "0123456789abcdef";
+            for(char c : s){
+                switch(c){
+                    case '"':  put("\\\""); break;
+                    case '\\': put("\\\\"); break;
+                    case '\n': put("\\n"); break;
+                    case '\r': put("\\r"); break;
+                    case '\t': put("\\t"); break;
+                    default:
+                        if(static_cast<unsigned char>(c) < 0x20){
+                            char u[6] = {'\\', 'u', '0', '0', hex[(c >> 4) & 0xF], hex[c & 0xF]};
+                            put(std::string_view(u, 6));
+                        } else {
+                            put(c);
+                        }
+                }
+            }
+        }
+};
+
+}
+
+#endif //COMMON_JSON_HPP_
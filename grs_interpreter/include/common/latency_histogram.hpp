@@ -0,0 +1,99 @@
+#ifndef COMMON_LATENCY_HISTOGRAM_HPP_
+#define COMMON_LATENCY_HISTOGRAM_HPP_
+
+#include <array>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+namespace common{
+
+// HDR-style log-linear histogram for latencies in microseconds.
+// Every power-of-two range is split into 32 linear sub-buckets, so any recorded
+// value is reproduced within ~3% regardless of magnitude (1 µs … ~12 days).
+// Fixed storage, no allocation on record().
+class LatencyHistogram{
+    public:
+        static constexpr unsigned kSubBucketBits = 5;
+        static constexpr uint64_t kSubBuckets = 1u << kSubBucketBits;   // 32
+        static constexpr unsigned kMaxBits = 40;                        // 2^40 µs
+        static constexpr size_t kBucketCount =
+            (kMaxBits - kSubBucketBits) * kSubBuckets + 2 * kSubBuckets;
+
+        void record(uint64_t us){
+            if(us >= (uint64_t{1} << kMaxBits)) us = (uint64_t{1} << kMaxBits) - 1;
+            counts_[indexOf(us)]++;
+            total_++;
+            sum_ += us;
+            if(total_ == 1 || us < min_) min_ = us;
+            if(us > max_) max_ = us;
+        }
+
+        void reset(){
+            counts_.fill(0);
+            total_ = sum_ = min_ = max_ = 0;
+        }
+
+        uint64_t count() const { return total_; }
+        uint64_t min() const { return min_; }
+        uint64_t max() const { return max_; }
+        double mean() const { return total_ ? double(sum_) / total_ : 0.0; }
+
+        // Highest value equivalent to the bucket holding the given percentile (0..100)
+        uint64_t percentile(double p) const{
+            if(total_ == 0) return 0;
+            uint64_t rank = static_cast<uint64_t>(p / 100.0 * total_ + 0.5);
+            if(rank < 1) rank = 1;
+            if(rank > total_) rank = total_;
+            uint64_t seen = 0;
+            for(size_t i = 0; i < kBucketCount; i++){
+                seen += counts_[i];
+                if(seen >= rank){
+                    uint64_t v = highestEquivalent(i);
+                    return v < max_ ? v : max_;
+                }
+            }
+            return max_;
+        }
+
+        // {"count":N,"min":..,"mean":..,"p50":..,"p90":..,"p99":..,"p999":..,"max":..} in µs
+        std::string toJson() const{
+            std::ostringstream os;
+            os << "{\"count\":" << total_
+               << ",\"min\":" << min_
+               << ",\"mean\":" << static_cast<uint64_t>(mean() + 0.5)
+               << ",\"p50\":" << percentile(50.0)
+               << ",\"p90\":" << percentile(90.0)
+               << ",\"p99\":" << percentile(99.0)
+               << ",\"p999\":" << percentile(99.9)
+               << ",\"max\":" << max_ << "}";
+            return os.str();
+        }
+
+    private:
+        std::array<uint64_t, kBucketCount> counts_{};
+        uint64_t total_ = 0;
+        uint64_t sum_ = 0;
+        uint64_t min_ = 0;
+        uint64_t max_ = 0;
+
+        // Values below 64 map 1:1; above that the top 6 significant bits pick
+        // the sub-bucket and the remaining shift picks the power-of-two range
+        static size_t indexOf(uint64_t v){
+            if(v < 2 * kSubBuckets) return static_cast<size_t>(v);
+            unsigned msb = 63 - __builtin_clzll(v);
+            unsigned shift = msb - kSubBucketBits;
+            return static_cast<size_t>(shift * kSubBuckets + (v >> shift));
+        }
+
+        static uint64_t highestEquivalent(size_t index){
+            if(index < 2 * kSubBuckets) return index;
+            unsigned shift = static_cast<unsigned>(index / kSubBuckets - 1);
+            uint64_t sub = index % kSubBuckets + kSubBuckets;
+            return ((sub + 1) << shift) - 1;
+        }
+};
+
+}
+
+#endif //COMMON_LATENCY_HISTOGRAM_HPP_
@@ -0,0 +1,96 @@
+#ifndef COVERAGE_HPP_
+#define COVERAGE_HPP_
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ast/ast.hpp"
+#include "executor/step_executor.hpp"
+
+// ═══════════════════════════════════════════════════════════════
+// grs_step --coverage: which statements and IF branches a run exercised.
+//
+// Output is an lcov tracefile keyed by GRS source line, for genhtml or any
+// CI coverage viewer:
+//
+//   SF:/abs/path/cell.grs
+//   BRDA:<if line>,0,0,<times THEN ran>     branch 1: condition false
+//   BRDA:<if line>,0,1,<times not taken>    "-" when the IF was never reached
+//   BRF:.. BRH:..
+//   DA:<line>,<hits>                        every statement, 0 if never run
+//   LF:.. LH:..
+//   end_of_record
+//
+// Counts add up across runs: a batch suite merges its programs in one file,
+// and --coverage-append adds a run to the counts already in the file.
+// ═══════════════════════════════════════════════════════════════
+
+namespace grs_coverage{
+
+    struct FileCoverage{
+        std::map<int, uint64_t> lines;                        // line -> hits
+        std::map<int, std::array<uint64_t, 2>> branches;      // IF line -> {true, false}
+
+        void merge(const FileCoverage& other);
+    };
+
+    struct CoverageSummary{
+        size_t lines = 0, linesHit = 0;
+        size_t branches = 0, branchesHit = 0;   // two per IF
+    };
+
+    class CoverageReport{
+        public:
+            // path is made absolute so runs from different directories merge
+            void merge(const std::string& path, const FileCoverage& file);
+            void merge(const CoverageReport& other);
+
+            // Adds the counts of an existing tracefile
+            bool readLcov(const std::string& path, std::string& error);
+            bool writeLcov(const std::string& path, std::string& error) const;
+
+            const std::map<std::string, FileCoverage>& files() const { return files_; }
+            CoverageSummary summary() const;
+
+        private:
+            std::map<std::string, FileCoverage> files_;
+    };
+
+    // Counts one program's statements and branches while it runs. Every
+    // statement and IF of the program is known up front, so lines that never
+    // ran are reported with 0. A counter per line is all a hook touches.
+    class CoverageCollector : public grs_executor::ExecutionListener{
+        public:
+            explicit CoverageCollector(const std::shared_ptr<grs_ast::FunctionBlock>& program);
+
+            FileCoverage result() const;
+
+            void statementStarted(size_t pc, int line) override;
+            void blockStatementStarted(int line, size_t depth) override;
+            void branchEvaluated(int line, bool condition) override;
+
+        private:
+            std::vector<uint64_t> lineHits_;                    // by line
+            std::vector<std::array<uint64_t, 2>> branchHits_;   // by line
+            std::vector<bool> statementLines_;
+            std::vector<bool> ifLines_;
+
+            void instrument(const std::shared_ptr<grs_ast::ASTNode>& node);
+            void hit(int line);
+    };
+
+    // Writes report to path; with append, the counts already in path are added
+    // first. summary describes the file as written.
+    bool saveLcov(const std::string& path, const CoverageReport& report, bool append,
+                  CoverageSummary& summary, std::string& error);
+
+    // "lines 40/45 (88.9%), branches 7/14 (50.0%) in <path>"
+    void printSummary(std::FILE* out, const CoverageSummary& summary, const std::string& path);
+
+}
+
+#endif //COVERAGE_HPP_
@@ -0,0 +1,179 @@
+#ifndef DEBUG_PROTOCOL_HPP_
+#define DEBUG_PROTOCOL_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "common/utils.hpp"
+#include "common/latency_histogram.hpp"
+#include "executor/step_executor.hpp"
+
+// ═══════════════════════════════════════════════════════════════
+// grs_step debug channel — one request in, its events out.
+//
+// JSON   (--debug)         one object per line, see step_main.cpp; what the
+//                          ZeroBrane plugin speaks
+// BINARY (--debug-binary)  length-prefixed frames with a fixed schema, for
+//                          HMIs polling variables/io at high rates:
+//
+//   frame    := len:u32 body[len]
+//   body     := kind:u8 payload
+//   requests   kind = DebugRequest::Type; SET/REMOVE_BREAKPOINT carry line:i32,
+//              LOAD/RELOAD  flags:u8 (bit0 text is the program, bit1 live)
+//              text[rest of frame] (RELOAD may be empty), SUBSCRIBE since:u64,
+//              all others are empty
+//   events     INITIALIZED  line:i32
+//              STOPPED      line:i32 reason:u8 (0 step, 1 breakpoint)
+//              TERMINATED / BREAKPOINTS_CLEARED / LATENCY_RESET   (empty)
+//              ERROR        str16
+//              OUTPUT       cmd_type:u8 line:i32, then by cmd_type
+//                             OUTPUT  index:u8 value:u8
+//                             WAIT    time:f64
+//                             motion  target:str16 count:u8 (key:str8 value)*
+//              BREAKPOINT_SET / BREAKPOINT_REMOVED  line:i32
+//              VARIABLES    count:u16 (name:str8 value)*
+//              IO           inputs:u32 outputs:u32 flags:u8 (bit0 has ready, bit1 ready)
+//              LATENCY      present:u8, if 1: send_to_ack hist ack_to_done hist
+//              LOADED       line:i32 parsed:u8 path:str16
+//              DELTA        version:u64 base:u64 full:u8 count:u16 (name:str8 value)*
+//                           has_io:u8, if 1: inputs:u32 outputs:u32 flags:u8
+//                           inputs_changed:u32 outputs_changed:u32
+//   value    := tag:u8 then  INT i32 | DOUBLE f64 | BOOL u8 | STRING str16 |
+//                            POSITION/FRAME/AXIS 6 x f64 | OTHER (nothing)
+//   hist     := count min mean p50 p90 p99 p999 max, u64 each, µs
+//   str8/16  := len:u8/u16 bytes
+//
+// cmd_type is RobotCommand::Type; fixed-width fields are little endian
+// (host order, same assumption as the bridge wire formats).
+// ═══════════════════════════════════════════════════════════════
+
+namespace grs_debug{
+
+    struct DebugRequest{
+        enum class Type : uint8_t{
+            UNKNOWN = 0,
+            STEP, CONTINUE,
+            SET_BREAKPOINT, REMOVE_BREAKPOINT, CLEAR_BREAKPOINTS,
+            GET_VARIABLES, GET_IO,
+            GET_LATENCY, RESET_LATENCY,
+            DISCONNECT,
+            LOAD, RELOAD,
+            SUBSCRIBE, UNSUBSCRIBE,
+            MALFORMED = 0xFF      // not decodable; answered with an error event
+        };
+
+        Type type = Type::UNKNOWN;
+        int line = 0;
+        // LOAD/RELOAD: a file path, or the program itself when isSource;
+        // keeps its capacity from request to request
+        std::string text;
+        bool isSource = false;
+        // LOAD/RELOAD: edit and continue, keep the variables and position
+        bool live = false;
+        // SUBSCRIBE: variables version the client already holds, 0 for none
+        uint64_t since = 0;
+
+        void clear(){
+            type = Type::UNKNOWN;
+            line = 0;
+            text.clear();
+            isSource = false;
+            live = false;
+            since = 0;
+        }
+    };
+
+    enum class EventKind : uint8_t{
+        INITIALIZED = 0x80, STOPPED, TERMINATED, ERROR, OUTPUT,
+        BREAKPOINT_SET, BREAKPOINT_REMOVED, BREAKPOINTS_CLEARED,
+        VARIABLES, IO, LATENCY, LATENCY_RESET, LOADED, DELTA
+    };
+
+    enum class ValueTag : uint8_t{ INT, DOUBLE, BOOL, STRING, POSITION, FRAME, AXIS, OTHER };
+
+    enum class StopReason : uint8_t{ STEP, BREAKPOINT };
+
+    struct IOSnapshot{
+        uint32_t inputs = 0;
+        uint32_t outputs = 0;
+        bool hasReady = false;   // only the hardware link knows system_ready
+        bool ready = false;
+    };
+
+    using VariableMap = std::unordered_map<std::string, common::ValueType>;
+
+    // What a subscribed client gets after each stop: the variables written
+    // since the version it holds and the I/O if it changed. full means a
+    // snapshot (first sync, or the program was loaded/reset since): the client
+    // replaces its copy instead of merging.
+    struct StateDelta{
+        uint64_t version = 0;     // the client holds this after applying the delta
+        uint64_t base = 0;        // what it held before, 0 when full
+        bool full = false;
+        std::vector<const grs_executor::StepExecutor::VariableEntry*> variables;
+        bool hasIO = false;
+        IOSnapshot io;
+        uint32_t inputsChanged = 0;    // bits that differ from the last report
+        uint32_t outputsChanged = 0;
+    };
+
+    // Requests are read from inFd through an internal buffer; events are
+    // buffered and only written to outFd by flush(), once per request.
+    class DebugProtocol{
+        public:
+            DebugProtocol(int inFd, int outFd);
+            virtual ~DebugProtocol() = default;
+
+            DebugProtocol(const DebugProtocol&) = delete;
+            DebugProtocol& operator=(const DebugProtocol&) = delete;
+
+            // Blocks for the next request; false once the input is closed or a
+            // signal interrupted the wait
+            bool readRequest(DebugRequest& request);
+
+            virtual void initialized(int line) = 0;
+            virtual void stopped(int line, StopReason reason) = 0;
+            virtual void terminated() = 0;
+            virtual void error(std::string_view message) = 0;
+            virtual void output(const grs_executor::RobotCommand& cmd) = 0;
+            virtual void breakpointSet(int line) = 0;
+            virtual void breakpointRemoved(int line) = 0;
+            virtual void breakpointsCleared() = 0;
+            virtual void variables(const VariableMap& vars) = 0;
+            virtual void io(const IOSnapshot& io) = 0;
+            // Both null when there is no hardware link
+            virtual void latency(const common::LatencyHistogram* sendToAck,
+                                 const common::LatencyHistogram* ackToDone) = 0;
+            virtual void latencyReset() = 0;
+            // A program is in the executor, at its first line; parsed is false
+            // when the source was unchanged and the previous AST was reused
+            virtual void loaded(std::string_view path, int line, bool parsed) = 0;
+            virtual void delta(const StateDelta& delta) = 0;
+
+            virtual void flush() = 0;
+
+        protected:
+            // One request from the front of data: bytes consumed, 0 if more are
+            // needed. atEof: no more bytes will come (a last line without '\n').
+            virtual size_t decodeRequest(const char* data, size_t len, bool atEof, DebugRequest& request) = 0;
+
+            int inFd_;
+            int outFd_;
+
+        private:
+            std::vector<char> in_;
+            size_t inBegin_ = 0;
+            size_t inEnd_ = 0;
+            bool eof_ = false;
+    };
+
+    std::unique_ptr<DebugProtocol> makeJsonProtocol(int inFd, int outFd);
+    std::unique_ptr<DebugProtocol> makeBinaryProtocol(int inFd, int outFd);
+
+}
+
+#endif //DEBUG_PROTOCOL_HPP_
@@ -48,6 +48,30 @@ namespace grs_executor{
         double waitTime = 0.0;
     };
 
+    //params in report order: x,y,z,a,b,c, a1-a6, A1-A6, then any other key by name
+    void orderParams(const RobotCommand& cmd, std::vector<const std::pair<std::string,common::ValueType>*>& out);
+
+    //Hooks into execution for tracing and analysis, called on the executing thread.
+    //Kept cheap: nothing is computed for them when no listener is attached.
+    class ExecutionListener{
+        public:
+             virtual ~ExecutionListener() = default;
+             //pc indexes the flattened statement list, line is its source line
+             virtual void statementStarted(size_t /*pc*/, int /*line*/){}
+             //A statement inside an IF branch, depth 1 in a branch of a top-level IF
+             virtual void blockStatementStarted(int /*line*/, size_t /*depth*/){}
+             //An IF condition on line was evaluated, true runs the THEN branch
+             virtual void branchEvaluated(int /*line*/, bool /*condition*/){}
+             virtual void variableWritten(const std::string& /*name*/, const common::ValueType& /*value*/){}
+             virtual void positionWritten(const std::string& /*name*/, const std::string& /*field*/, const common::ValueType& /*value*/){}
+             //index is the hardware (0-based) input
+             virtual void inputRead(uint8_t /*index*/, bool /*value*/){}
+             virtual void commandEmitted(const RobotCommand& /*cmd*/){}
+             virtual void commandAcknowledged(){}
+             //error is the message when status is ERROR, empty otherwise
+             virtual void statusChanged(ExecutionStatus /*status*/, int /*line*/, const std::string& /*error*/){}
+    };
+
     class StepExecutor : public grs_ast::ASTVisitor{
 
         public:
@@ -56,10 +80,15 @@ namespace grs_executor{
 
              //Program loading
              void load(const std::shared_ptr<grs_ast::FunctionBlock>& program);
+             //Edit and continue: swap in an edited version of the loaded program. Statements
+             //are matched by content, not line, so the variable and position stores are kept
+             //and execution resumes at the same statement (after the last unchanged one that
+             //ran, if it was edited away). Changed declarations above that point run again.
+             void reload(const std::shared_ptr<grs_ast::FunctionBlock>& program);
 
              //Execution Contol
              bool step();//one statement runs
-             void run(); //run until the breakpoint/endpoint
+             void run(); //run until the breakpoint/endpoint, RUNNING throughout (no PAUSED between statements)
              void pause();
              void stop();
              void reset();
@@ -82,6 +111,15 @@ namespace grs_executor{
              const std::unordered_map<std::string,common::ValueType>& getVariables() const {return variables_;}
              const std::unordered_map<std::string,grs_lexer::TokenType>& getVariableTypes() const {return variableTypes_;}
 
+             //Change tracking for debugger deltas: every variable write gets the next version,
+             //and so does every position field write, reported as "P1->x"
+             using VariableEntry = std::pair<const std::string, common::ValueType>;
+             uint64_t getVariablesVersion() const {return variablesVersion_;}
+             //Version of the last load/reset; a client synced before it needs a full snapshot
+             uint64_t getVariablesResetVersion() const {return variablesResetVersion_;}
+             //Variables and position fields written after version since (out is cleared first)
+             void collectChangedVariables(uint64_t since, std::vector<const VariableEntry*>& out) const;
+
              //Visitor Methods
 
              void visit(grs_ast::FunctionBlock& node)override;
@@ -107,6 +145,9 @@ namespace grs_executor{
              //When the situation chanced for notification to IDE
              using StatusCallback = std::function<void(ExecutionStatus, int line)>;
              inline void setStatusCallback(StatusCallback cb){statusCallback_ = std::move(cb);}
+             //Listeners are not owned and must outlive the executor or be removed
+             void addListener(ExecutionListener* listener);
+             void removeListener(ExecutionListener* listener);
 
 
         private:
@@ -124,9 +165,14 @@ namespace grs_executor{
              //Variable storage
              std::unordered_map<std::string, common::ValueType> variables_;
              std::unordered_map<std::string, grs_lexer::TokenType> variableTypes_;
+             std::unordered_map<std::string, uint64_t> variableVersions_;
+             uint64_t variablesVersion_ = 0;
+             uint64_t variablesResetVersion_ = 0;
 
              //Position/Axis/Frame storage
              std::unordered_map<std::string,std::unordered_map<std::string,common::ValueType>> positionStore_;
+             //The same fields keyed "P1->x", versioned in variableVersions_ for deltas
+             std::unordered_map<std::string, common::ValueType> positionFields_;
              
             //I/O
              std::shared_ptr<grs_io::IOProvider> ioProvider_;
@@ -142,10 +188,17 @@ namespace grs_executor{
              CommandCallback commandCallback_;
              StatusCallback statusCallback_;
              bool waitingForAck_;//must be initialized
+             std::vector<ExecutionListener*> listeners_;
+             size_t blockDepth_ = 0;
+             bool inRun_ = false;//step() called by run(): stay RUNNING between statements
              
 
              //Helpers
              void setStatus(ExecutionStatus status);
+             void setVariable(const std::string& name, common::ValueType value);
+             void setPositionField(const std::string& name, const std::string& field, common::ValueType value);
+             void emitCommand(const RobotCommand& cmd);
+             void clearVariables();
              void flattenStatements(const std::shared_ptr<grs_ast::FunctionBlock>& block);
 
              //it can run a block for if/for control flow and return the addition statements
@@ -2,82 +2,95 @@
 #define TCP_IO_PROVIDER_HPP_
 
 #include "io/io_provider.hpp"
+#include "common/latency_histogram.hpp"
+#include "protocol.hpp"
 #include <string>
 #include <cstdint>
 #include <cstring>
 #include <atomic>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <functional>
 #include <vector>
+#include <deque>
+#include <chrono>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 
-// ═══════════════════════════════════════════════════════════════
-// Unified Protocol — Motion + I/O + Wait (single format)
-// ═══════════════════════════════════════════════════════════════
-#pragma pack(push, 1)
-
-enum GrsCommandType : uint8_t {
-    GRS_CMD_NOP        = 0,
-    GRS_CMD_PTP        = 1,
-    GRS_CMD_PTP_REL    = 2,
-    GRS_CMD_LIN        = 3,
-    GRS_CMD_LIN_REL    = 4,
-    GRS_CMD_CIRC       = 5,
-    GRS_CMD_CIRC_REL   = 6,
-    GRS_CMD_SPLINE     = 7,
-    GRS_CMD_SPLINE_REL = 8,
-    GRS_CMD_WAIT       = 9,
-    GRS_CMD_OUTPUT     = 10,
-    GRS_CMD_SET_ALL_OUTPUTS = 11,
-};
-
-// GRS Interpreter -> Hardware Controller (128 bytes)
-struct GrsRobotCommand {
-    uint64_t cmd_id;           // 8
-    uint8_t  cmd_type;         // 1  - GrsCommandType
-    uint8_t  io_index;         // 1  - I/O bit index (0-based)
-    uint8_t  io_value;         // 1  - I/O value (0 or 1)
-    uint8_t  set_outputs;      // 1  - full output byte (for SET_ALL_OUTPUTS)
-    uint8_t  soft_stops;       // 1  - soft emergency stop
-    uint8_t  reserved[3];      // 3
-    double   wait_time;        // 8  - ms (for WAIT)
-    double   coords[6];        // 48 - x,y,z,a,b,c
-    double   axes[6];          // 48 - A1-A6
-    uint8_t  padding[8];       // 8
-};
-// sizeof = 128
-
-// Hardware Controller -> GRS Interpreter (128 bytes)
-struct GrsRobotState {
-    uint64_t seq_id;           // 8
-    uint32_t timestamp;        // 4
-    uint8_t  inputs;           // 1
-    uint8_t  outputs;          // 1
-    uint8_t  is_hardware_emg;  // 1
-    uint8_t  system_ready;     // 1
-    uint8_t  cmd_ack;          // 1  - last ack'd cmd_type
-    uint8_t  cmd_status;       // 1  - 0=idle,1=exec,2=done,3=err
-    uint8_t  reserved[2];      // 2
-    double   current_pos[6];   // 48
-    double   current_axes[6];  // 48
-    uint8_t  padding[12];      // 12
-};
-// sizeof = 128
-
-#pragma pack(pop)
-
 namespace grs_io {
 
+// TCP: reliable ordered stream (default).
+// UDP: one 128-byte frame per datagram. Stale/reordered state frames are
+//      dropped by frame_seq, commands are retransmitted until the bridge
+//      reports their cmd_id in GrsRobotState::seq_id (see setRetransmit).
+enum class Transport { TCP, UDP };
+
 class TcpIOProvider : public IOProvider {
 public:
-    TcpIOProvider(const std::string& host = "127.0.0.1", int port = 12345);
+    TcpIOProvider(const std::string& host = "127.0.0.1", int port = 12345,
+                  Transport transport = Transport::TCP);
     ~TcpIOProvider();
 
     bool connect();
     void disconnect();
     bool isConnected() const { return connected_; }
+    Transport getTransport() const { return transport_; }
+
+    // TCP: on link loss reconnect with backoff and resend unacknowledged
+    // commands (enabled by default). Commands sent meanwhile are buffered.
+    void setAutoReconnect(bool enable);
+    uint64_t getReconnectCount() const { return reconnects_; }
+    size_t getPendingCount() const;
+    // Block until the bridge has acknowledged every command sent so far;
+    // false on timeout (UDP without retransmission: a lost command never is)
+    bool waitForAck(int timeoutMs);
+
+    // Command life cycle as reported by the bridge: ACKED once seq_id reaches the
+    // cmd_id (queued for the RT loop), DONE once done_cmd_id reaches it, FAILED
+    // instead of DONE when it lies in the failed range of a GRS_STATUS_ERROR
+    // frame (an EMG abort fails the motion in progress and all queued ones).
+    // The callback runs on the receive thread.
+    enum class CommandEvent { ACKED, DONE, FAILED };
+    using CommandEventCallback = std::function<void(uint64_t cmdId, CommandEvent event)>;
+    void setCommandEventCallback(CommandEventCallback cb);
+    uint64_t getLastCommandId() const;
+    uint64_t getDoneCommandId() const;
+    // Highest cmd_id the bridge failed (rejected, or aborted by EMG), 0 if none
+    uint64_t getFailedCommandId() const;
+    bool waitForDone(uint64_t cmdId, int timeoutMs);
+
+    // Latency per command in µs: send→ack and ack→done
+    common::LatencyHistogram getSendToAckHistogram() const;
+    common::LatencyHistogram getAckToDoneHistogram() const;
+    void resetLatency();
+
+    // TCP: wire format requested at connect (grs_wire::WIRE_COMPACT by default,
+    // WIRE_FIXED to force 128-byte frames). Bridges without support stay fixed.
+    void setWireFormat(uint8_t format) { requestedFormat_ = format; }
+    uint8_t getWireFormat() const { return wireFormat_; }
+
+    // Batched sending: commands issued between beginBatch() and endBatch() are
+    // encoded back to back and leave in one send() (TCP) or sendmmsg() (UDP).
+    // Batches nest. An open batch is flushed early once it holds kMaxBatchBytes
+    // or its oldest command has waited kMaxBatchAge; the receive thread checks
+    // the age on its own, so a batch nothing is appended to still goes out.
+    void beginBatch();
+    bool endBatch();
+    bool flush();  // write out what an open batch holds, keep the batch open
+    uint64_t getSendCallCount() const { return sendCalls_; }
+
+    // TCP_NODELAY on the command socket (default on). A batch that needs more
+    // than one write is corked so it still leaves in full segments.
+    void setNoDelay(bool enable) { noDelay_ = enable; }
+
+    // UDP only: resend unacknowledged commands after timeoutMs (on by default).
+    // Disabled, UDP has no delivery guarantee: a lost datagram stays unacknowledged
+    // and the bridge, accepting commands in order, drops everything after it.
+    void setRetransmit(bool enable, int timeoutMs = 20);
+    uint64_t getStaleFrameCount() const { return staleFrames_; }
+    uint64_t getRetransmitCount() const { return retransmits_; }
 
     // IOProvider interface
     bool readDigitalInput(uint8_t index) override;
@@ -100,12 +113,23 @@ public:
     void getCurrentPosition(double pos[6]) const;
     void getCurrentAxes(double axes[6]) const;
     uint8_t getCommandStatus() const;
+    // TCP: this connection's commands are executed (the bridge serves several
+    // clients but only one lease holder, see GRS_LINK_LEASE)
+    bool hasCommandLease() const;
 
 private:
+    using Clock = std::chrono::steady_clock;
+
+    struct PendingCommand {
+        GrsRobotCommand cmd;
+        Clock::time_point lastSent;
+    };
+
     std::string host_;
     int port_;
+    Transport transport_;
     int socket_fd_ = -1;
-    bool connected_ = false;
+    std::atomic<bool> connected_{false};
 
     // Background thread receives state updates
     std::atomic<bool> running_{false};
@@ -118,7 +142,76 @@ private:
     // Command tracking
     uint64_t cmdIdCounter_ = 1;
 
+    // Commands not yet acknowledged by GrsRobotState::seq_id, oldest first.
+    // sendMutex_ also serializes writes to socket_fd_.
+    static constexpr size_t kMaxPending = 1024;
+    mutable std::mutex sendMutex_;
+    std::deque<PendingCommand> pending_;
+
+    // Encoded frames waiting for the next flush (guarded by sendMutex_)
+    static constexpr size_t kMaxBatchBytes = 64 * 1024;
+    static constexpr std::chrono::milliseconds kMaxBatchAge{5};
+    int batchDepth_ = 0;
+    bool corked_ = false;
+    std::vector<uint8_t> txBuf_;
+    std::vector<size_t> txFrameEnds_;
+    Clock::time_point batchStart_;
+    bool noDelay_ = true;
+    std::atomic<uint64_t> sendCalls_{0};
+
+    // Completion tracking of every command until the bridge reports it done
+    struct InFlight {
+        uint64_t id;
+        Clock::time_point sent;
+        Clock::time_point acked;
+        bool isAcked;
+    };
+    static constexpr size_t kMaxInFlight = 4096;
+    mutable std::mutex trackMutex_;
+    std::condition_variable doneCv_;
+    std::deque<InFlight> inflight_;
+    uint64_t lastCmdId_ = 0;
+    uint64_t doneId_ = 0;
+    uint64_t failedFrom_ = 0;   // failed range failedFrom_..failedId_
+    uint64_t failedId_ = 0;
+    common::LatencyHistogram sendToAck_;
+    common::LatencyHistogram ackToDone_;
+    CommandEventCallback eventCallback_;
+
+    // TCP: negotiated wire format (see wire_codec.hpp)
+    uint8_t requestedFormat_ = 1;  // grs_wire::WIRE_COMPACT
+    std::atomic<uint8_t> wireFormat_{0};
+
+    // TCP: transparent reconnect
+    std::atomic<bool> autoReconnect_{true};
+    std::atomic<uint64_t> reconnects_{0};
+    uint64_t session_ = 0;  // sent with the hello and every resume, keeps the command lease
+
+    // UDP: stale-frame dropping and command retransmission
+    uint32_t lastFrameSeq_ = 0;
+    bool haveFrame_ = false;
+    bool retransmit_ = true;
+    std::chrono::milliseconds retransmitTimeout_{20};
+    static constexpr size_t kRetransmitWindow = 64;  // oldest unacknowledged commands resent per round
+    std::atomic<uint64_t> staleFrames_{0};
+    std::atomic<uint64_t> retransmits_{0};
+
+    bool canSend() const { return connected_ || (autoReconnect_ && running_); }
+    int openSocket(int type, bool quiet = false);
+    bool sendFrame(const GrsRobotCommand& cmd);
+    bool flushFrames();
+    void flushAgedBatch();
+    bool writeStream();
+    bool writeDatagrams();
+    void setCork(bool enable);
     void recvLoop();
+    bool reconnect();
+    int handshake(int fd, uint8_t flags, GrsRobotState* first);
+    void recvLoopUdp();
+    void acknowledgePending(uint64_t ackedId);
+    void trackState(const GrsRobotState& st);
+    void startSession(const GrsRobotState& first);
+    void retransmitPending();
 };
 
 } // namespace grs_io
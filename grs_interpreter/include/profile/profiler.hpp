@@ -0,0 +1,79 @@
+#ifndef PROFILER_HPP_
+#define PROFILER_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "executor/step_executor.hpp"
+
+// ═══════════════════════════════════════════════════════════════
+// grs_step --profile: where the cycle time of a program goes, per source line.
+//
+// Every statement is counted, but the clock is read only when a command is
+// emitted or acknowledged and when the executor starts or stops. From the
+// moment a command is emitted until it is acknowledged, time goes to that
+// line's WAITING_ACK time (robot, network, WAIT), which is exact. The time
+// between two clock reads is interpreter time; it is split evenly over the
+// statements started in it, so self time is exact per line only in step mode
+// and otherwise an estimate per stretch between commands. The clock runs
+// only while the executor is RUNNING or WAITING_ACK, so time stopped at a
+// step or breakpoint is not counted.
+//
+// JSON (one object, for editor margin annotations):
+//   {"program":..,"runs":..,"totalUs":..,"selfUs":..,"waitAckUs":..,
+//    "lines":[{"line":12,"hits":3,"selfUs":40,"waitAckUs":2000,"percent":31.2},..]}
+//
+// Folded stacks (flamegraph.pl, speedscope), microseconds:
+//   <program>;line 20;line 22 40           line 22 inside the IF on line 20
+//   <program>;line 20;line 22;WAITING_ACK 2000
+// ═══════════════════════════════════════════════════════════════
+
+namespace grs_profile{
+
+    struct LineProfile{
+        uint64_t hits = 0;
+        uint64_t selfNs = 0;
+        uint64_t waitAckNs = 0;
+        int parent = 0;       // line of the IF whose branch holds this line, 0 at top level
+    };
+
+    // Attach with StepExecutor::addListener; it costs nothing while detached
+    class Profiler : public grs_executor::ExecutionListener{
+        public:
+            Profiler();
+
+            void reset();
+
+            // Indexed by source line; lines that never ran have no hits
+            const std::vector<LineProfile>& lines() const { return lines_; }
+            uint64_t runs() const { return runs_; }
+
+            bool writeJson(const std::string& path, const std::string& program, std::string& error) const;
+            bool writeFolded(const std::string& path, const std::string& program, std::string& error) const;
+
+            void statementStarted(size_t pc, int line) override;
+            void blockStatementStarted(int line, size_t depth) override;
+            void commandEmitted(const grs_executor::RobotCommand& cmd) override;
+            void commandAcknowledged() override;
+            void statusChanged(grs_executor::ExecutionStatus status, int line, const std::string& error) override;
+
+        private:
+            std::vector<LineProfile> lines_;
+            std::vector<int> stack_;       // by block depth: lines of the enclosing IFs and the current one
+            std::vector<int> slice_;       // lines started since the last clock read
+            int activeLine_ = 0;
+            int ackLine_ = 0;              // line that emitted the command not yet acknowledged
+            bool waiting_ = false;
+            bool clockRunning_ = false;
+            uint64_t sliceStart_ = 0;
+            uint64_t runs_ = 0;
+
+            // Charges the time since the last clock read to the lines started in it
+            void charge(uint64_t now);
+            LineProfile& line(int line);
+            void enter(int line, int parent);
+    };
+
+}
+
+#endif //PROFILER_HPP_
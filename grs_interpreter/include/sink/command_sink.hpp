@@ -0,0 +1,119 @@
+#ifndef COMMAND_SINK_HPP_
+#define COMMAND_SINK_HPP_
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "executor/step_executor.hpp"
+
+// ═══════════════════════════════════════════════════════════════
+// grs_step --sink: where the RobotCommands a program emits are reported.
+//
+//   console              "  [ROBOT CMD] PTP target=P1 x=.. (line 5)" on stdout
+//                        (the default in step and run mode)
+//   jsonl:<file>         one JSON object per command:
+//                        {"seq":1,"tUs":120,"type":"LIN","target":"P2",
+//                         "params":{"x":100,..},"line":7}
+//                        OUTPUT has "index"/"value", WAIT has "time"
+//   bin:<file>           "GRSCMD01" record*
+//                        record := len:u32 t_ns:u64 command
+//                        command is the COMMAND record of --trace (trace.hpp)
+//   tcp:[host:]port      the JSON lines to a listening client (host 127.0.0.1)
+//
+// --sink may be given several times; every sink gets every command. Each
+// sink formats and writes on its own thread from a queue, so the executor
+// only copies the command. A full queue holds the executor back, except for
+// tcp, which drops commands rather than wait for a slow client.
+// ═══════════════════════════════════════════════════════════════
+
+namespace grs_sink{
+
+    using Param = std::pair<std::string, common::ValueType>;
+
+    struct CommandRecord{
+        uint64_t seq = 0;         // 1 for the first command
+        uint64_t timeNs = 0;      // since the sinks were opened
+        grs_executor::RobotCommand cmd;
+    };
+
+    class CommandSink{
+        public:
+            virtual ~CommandSink() = default;
+
+            virtual void write(const CommandRecord& record) = 0;
+            // Everything written so far has reached its destination
+            virtual void flush(){}
+            virtual void close(){ flush(); }
+            virtual uint64_t dropped() const { return 0; }
+    };
+
+    // Formats on a worker thread. write() copies the record into the queue;
+    // the worker writes the queue in batches and flushes after each.
+    class AsyncSink : public CommandSink{
+        public:
+            enum class Overflow{ BLOCK, DROP };
+
+            static constexpr size_t kDefaultCapacity = 4096;
+
+            AsyncSink(std::unique_ptr<CommandSink> inner, Overflow overflow,
+                      size_t capacity = kDefaultCapacity);
+            ~AsyncSink() override;
+
+            void write(const CommandRecord& record) override;
+            void flush() override;
+            void close() override;
+            uint64_t dropped() const override;
+
+        private:
+            std::unique_ptr<CommandSink> inner_;
+            Overflow overflow_;
+            size_t capacity_;
+
+            mutable std::mutex mutex_;
+            std::condition_variable ready_;     // queue has records or closing
+            std::condition_variable space_;     // queue has room
+            std::condition_variable written_;   // worker finished a batch
+            std::vector<CommandRecord> queue_;
+            uint64_t queued_ = 0;
+            uint64_t done_ = 0;
+            uint64_t dropped_ = 0;
+            bool closing_ = false;
+            std::thread worker_;
+
+            void run();
+    };
+
+    // Every command to every sink. Sinks added here are owned by it.
+    class FanOutSink : public CommandSink{
+        public:
+            FanOutSink();
+
+            void add(std::unique_ptr<CommandSink> sink);
+            bool empty() const { return sinks_.empty(); }
+
+            // Numbers and timestamps cmd, then writes it to every sink
+            void emit(const grs_executor::RobotCommand& cmd);
+
+            void write(const CommandRecord& record) override;
+            void flush() override;
+            void close() override;
+            uint64_t dropped() const override;
+
+        private:
+            std::vector<std::unique_ptr<CommandSink>> sinks_;
+            CommandRecord record_;      // keeps the params' capacity between commands
+            uint64_t startNs_;
+    };
+
+    // A sink for one --sink spec, already on its own thread; nullptr and error
+    // if the spec is unknown or its file/connection cannot be opened
+    std::unique_ptr<CommandSink> openSink(const std::string& spec, std::string& error);
+
+}
+
+#endif //COMMAND_SINK_HPP_
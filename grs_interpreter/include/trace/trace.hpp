@@ -0,0 +1,203 @@
+#ifndef TRACE_HPP_
+#define TRACE_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "common/utils.hpp"
+#include "executor/step_executor.hpp"
+#include "io/io_provider.hpp"
+
+// ═══════════════════════════════════════════════════════════════
+// grs_step --trace: binary record of one run, --replay: the same run offline.
+//
+//   file     := "GRSTRC01" start_unix_ns:u64 source_hash:u64 path:str16 record*
+//   record   := dt:varint kind:u8 payload      dt = ns since the previous record
+//   payload    STATEMENT  pc:varint line:varint
+//              VARIABLE   name:str8 value
+//              POSITION   name:str8 field:str8 value
+//              INPUT      index:u8 value:u8          a readDigitalInput result
+//              COMMAND    type:u8 line:varint, then OUTPUT index:u8 value:u8 |
+//                         WAIT ms:f64 | motion target:str8 count:u8 (key:str8 value)*
+//              ACK        (empty)                    the command was acknowledged
+//              STATUS     status:u8 line:varint, ERROR: message:str16
+//              DROPPED    count:varint               records lost before this one
+//   value    := tag:u8 then INT zigzag varint | DOUBLE f64 | BOOL u8 | STRING str16 |
+//               POSITION/FRAME/AXIS 6 x f64 | OTHER (nothing)
+//
+// type is RobotCommand::Type, status ExecutionStatus; fixed-width fields are
+// little endian (host order). STATUS is only recorded for COMPLETED and ERROR.
+// ═══════════════════════════════════════════════════════════════
+
+namespace grs_trace{
+
+    enum class RecordKind : uint8_t{
+        STATEMENT = 1, VARIABLE, POSITION, INPUT, COMMAND, ACK, STATUS, DROPPED
+    };
+
+    enum class ValueTag : uint8_t{ INT, DOUBLE, BOOL, STRING, POSITION, FRAME, AXIS, OTHER };
+
+    // kind + payload of one record, appended to out; shared by the recorder and
+    // the replay check, which compares what it sees with the recorded bytes
+    void encodeStatement(std::string& out, size_t pc, int line);
+    void encodeVariable(std::string& out, const std::string& name, const common::ValueType& value);
+    void encodePosition(std::string& out, const std::string& name, const std::string& field, const common::ValueType& value);
+    void encodeInput(std::string& out, uint8_t index, bool value);
+    void encodeCommand(std::string& out, const grs_executor::RobotCommand& cmd);
+    void encodeAck(std::string& out);
+    void encodeStatus(std::string& out, grs_executor::ExecutionStatus status, int line, const std::string& error);
+
+    // FNV-1a of the program text, stored so a replay can tell it runs something else
+    uint64_t hashSource(std::string_view source);
+
+    // Records a run into a preallocated byte ring that a writer thread drains to
+    // the file, so the executing thread neither allocates nor makes syscalls.
+    // A record that does not fit is dropped and counted; the next one that fits
+    // is preceded by a DROPPED record.
+    class TraceRecorder : public grs_executor::ExecutionListener{
+        public:
+            static constexpr size_t kDefaultRingBytes = 4u << 20;
+
+            TraceRecorder() = default;
+            ~TraceRecorder() override;
+
+            TraceRecorder(const TraceRecorder&) = delete;
+            TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+            // ringBytes is rounded up to a power of two
+            bool open(const std::string& path, const std::string& programPath, std::string_view source,
+                      size_t ringBytes, std::string& error);
+            // Drains the ring and closes the file
+            void close();
+
+            uint64_t records() const { return records_; }
+            uint64_t dropped() const { return droppedTotal_; }
+
+            void statementStarted(size_t pc, int line) override;
+            void variableWritten(const std::string& name, const common::ValueType& value) override;
+            void positionWritten(const std::string& name, const std::string& field, const common::ValueType& value) override;
+            void inputRead(uint8_t index, bool value) override;
+            void commandEmitted(const grs_executor::RobotCommand& cmd) override;
+            void commandAcknowledged() override;
+            void statusChanged(grs_executor::ExecutionStatus status, int line, const std::string& error) override;
+
+        private:
+            int fd_ = -1;
+            std::unique_ptr<char[]> ring_;
+            size_t mask_ = 0;
+            std::atomic<uint64_t> head_{0};   // bytes written by the executing thread
+            std::atomic<uint64_t> tail_{0};   // bytes written to the file
+            std::string scratch_;             // the record being built, keeps its capacity
+            uint64_t pendingNs_ = 0;          // time of the record in scratch_
+            uint64_t lastNs_ = 0;
+            uint64_t records_ = 0;
+            uint64_t droppedPending_ = 0;
+            uint64_t droppedTotal_ = 0;
+
+            std::thread writer_;
+            std::mutex mutex_;
+            std::condition_variable wake_;
+            std::atomic<bool> stop_{false};
+
+            // Starts a record: time, and the DROPPED marker if records were lost
+            std::string& begin();
+            void commit();
+            void drain();
+            void writerLoop();
+    };
+
+    struct TraceEvent{
+        RecordKind kind = RecordKind::STATEMENT;
+        uint64_t ns = 0;              // since the start of the trace
+        std::string raw;              // kind + payload, as encode*() writes it
+        size_t pc = 0;
+        int line = 0;
+        uint8_t index = 0;            // INPUT
+        bool value = false;           // INPUT
+        std::string name;             // VARIABLE/POSITION
+        std::string field;            // POSITION
+        std::string text;             // STATUS error message
+        common::ValueType data;       // VARIABLE/POSITION
+        grs_executor::RobotCommand command;
+        grs_executor::ExecutionStatus status = grs_executor::ExecutionStatus::IDLE;
+        uint64_t count = 0;           // DROPPED
+    };
+
+    struct Trace{
+        uint64_t startUnixNs = 0;
+        uint64_t sourceHash = 0;
+        std::string programPath;
+        std::vector<TraceEvent> events;
+        uint64_t dropped = 0;
+        bool truncated = false;       // the file ends inside a record (recording was cut off)
+    };
+
+    bool readTrace(const std::string& path, Trace& trace, std::string& error);
+    // One line per record, times in ms
+    void printTrace(const Trace& trace, std::FILE* out);
+    std::string describe(const TraceEvent& event);
+
+    // Answers readDigitalInput with the recorded results, in order. Outputs are
+    // kept locally. A read of another input than recorded is a divergence.
+    class ReplayIOProvider : public grs_io::IOProvider{
+        public:
+            explicit ReplayIOProvider(const Trace& trace);
+
+            bool readDigitalInput(uint8_t index) override;
+            void writeDigitalOutput(uint8_t index, bool value) override;
+            bool readDigitalOutput(uint8_t index) override;
+
+            uint32_t getOutputWord() const { return outputs_; }
+            size_t inputsReplayed() const { return next_; }
+            size_t inputsRecorded() const { return inputs_.size(); }
+            const std::string& divergence() const { return divergence_; }
+
+        private:
+            std::vector<const TraceEvent*> inputs_;
+            size_t next_ = 0;
+            uint32_t outputs_ = 0;
+            std::string divergence_;
+    };
+
+    // Checks a replayed run against the trace: statements, variable and position
+    // writes, commands and the final status must come in the recorded order.
+    // Input reads are checked by ReplayIOProvider; ACKs depend on the robot and
+    // are not compared. Checking stops at the first difference, or at a gap.
+    class TraceVerifier : public grs_executor::ExecutionListener{
+        public:
+            explicit TraceVerifier(const Trace& trace);
+
+            bool diverged() const { return !divergence_.empty(); }
+            const std::string& divergence() const { return divergence_; }
+            size_t matched() const { return matched_; }
+            // Every compared record was seen, or checking stopped at a DROPPED gap
+            bool complete() const;
+
+            void statementStarted(size_t pc, int line) override;
+            void variableWritten(const std::string& name, const common::ValueType& value) override;
+            void positionWritten(const std::string& name, const std::string& field, const common::ValueType& value) override;
+            void commandEmitted(const grs_executor::RobotCommand& cmd) override;
+            void statusChanged(grs_executor::ExecutionStatus status, int line, const std::string& error) override;
+
+        private:
+            const Trace& trace_;
+            size_t next_ = 0;
+            size_t matched_ = 0;
+            bool gap_ = false;
+            std::string live_;
+            std::string divergence_;
+
+            void check();
+            void skipUncompared();
+    };
+
+}
+
+#endif //TRACE_HPP_
@@ -0,0 +1,522 @@
+#include "batch/batch_runner.hpp"
+#include "lexer/lexer.hpp"
+#include "parser/parser.hpp"
+#include "executor/step_executor.hpp"
+#include "io/io_provider.hpp"
+#include "coverage/coverage.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <glob.h>
+#include <iostream>
+#include <memory>
+#include <poll.h>
+#include <sstream>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+namespace grs_batch{
+
+    namespace{
+
+        namespace fs = std::filesystem;
+        using Clock = std::chrono::steady_clock;
+
+        const char* kCommandTypeNames[] = {
+            "PTP","PTP_REL","LIN","LIN_REL","CIRC","CIRC_REL",
+            "SPLINE","SPLINE_REL","WAIT","OUTPUT","UNKNOWN"
+        };
+
+        enum class Outcome{ PASS, FAIL, NEW, UPDATED, TIMEOUT };
+        const char* kOutcomeNames[] = { "PASS", "FAIL", "NEW", "UPDATED", "TIMEOUT" };
+
+        struct ProgramResult{
+            Outcome outcome = Outcome::FAIL;
+            double millis = 0.0;
+            size_t commands = 0;
+            std::string detail;      // why it failed
+            std::unique_ptr<grs_coverage::FileCoverage> coverage;   // when collected and the program ran
+        };
+
+        struct InputStep{
+            double ms;
+            uint32_t inputs;
+        };
+
+        bool readFile(const std::string& path, std::string& out){
+            std::ifstream file(path);
+            if(!file.is_open()) return false;
+            out.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            return true;
+        }
+
+        // A missing script is no script
+        bool loadInputScript(const std::string& path, std::vector<InputStep>& script, std::string& error){
+            std::ifstream in(path);
+            if(!in) return true;
+            std::string line;
+            int lineNo = 0;
+            while(std::getline(in, line)){
+                lineNo++;
+                auto hash = line.find('#');
+                if(hash != std::string::npos) line.erase(hash);
+                std::istringstream fields(line);
+                double ms;
+                std::string word;
+                if(!(fields >> ms)) continue;   // blank or comment
+                unsigned long value = 0;
+                bool ok = static_cast<bool>(fields >> word);
+                if(ok){
+                    try{
+                        value = std::stoul(word, nullptr, 0);
+                    }catch(const std::exception&){
+                        ok = false;
+                    }
+                }
+                if(!ok || ms < 0 || value > 0xFFFFFFFFul || (!script.empty() && ms < script.back().ms)){
+                    error = path + ":" + std::to_string(lineNo) + ": expected \"<ms> <word>\" in ascending time";
+                    return false;
+                }
+                script.push_back({ms, static_cast<uint32_t>(value)});
+            }
+            return true;
+        }
+
+        void appendValue(std::string& out, const common::ValueType& value){
+            char buf[32];
+            if(auto* i = std::get_if<int>(&value)){
+                std::snprintf(buf, sizeof(buf), "%d", *i);
+                out += buf;
+            } else if(auto* d = std::get_if<double>(&value)){
+                std::snprintf(buf, sizeof(buf), "%.15g", *d);
+                out += buf;
+            } else {
+                out += common::valueToString(value);
+            }
+        }
+
+        void appendCommand(std::string& out, const grs_executor::RobotCommand& cmd){
+            out += std::to_string(cmd.sourceLine);
+            out += ' ';
+            out += kCommandTypeNames[static_cast<int>(cmd.type)];
+            if(cmd.type == grs_executor::RobotCommand::Type::OUTPUT){
+                out += ' ';
+                out += std::to_string(cmd.ioIndex);
+                out += cmd.ioValue ? " TRUE" : " FALSE";
+            } else if(cmd.type == grs_executor::RobotCommand::Type::WAIT){
+                out += ' ';
+                appendValue(out, cmd.waitTime);
+            } else {
+                out += ' ';
+                out += cmd.targetName;
+                std::vector<const std::pair<std::string, common::ValueType>*> params;
+                grs_executor::orderParams(cmd, params);
+                for(const auto* param : params){
+                    out += ' ';
+                    out += param->first;
+                    out += '=';
+                    appendValue(out, param->second);
+                }
+            }
+            out += '\n';
+        }
+
+        // Parses and runs one program, writing its command stream to out.
+        // With coverage, also counts what the run exercised.
+        void execute(const std::string& source, const std::vector<InputStep>& script,
+                     std::string& out, size_t& commands, std::unique_ptr<grs_coverage::FileCoverage>* coverage){
+            std::shared_ptr<grs_ast::FunctionBlock> ast;
+            try{
+                grs_lexer::Lexer lexer;
+                auto tokens = lexer.tokenize(source);
+                if(lexer.hasErrors()){
+                    for(const auto& error : lexer.getErrors()){
+                        out += std::to_string(error.getLine()) + " ERROR " + error.what() + "\n";
+                    }
+                    return;
+                }
+                grs_parser::Parser parser;
+                ast = parser.parse(tokens);
+                if(parser.hasErrors()){
+                    for(const auto& error : parser.getErrors()){
+                        out += std::to_string(error.line) + " ERROR Parse Error: " + error.message + "\n";
+                    }
+                    return;
+                }
+            }catch(const std::exception& e){
+                out += std::string("0 ERROR ") + e.what() + "\n";
+                return;
+            }
+            if(!ast){
+                out += "0 ERROR AST generation failed\n";
+                return;
+            }
+
+            auto io = std::make_shared<grs_io::LocalIOProvider>();
+            double now = 0.0;
+            size_t nextInput = 0;
+            auto applyInputs = [&](){
+                for(; nextInput < script.size() && script[nextInput].ms <= now; nextInput++){
+                    for(uint8_t bit = 0; bit < 32; bit++){
+                        io->setDigitalInput(bit, (script[nextInput].inputs >> bit) & 1);
+                    }
+                }
+            };
+            applyInputs();
+
+            grs_executor::StepExecutor executor(io);
+            executor.setCommandCallback([&](const grs_executor::RobotCommand& cmd){
+                appendCommand(out, cmd);
+                commands++;
+                if(cmd.type == grs_executor::RobotCommand::Type::WAIT){
+                    now += cmd.waitTime;
+                    applyInputs();
+                }
+                executor.acknowledgeCommand();
+            });
+            std::unique_ptr<grs_coverage::CoverageCollector> collector;
+            if(coverage){
+                collector = std::make_unique<grs_coverage::CoverageCollector>(ast);
+                executor.addListener(collector.get());
+            }
+            executor.load(ast);
+            executor.run();
+            if(collector) *coverage = std::make_unique<grs_coverage::FileCoverage>(collector->result());
+            if(executor.getStatus() == grs_executor::ExecutionStatus::ERROR){
+                out += std::to_string(executor.getCurrentLine()) + " ERROR " + executor.getErrorMessage() + "\n";
+            }
+            char end[32];
+            std::snprintf(end, sizeof(end), "END outputs=0x%08x\n", io->getOutputWord());
+            out += end;
+        }
+
+        // "line 3: expected ... got ..." for the first line that differs
+        std::string firstDifference(const std::string& expected, const std::string& actual){
+            std::istringstream e(expected), a(actual);
+            std::string el, al;
+            for(int line = 1; ; line++){
+                bool he = static_cast<bool>(std::getline(e, el));
+                bool ha = static_cast<bool>(std::getline(a, al));
+                if(!he && !ha) return "streams differ";
+                if(he != ha || el != al){
+                    return "line " + std::to_string(line) + ": expected \"" + (he ? el : "<end>") +
+                           "\" got \"" + (ha ? al : "<end>") + "\"";
+                }
+            }
+        }
+
+        std::string goldenPath(const std::string& program, const BatchOptions& options){
+            if(options.goldenDir.empty()) return program + ".golden";
+            return (fs::path(options.goldenDir) / fs::path(program).filename()).string() + ".golden";
+        }
+
+        ProgramResult runProgram(const std::string& path, const BatchOptions& options){
+            auto start = Clock::now();
+            ProgramResult result;
+            std::string source, stream, error;
+            std::vector<InputStep> script;
+            if(!readFile(path, source)){
+                result.detail = "cannot read the program";
+                return result;
+            }
+            if(!loadInputScript(path + ".inputs", script, error)){
+                result.detail = error;
+                return result;
+            }
+            execute(source, script, stream, result.commands,
+                    options.coveragePath.empty() ? nullptr : &result.coverage);
+            result.millis = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+            std::string golden;
+            std::string goldenFile = goldenPath(path, options);
+            bool haveGolden = readFile(goldenFile, golden);
+            if(haveGolden && golden == stream){
+                result.outcome = Outcome::PASS;
+            } else if(options.updateGolden){
+                std::ofstream out(goldenFile, std::ios::trunc);
+                out << stream;
+                if(out.flush()){
+                    result.outcome = Outcome::UPDATED;
+                } else {
+                    result.detail = "cannot write " + goldenFile;
+                }
+            } else if(!haveGolden){
+                result.outcome = Outcome::NEW;
+                result.detail = "no " + goldenFile + " (record it with --update-golden)";
+            } else {
+                result.detail = firstDifference(golden, stream);
+            }
+            return result;
+        }
+
+        std::vector<std::string> collectPrograms(const std::vector<std::string>& patterns){
+            std::vector<std::string> programs;
+            for(const std::string& pattern : patterns){
+                std::vector<std::string> found;
+                std::error_code ec;
+                if(fs::is_directory(pattern, ec)){
+                    for(const auto& entry : fs::directory_iterator(pattern, ec)){
+                        auto ext = entry.path().extension();
+                        if(entry.is_regular_file(ec) && (ext == ".txt" || ext == ".grs")){
+                            found.push_back(entry.path().string());
+                        }
+                    }
+                    std::sort(found.begin(), found.end());
+                } else {
+                    glob_t matches;
+                    if(::glob(pattern.c_str(), 0, nullptr, &matches) == 0){
+                        for(size_t i = 0; i < matches.gl_pathc; i++) found.push_back(matches.gl_pathv[i]);
+                    }
+                    ::globfree(&matches);
+                }
+                if(found.empty()) std::fprintf(stderr, "[BATCH] nothing matches %s\n", pattern.c_str());
+                for(auto& path : found){
+                    if(std::find(programs.begin(), programs.end(), path) == programs.end()) programs.push_back(std::move(path));
+                }
+            }
+            return programs;
+        }
+
+        // A job's result crosses the pipe from its child as text:
+        //   <outcome> <millis> <commands> <detail bytes>\n<detail>
+        //   L <line> <hits>          per covered line
+        //   B <line> <taken> <not>   per branch
+        //   E                        the end; a child that died sooner sent no result
+        std::string encodeResult(const ProgramResult& result){
+            char head[96];
+            std::snprintf(head, sizeof(head), "%d %.17g %zu %zu\n", static_cast<int>(result.outcome),
+                          result.millis, result.commands, result.detail.size());
+            std::string out = head;
+            out += result.detail;
+            out += '\n';
+            if(result.coverage){
+                for(const auto& [line, hits] : result.coverage->lines){
+                    out += "L " + std::to_string(line) + ' ' + std::to_string(hits) + '\n';
+                }
+                for(const auto& [line, counts] : result.coverage->branches){
+                    out += "B " + std::to_string(line) + ' ' + std::to_string(counts[0]) + ' ' +
+                           std::to_string(counts[1]) + '\n';
+                }
+            }
+            out += "E\n";
+            return out;
+        }
+
+        bool decodeResult(const std::string& data, ProgramResult& result){
+            std::istringstream in(data);
+            int outcome = 0;
+            size_t detailSize = 0;
+            if(!(in >> outcome >> result.millis >> result.commands >> detailSize) ||
+               outcome < 0 || outcome > static_cast<int>(Outcome::TIMEOUT)) return false;
+            result.outcome = static_cast<Outcome>(outcome);
+            in.get();
+            result.detail.resize(detailSize);
+            if(detailSize > 0 && !in.read(&result.detail[0], static_cast<std::streamsize>(detailSize))) return false;
+            std::string kind;
+            while(in >> kind){
+                if(kind == "E") return true;
+                if(!result.coverage) result.coverage = std::make_unique<grs_coverage::FileCoverage>();
+                int line = 0;
+                if(kind == "L"){
+                    uint64_t hits = 0;
+                    if(!(in >> line >> hits)) return false;
+                    result.coverage->lines[line] = hits;
+                } else if(kind == "B"){
+                    std::array<uint64_t, 2> counts{};
+                    if(!(in >> line >> counts[0] >> counts[1])) return false;
+                    result.coverage->branches[line] = counts;
+                } else {
+                    return false;
+                }
+            }
+            return false;
+        }
+
+        bool writeAll(int fd, const std::string& data){
+            size_t done = 0;
+            while(done < data.size()){
+                ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+                if(n < 0 && errno == EINTR) continue;
+                if(n <= 0) return false;
+                done += static_cast<size_t>(n);
+            }
+            return true;
+        }
+
+        struct Job{
+            std::string path;
+            ProgramResult result;
+        };
+
+        // A program running in its own process, so a hung one can be killed
+        struct Child{
+            size_t job = 0;
+            pid_t pid = -1;
+            int fd = -1;             // read end of its result pipe
+            Clock::time_point start;
+            std::string data;        // result received so far
+        };
+
+        // Forks the job's process: its stdout is /dev/null, which takes the
+        // token trace of the lexer and parser; the result comes back on a pipe
+        bool startChild(const Job& job, size_t index, const BatchOptions& options, Child& child, std::string& error){
+            int fds[2];
+            if(::pipe(fds) != 0){
+                error = std::string("pipe: ") + std::strerror(errno);
+                return false;
+            }
+            std::fflush(stdout);
+            std::cout.flush();
+            pid_t pid = ::fork();
+            if(pid < 0){
+                error = std::string("fork: ") + std::strerror(errno);
+                ::close(fds[0]);
+                ::close(fds[1]);
+                return false;
+            }
+            if(pid == 0){
+                ::close(fds[0]);
+                int null = ::open("/dev/null", O_WRONLY);
+                if(null >= 0) ::dup2(null, STDOUT_FILENO);
+                // Nothing this process prints is read; skip formatting the trace at all
+                std::cout.setstate(std::ios::badbit);
+                ProgramResult result = runProgram(job.path, options);
+                ::_exit(writeAll(fds[1], encodeResult(result)) ? 0 : 1);
+            }
+            ::close(fds[1]);
+            child.job = index;
+            child.pid = pid;
+            child.fd = fds[0];
+            child.start = Clock::now();
+            child.data.clear();
+            return true;
+        }
+
+        // Reaps a child whose pipe closed; false when it sent no complete result
+        bool finishChild(Child& child, ProgramResult& result){
+            ::close(child.fd);
+            int status = 0;
+            while(::waitpid(child.pid, &status, 0) < 0 && errno == EINTR){}
+            if(decodeResult(child.data, result)) return true;
+            result = ProgramResult{};
+            result.millis = std::chrono::duration<double, std::milli>(Clock::now() - child.start).count();
+            if(WIFSIGNALED(status)){
+                result.detail = std::string("crashed: ") + strsignal(WTERMSIG(status));
+            } else {
+                result.detail = "exited with status " + std::to_string(WEXITSTATUS(status)) + " without a result";
+            }
+            return false;
+        }
+
+        void killChild(Child& child, ProgramResult& result, double timeoutSeconds){
+            ::kill(child.pid, SIGKILL);
+            ::close(child.fd);
+            while(::waitpid(child.pid, nullptr, 0) < 0 && errno == EINTR){}
+            result = ProgramResult{};
+            result.outcome = Outcome::TIMEOUT;
+            result.millis = std::chrono::duration<double, std::milli>(Clock::now() - child.start).count();
+            char detail[64];
+            std::snprintf(detail, sizeof(detail), "killed after %gs", timeoutSeconds);
+            result.detail = detail;
+        }
+
+    }
+
+    int runBatch(const BatchOptions& options){
+        std::vector<Job> jobs;
+        for(auto& path : collectPrograms(options.patterns)) jobs.push_back(Job{std::move(path), ProgramResult{}});
+        if(jobs.empty()){
+            std::fprintf(stderr, "[BATCH] no programs to run\n");
+            return 1;
+        }
+
+        unsigned workers = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+        workers = static_cast<unsigned>(std::min<size_t>(workers, jobs.size()));
+
+        auto start = Clock::now();
+        auto timeout = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.timeoutSeconds));
+        std::vector<Child> running;
+        std::vector<pollfd> fds;
+        size_t next = 0;
+        while(next < jobs.size() || !running.empty()){
+            while(next < jobs.size() && running.size() < workers){
+                Child child;
+                std::string error;
+                if(startChild(jobs[next], next, options, child, error)){
+                    running.push_back(std::move(child));
+                } else {
+                    jobs[next].result.detail = error;
+                }
+                next++;
+            }
+            if(running.empty()) continue;
+
+            fds.clear();
+            for(const Child& child : running) fds.push_back({child.fd, POLLIN, 0});
+            if(::poll(fds.data(), fds.size(), 50) < 0 && errno != EINTR){
+                std::fprintf(stderr, "[BATCH] poll: %s\n", std::strerror(errno));
+                break;
+            }
+            auto now = Clock::now();
+            for(size_t i = running.size(); i-- > 0;){
+                Child& child = running[i];
+                bool closed = false;
+                if(fds[i].revents & (POLLIN | POLLHUP | POLLERR)){
+                    char buf[4096];
+                    ssize_t n = ::read(child.fd, buf, sizeof(buf));
+                    if(n > 0) child.data.append(buf, static_cast<size_t>(n));
+                    else closed = n == 0 || errno != EINTR;
+                }
+                if(closed){
+                    finishChild(child, jobs[child.job].result);
+                } else if(now - child.start >= timeout){
+                    killChild(child, jobs[child.job].result, options.timeoutSeconds);
+                } else {
+                    continue;
+                }
+                running.erase(running.begin() + static_cast<std::ptrdiff_t>(i));
+            }
+        }
+        for(Child& child : running) killChild(child, jobs[child.job].result, options.timeoutSeconds);
+        double wallMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        size_t counts[5] = {};
+        double programMs = 0.0;
+        for(const auto& job : jobs){
+            const ProgramResult& r = job.result;
+            counts[static_cast<int>(r.outcome)]++;
+            programMs += r.millis;
+            std::printf("%-7s %9.2f ms  %s (%zu commands)\n", kOutcomeNames[static_cast<int>(r.outcome)],
+                        r.millis, job.path.c_str(), r.commands);
+            if(!r.detail.empty()) std::printf("        %s\n", r.detail.c_str());
+        }
+        std::printf("%zu programs: %zu passed, %zu failed, %zu new, %zu updated, %zu timed out\n",
+                    jobs.size(), counts[0], counts[1], counts[2], counts[3], counts[4]);
+        std::printf("%.1f ms wall, %.1f ms in programs, %u jobs\n", wallMs, programMs, workers);
+
+        bool coverageOk = true;
+        if(!options.coveragePath.empty()){
+            grs_coverage::CoverageReport report;
+            for(const auto& job : jobs){
+                if(job.result.coverage) report.merge(job.path, *job.result.coverage);
+            }
+            grs_coverage::CoverageSummary summary;
+            std::string error;
+            coverageOk = grs_coverage::saveLcov(options.coveragePath, report, options.coverageAppend, summary, error);
+            if(coverageOk) grs_coverage::printSummary(stdout, summary, options.coveragePath);
+            else std::fprintf(stderr, "[BATCH] %s\n", error.c_str());
+        }
+        std::fflush(stdout);
+        return counts[0] + counts[3] == jobs.size() && coverageOk ? 0 : 1;
+    }
+
+}
@@ -0,0 +1,224 @@
+#include "coverage/coverage.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace grs_coverage{
+
+    namespace{
+
+        int lineOf(const grs_ast::ASTNode& node){
+            const auto& lc = node.getLineColumn();
+            return lc.empty() ? 0 : lc.front().first;
+        }
+
+        void mark(std::vector<bool>& set, int line){
+            if(line <= 0) return;
+            if(static_cast<size_t>(line) >= set.size()) set.resize(line + 1, false);
+            set[line] = true;
+        }
+
+        std::string absolute(const std::string& path){
+            std::error_code ec;
+            auto abs = std::filesystem::absolute(path, ec);
+            return ec ? path : abs.lexically_normal().string();
+        }
+
+        // A hit count, "-" (never reached) is 0
+        bool parseCount(const char* text, uint64_t& count){
+            if(std::strcmp(text, "-") == 0){ count = 0; return true; }
+            char* end = nullptr;
+            count = std::strtoull(text, &end, 10);
+            return end != text;
+        }
+
+    }
+
+    void FileCoverage::merge(const FileCoverage& other){
+        for(const auto& [line, hits] : other.lines) lines[line] += hits;
+        for(const auto& [line, counts] : other.branches){
+            auto& mine = branches[line];
+            mine[0] += counts[0];
+            mine[1] += counts[1];
+        }
+    }
+
+    void CoverageReport::merge(const std::string& path, const FileCoverage& file){
+        files_[absolute(path)].merge(file);
+    }
+
+    void CoverageReport::merge(const CoverageReport& other){
+        for(const auto& [path, file] : other.files_) files_[path].merge(file);
+    }
+
+    bool CoverageReport::readLcov(const std::string& path, std::string& error){
+        std::ifstream in(path);
+        if(!in){
+            error = "cannot open " + path;
+            return false;
+        }
+        std::string line;
+        FileCoverage* file = nullptr;
+        int lineNo = 0;
+        while(std::getline(in, line)){
+            lineNo++;
+            if(line.compare(0, 3, "SF:") == 0){
+                file = &files_[line.substr(3)];
+            } else if(line == "end_of_record"){
+                file = nullptr;
+            } else if(file && line.compare(0, 3, "DA:") == 0){
+                int number = 0;
+                uint64_t hits = 0;
+                size_t comma = line.find(',');
+                if(comma == std::string::npos || !parseCount(line.c_str() + comma + 1, hits)){
+                    error = path + ":" + std::to_string(lineNo) + ": bad DA record";
+                    return false;
+                }
+                number = std::atoi(line.c_str() + 3);
+                file->lines[number] += hits;
+            } else if(file && line.compare(0, 5, "BRDA:") == 0){
+                // BRDA:<line>,<block>,<branch>,<count>
+                int number = 0, block = 0, branch = 0;
+                char count[32] = {};
+                uint64_t taken = 0;
+                if(std::sscanf(line.c_str() + 5, "%d,%d,%d,%31s", &number, &block, &branch, count) != 4 ||
+                   !parseCount(count, taken)){
+                    error = path + ":" + std::to_string(lineNo) + ": bad BRDA record";
+                    return false;
+                }
+                if(branch == 0 || branch == 1) file->branches[number][branch] += taken;
+            }
+            // TN, BRF/BRH, LF/LH are recomputed on write
+        }
+        return true;
+    }
+
+    bool CoverageReport::writeLcov(const std::string& path, std::string& error) const{
+        std::FILE* out = std::fopen(path.c_str(), "w");
+        if(!out){
+            error = "cannot create " + path + ": " + std::strerror(errno);
+            return false;
+        }
+        for(const auto& [source, file] : files_){
+            std::fprintf(out, "TN:\nSF:%s\n", source.c_str());
+            size_t branchesHit = 0;
+            for(const auto& [line, counts] : file.branches){
+                bool reached = counts[0] + counts[1] > 0;
+                for(int branch = 0; branch < 2; branch++){
+                    if(reached) std::fprintf(out, "BRDA:%d,0,%d,%llu\n", line, branch, (unsigned long long)counts[branch]);
+                    else std::fprintf(out, "BRDA:%d,0,%d,-\n", line, branch);
+                    if(counts[branch] > 0) branchesHit++;
+                }
+            }
+            std::fprintf(out, "BRF:%zu\nBRH:%zu\n", file.branches.size() * 2, branchesHit);
+            size_t linesHit = 0;
+            for(const auto& [line, hits] : file.lines){
+                std::fprintf(out, "DA:%d,%llu\n", line, (unsigned long long)hits);
+                if(hits > 0) linesHit++;
+            }
+            std::fprintf(out, "LF:%zu\nLH:%zu\nend_of_record\n", file.lines.size(), linesHit);
+        }
+        bool ok = std::ferror(out) == 0;
+        if(std::fclose(out) != 0) ok = false;
+        if(!ok) error = "cannot write " + path;
+        return ok;
+    }
+
+    bool saveLcov(const std::string& path, const CoverageReport& report, bool append,
+                  CoverageSummary& summary, std::string& error){
+        CoverageReport saved;
+        std::error_code ec;
+        if(append && std::filesystem::exists(path, ec) && !saved.readLcov(path, error)) return false;
+        saved.merge(report);
+        summary = saved.summary();
+        return saved.writeLcov(path, error);
+    }
+
+    CoverageSummary CoverageReport::summary() const{
+        CoverageSummary s;
+        for(const auto& [source, file] : files_){
+            for(const auto& [line, hits] : file.lines){
+                s.lines++;
+                if(hits > 0) s.linesHit++;
+            }
+            for(const auto& [line, counts] : file.branches){
+                s.branches += 2;
+                s.branchesHit += (counts[0] > 0) + (counts[1] > 0);
+            }
+        }
+        return s;
+    }
+
+    void printSummary(std::FILE* out, const CoverageSummary& s, const std::string& path){
+        auto percent = [](size_t hit, size_t total){ return total ? 100.0 * hit / total : 100.0; };
+        std::fprintf(out, "[COVERAGE] lines %zu/%zu (%.1f%%), branches %zu/%zu (%.1f%%) in %s\n",
+                     s.linesHit, s.lines, percent(s.linesHit, s.lines),
+                     s.branchesHit, s.branches, percent(s.branchesHit, s.branches), path.c_str());
+    }
+
+    CoverageCollector::CoverageCollector(const std::shared_ptr<grs_ast::FunctionBlock>& program){
+        instrument(program);
+        size_t size = std::max(statementLines_.size(), ifLines_.size());
+        lineHits_.assign(size, 0);
+        branchHits_.assign(size, {0, 0});
+    }
+
+    void CoverageCollector::instrument(const std::shared_ptr<grs_ast::ASTNode>& node){
+        if(!node) return;
+        // Blocks have no line of their own: the program and IF branches
+        if(node->getType() == grs_ast::ASTNodeType::Program){
+            auto block = std::static_pointer_cast<grs_ast::FunctionBlock>(node);
+            for(const auto& stmt : block->getStatements()) instrument(stmt);
+            return;
+        }
+        int line = lineOf(*node);
+        mark(statementLines_, line);
+        if(node->getType() == grs_ast::ASTNodeType::IfStatement){
+            auto stmt = std::static_pointer_cast<grs_ast::IfStatement>(node);
+            mark(ifLines_, line);
+            instrument(stmt->getThenBranch());
+            instrument(stmt->getElseBranch());
+        }
+    }
+
+    void CoverageCollector::hit(int line){
+        if(line <= 0) return;
+        if(static_cast<size_t>(line) >= lineHits_.size()){
+            lineHits_.resize(line + 1, 0);
+            branchHits_.resize(line + 1, {0, 0});
+        }
+        lineHits_[line]++;
+    }
+
+    void CoverageCollector::statementStarted(size_t, int line){ hit(line); }
+
+    void CoverageCollector::blockStatementStarted(int line, size_t){ hit(line); }
+
+    void CoverageCollector::branchEvaluated(int line, bool condition){
+        if(line <= 0) return;
+        if(static_cast<size_t>(line) >= branchHits_.size()){
+            lineHits_.resize(line + 1, 0);
+            branchHits_.resize(line + 1, {0, 0});
+        }
+        branchHits_[line][condition ? 0 : 1]++;
+    }
+
+    FileCoverage CoverageCollector::result() const{
+        FileCoverage file;
+        for(size_t line = 1; line < lineHits_.size(); line++){
+            bool isStatement = line < statementLines_.size() && statementLines_[line];
+            bool isIf = line < ifLines_.size() && ifLines_[line];
+            // Lines that ran without being known (program reloaded meanwhile) are kept too
+            if(isStatement || lineHits_[line] > 0) file.lines[static_cast<int>(line)] = lineHits_[line];
+            if(isIf || branchHits_[line][0] + branchHits_[line][1] > 0){
+                file.branches[static_cast<int>(line)] = branchHits_[line];
+            }
+        }
+        return file;
+    }
+
+}
@@ -0,0 +1,270 @@
+#include "debug/debug_protocol.hpp"
+
+#include <cstring>
+#include <unistd.h>
+
+namespace grs_debug{
+
+    namespace{
+
+        constexpr size_t kHeader = 4;
+        constexpr uint32_t kMaxRequest = 16u << 20;
+
+        class BinaryProtocol : public DebugProtocol{
+            public:
+                BinaryProtocol(int inFd, int outFd) : DebugProtocol(inFd, outFd){
+                    out_.reserve(16384);
+                }
+
+                void initialized(int line) override{
+                    begin(EventKind::INITIALIZED);
+                    putI32(line);
+                    end();
+                }
+
+                void stopped(int line, StopReason reason) override{
+                    begin(EventKind::STOPPED);
+                    putI32(line);
+                    putU8(static_cast<uint8_t>(reason));
+                    end();
+                }
+
+                void terminated() override{ begin(EventKind::TERMINATED); end(); }
+
+                void error(std::string_view message) override{
+                    begin(EventKind::ERROR);
+                    putStr16(message);
+                    end();
+                }
+
+                void output(const grs_executor::RobotCommand& cmd) override{
+                    begin(EventKind::OUTPUT);
+                    putU8(static_cast<uint8_t>(cmd.type));
+                    putI32(cmd.sourceLine);
+                    if(cmd.type == grs_executor::RobotCommand::Type::OUTPUT){
+                        putU8(cmd.ioIndex);
+                        putU8(cmd.ioValue ? 1 : 0);
+                    } else if(cmd.type == grs_executor::RobotCommand::Type::WAIT){
+                        putF64(cmd.waitTime);
+                    } else {
+                        putStr16(cmd.targetName);
+                        size_t count = cmd.params.size() < 255 ? cmd.params.size() : 255;
+                        putU8(static_cast<uint8_t>(count));
+                        for(size_t i = 0; i < count; i++){
+                            putStr8(cmd.params[i].first);
+                            putValue(cmd.params[i].second);
+                        }
+                    }
+                    end();
+                }
+
+                void breakpointSet(int line) override{
+                    begin(EventKind::BREAKPOINT_SET);
+                    putI32(line);
+                    end();
+                }
+
+                void breakpointRemoved(int line) override{
+                    begin(EventKind::BREAKPOINT_REMOVED);
+                    putI32(line);
+                    end();
+                }
+
+                void breakpointsCleared() override{ begin(EventKind::BREAKPOINTS_CLEARED); end(); }
+
+                void variables(const VariableMap& vars) override{
+                    begin(EventKind::VARIABLES);
+                    uint16_t count = vars.size() < 0xFFFF ? static_cast<uint16_t>(vars.size()) : 0xFFFF;
+                    putRaw(&count, 2);
+                    uint16_t written = 0;
+                    for(const auto& [name, value] : vars){
+                        if(written++ == count) break;
+                        putStr8(name);
+                        putValue(value);
+                    }
+                    end();
+                }
+
+                void io(const IOSnapshot& io) override{
+                    begin(EventKind::IO);
+                    putRaw(&io.inputs, 4);
+                    putRaw(&io.outputs, 4);
+                    putU8((io.hasReady ? 1 : 0) | (io.ready ? 2 : 0));
+                    end();
+                }
+
+                void latency(const common::LatencyHistogram* sendToAck,
+                             const common::LatencyHistogram* ackToDone) override{
+                    begin(EventKind::LATENCY);
+                    putU8(sendToAck && ackToDone ? 1 : 0);
+                    if(sendToAck && ackToDone){
+                        putHistogram(*sendToAck);
+                        putHistogram(*ackToDone);
+                    }
+                    end();
+                }
+
+                void latencyReset() override{ begin(EventKind::LATENCY_RESET); end(); }
+
+                void loaded(std::string_view path, int line, bool parsed) override{
+                    begin(EventKind::LOADED);
+                    putI32(line);
+                    putU8(parsed ? 1 : 0);
+                    putStr16(path);
+                    end();
+                }
+
+                void delta(const StateDelta& delta) override{
+                    begin(EventKind::DELTA);
+                    putU64(delta.version);
+                    putU64(delta.base);
+                    putU8(delta.full ? 1 : 0);
+                    uint16_t count = delta.variables.size() < 0xFFFF ? static_cast<uint16_t>(delta.variables.size()) : 0xFFFF;
+                    putRaw(&count, 2);
+                    for(uint16_t i = 0; i < count; i++){
+                        putStr8(delta.variables[i]->first);
+                        putValue(delta.variables[i]->second);
+                    }
+                    putU8(delta.hasIO ? 1 : 0);
+                    if(delta.hasIO){
+                        putRaw(&delta.io.inputs, 4);
+                        putRaw(&delta.io.outputs, 4);
+                        putU8((delta.io.hasReady ? 1 : 0) | (delta.io.ready ? 2 : 0));
+                        putRaw(&delta.inputsChanged, 4);
+                        putRaw(&delta.outputsChanged, 4);
+                    }
+                    end();
+                }
+
+                void flush() override{
+                    size_t off = 0;
+                    while(off < out_.size()){
+                        ssize_t n = ::write(outFd_, out_.data() + off, out_.size() - off);
+                        if(n <= 0) break;
+                        off += static_cast<size_t>(n);
+                    }
+                    out_.clear();
+                }
+
+            protected:
+                size_t decodeRequest(const char* data, size_t len, bool atEof, DebugRequest& request) override{
+                    request.clear();
+                    if(len < kHeader){
+                        // A truncated header at the end of the stream is dropped
+                        return atEof ? len : 0;
+                    }
+                    uint32_t body;
+                    std::memcpy(&body, data, 4);
+                    if(body == 0 || body > kMaxRequest){
+                        // Cannot find the next frame boundary again, drop what is buffered
+                        request.type = DebugRequest::Type::MALFORMED;
+                        return len;
+                    }
+                    if(len < kHeader + body) return atEof ? len : 0;
+
+                    const char* p = data + kHeader;
+                    uint8_t kind = static_cast<uint8_t>(p[0]);
+                    if(kind >= static_cast<uint8_t>(DebugRequest::Type::STEP) &&
+                       kind <= static_cast<uint8_t>(DebugRequest::Type::UNSUBSCRIBE)){
+                        request.type = static_cast<DebugRequest::Type>(kind);
+                    }
+                    if(request.type == DebugRequest::Type::SET_BREAKPOINT ||
+                       request.type == DebugRequest::Type::REMOVE_BREAKPOINT){
+                        if(body < 5) request.type = DebugRequest::Type::MALFORMED;
+                        else {
+                            int32_t line;
+                            std::memcpy(&line, p + 1, 4);
+                            request.line = line;
+                        }
+                    }
+                    if(request.type == DebugRequest::Type::LOAD || request.type == DebugRequest::Type::RELOAD){
+                        if(body < 2){
+                            if(request.type == DebugRequest::Type::LOAD) request.type = DebugRequest::Type::MALFORMED;
+                        } else {
+                            request.isSource = (p[1] & 1) != 0;
+                            request.live = (p[1] & 2) != 0;
+                            request.text.assign(p + 2, body - 2);
+                        }
+                    }
+                    if(request.type == DebugRequest::Type::SUBSCRIBE && body >= 9){
+                        std::memcpy(&request.since, p + 1, 8);
+                    }
+                    return kHeader + body;
+                }
+
+            private:
+                std::vector<char> out_;   // keeps its capacity, frames are built in place
+                size_t frameStart_ = 0;
+
+                void begin(EventKind kind){
+                    frameStart_ = out_.size();
+                    out_.resize(out_.size() + kHeader);
+                    putU8(static_cast<uint8_t>(kind));
+                }
+
+                void end(){
+                    uint32_t body = static_cast<uint32_t>(out_.size() - frameStart_ - kHeader);
+                    std::memcpy(out_.data() + frameStart_, &body, 4);
+                }
+
+                void putRaw(const void* p, size_t n){
+                    const char* c = static_cast<const char*>(p);
+                    out_.insert(out_.end(), c, c + n);
+                }
+                void putU8(uint8_t v){ out_.push_back(static_cast<char>(v)); }
+                void putI32(int32_t v){ putRaw(&v, 4); }
+                void putF64(double v){ putRaw(&v, 8); }
+                void putU64(uint64_t v){ putRaw(&v, 8); }
+
+                void putStr8(std::string_view s){
+                    size_t n = s.size() < 0xFF ? s.size() : 0xFF;
+                    putU8(static_cast<uint8_t>(n));
+                    putRaw(s.data(), n);
+                }
+
+                void putStr16(std::string_view s){
+                    uint16_t n = s.size() < 0xFFFF ? static_cast<uint16_t>(s.size()) : 0xFFFF;
+                    putRaw(&n, 2);
+                    putRaw(s.data(), n);
+                }
+
+                void putValue(const common::ValueType& value){
+                    std::visit([this](const auto& v){
+                        using T = std::decay_t<decltype(v)>;
+                        if constexpr (std::is_same_v<T, int>){ putU8((uint8_t)ValueTag::INT); putI32(v); }
+                        else if constexpr (std::is_same_v<T, double>){ putU8((uint8_t)ValueTag::DOUBLE); putF64(v); }
+                        else if constexpr (std::is_same_v<T, bool>){ putU8((uint8_t)ValueTag::BOOL); putU8(v ? 1 : 0); }
+                        else if constexpr (std::is_same_v<T, std::string>){ putU8((uint8_t)ValueTag::STRING); putStr16(v); }
+                        else if constexpr (std::is_same_v<T, common::Position> || std::is_same_v<T, common::Frame>){
+                            putU8((uint8_t)(std::is_same_v<T, common::Position> ? ValueTag::POSITION : ValueTag::FRAME));
+                            double f[6] = {v.x, v.y, v.z, v.a, v.b, v.c};
+                            putRaw(f, sizeof(f));
+                        }
+                        else if constexpr (std::is_same_v<T, common::Axis>){
+                            putU8((uint8_t)ValueTag::AXIS);
+                            double f[6] = {v.A1, v.A2, v.A3, v.A4, v.A5, v.A6};
+                            putRaw(f, sizeof(f));
+                        }
+                        else putU8((uint8_t)ValueTag::OTHER);
+                    }, value);
+                }
+
+                void putHistogram(const common::LatencyHistogram& h){
+                    putU64(h.count());
+                    putU64(h.min());
+                    putU64(static_cast<uint64_t>(h.mean() + 0.5));
+                    putU64(h.percentile(50.0));
+                    putU64(h.percentile(90.0));
+                    putU64(h.percentile(99.0));
+                    putU64(h.percentile(99.9));
+                    putU64(h.max());
+                }
+        };
+
+    }
+
+    std::unique_ptr<DebugProtocol> makeBinaryProtocol(int inFd, int outFd){
+        return std::make_unique<BinaryProtocol>(inFd, outFd);
+    }
+
+}
@@ -0,0 +1,42 @@
+#include "debug/debug_protocol.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+namespace grs_debug{
+
+    namespace{
+        constexpr size_t kReadChunk = 4096;
+    }
+
+    DebugProtocol::DebugProtocol(int inFd, int outFd)
+        : inFd_(inFd), outFd_(outFd), in_(2 * kReadChunk){}
+
+    bool DebugProtocol::readRequest(DebugRequest& request){
+        while(true){
+            if(inEnd_ > inBegin_ || eof_){
+                size_t used = decodeRequest(in_.data() + inBegin_, inEnd_ - inBegin_, eof_, request);
+                if(used > 0){
+                    inBegin_ += used;
+                    return true;
+                }
+                if(eof_) return false;
+            }
+
+            // Keep the unread tail at the front, grow only for a request larger than the buffer
+            if(inBegin_ > 0){
+                std::memmove(in_.data(), in_.data() + inBegin_, inEnd_ - inBegin_);
+                inEnd_ -= inBegin_;
+                inBegin_ = 0;
+            }
+            if(in_.size() - inEnd_ < kReadChunk) in_.resize(in_.size() * 2);
+
+            ssize_t n = ::read(inFd_, in_.data() + inEnd_, in_.size() - inEnd_);
+            if(n < 0 && errno == EINTR) return false;  // a signal: the caller decides
+            if(n <= 0) eof_ = true;
+            else inEnd_ += static_cast<size_t>(n);
+        }
+    }
+
+}
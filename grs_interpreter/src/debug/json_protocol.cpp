@@ -0,0 +1,273 @@
+#include "debug/debug_protocol.hpp"
+#include "common/json.hpp"
+
+#include <cstring>
+
+namespace grs_debug{
+
+    namespace{
+
+        const char* kCommandTypeNames[] = {
+            "PTP","PTP_REL","LIN","LIN_REL","CIRC","CIRC_REL",
+            "SPLINE","SPLINE_REL","WAIT","OUTPUT","UNKNOWN"
+        };
+
+        struct NamedRequest{
+            const char* name;
+            DebugRequest::Type type;
+        };
+
+        const NamedRequest kRequests[] = {
+            {"step", DebugRequest::Type::STEP},
+            {"continue", DebugRequest::Type::CONTINUE},
+            {"setBreakpoint", DebugRequest::Type::SET_BREAKPOINT},
+            {"removeBreakpoint", DebugRequest::Type::REMOVE_BREAKPOINT},
+            {"clearBreakpoints", DebugRequest::Type::CLEAR_BREAKPOINTS},
+            {"getVariables", DebugRequest::Type::GET_VARIABLES},
+            {"getIO", DebugRequest::Type::GET_IO},
+            {"getLatency", DebugRequest::Type::GET_LATENCY},
+            {"resetLatency", DebugRequest::Type::RESET_LATENCY},
+            {"disconnect", DebugRequest::Type::DISCONNECT},
+            {"load", DebugRequest::Type::LOAD},
+            {"reload", DebugRequest::Type::RELOAD},
+            {"subscribe", DebugRequest::Type::SUBSCRIBE},
+            {"unsubscribe", DebugRequest::Type::UNSUBSCRIBE},
+        };
+
+        // Same text as common::valueToString(), written straight into a JSON string
+        void writeValueText(common::JsonWriter& out, const common::ValueType& value){
+            out.beginString();
+            std::visit([&out](const auto& v){
+                using T = std::decay_t<decltype(v)>;
+                if constexpr (std::is_same_v<T, int>) out.textf("%d", v);
+                else if constexpr (std::is_same_v<T, double>) out.textf("%f", v);
+                else if constexpr (std::is_same_v<T, bool>) out.text(v ? "TRUE" : "FALSE");
+                else if constexpr (std::is_same_v<T, std::string>) out.text(v);
+                else if constexpr (std::is_same_v<T, common::Position> || std::is_same_v<T, common::Frame>){
+                    out.textf("{x : %f , y : %f , z : %f , a : %f , b : %f , c : %f }", v.x, v.y, v.z, v.a, v.b, v.c);
+                }
+                else if constexpr (std::is_same_v<T, common::Axis>){
+                    out.textf("{A1 : %f , A2 : %f , A3 : %f , A4 : %f , A5 : %f , A6 : %f }",
+                              v.A1, v.A2, v.A3, v.A4, v.A5, v.A6);
+                }
+                else out.text("<expr>");
+            }, value);
+            out.endString();
+        }
+
+        // Numeric params stay JSON numbers
+        void writeParam(common::JsonWriter& out, const std::string& key, const common::ValueType& v){
+            out.key(key);
+            if(auto* i = std::get_if<int>(&v)) out.value(*i);
+            else if(auto* d = std::get_if<double>(&v)) out.value(*d);
+            else if(auto* b = std::get_if<bool>(&v)) out.value(*b);
+            else writeValueText(out, v);
+        }
+
+        void writeHistogram(common::JsonWriter& out, const common::LatencyHistogram& h){
+            out.beginObject()
+               .member("count", h.count()).member("min", h.min())
+               .member("mean", static_cast<uint64_t>(h.mean() + 0.5))
+               .member("p50", h.percentile(50.0)).member("p90", h.percentile(90.0))
+               .member("p99", h.percentile(99.0)).member("p999", h.percentile(99.9))
+               .member("max", h.max())
+               .endObject();
+        }
+
+        class JsonProtocol : public DebugProtocol{
+            public:
+                JsonProtocol(int inFd, int outFd) : DebugProtocol(inFd, outFd), out_(outFd){}
+
+                void initialized(int line) override{
+                    out_.beginObject().member("event", "initialized").member("line", line).endObject();
+                    out_.endLine();
+                }
+
+                void stopped(int line, StopReason reason) override{
+                    out_.beginObject().member("event", "stopped").member("line", line)
+                        .member("reason", reason == StopReason::STEP ? "step" : "breakpoint").endObject();
+                    out_.endLine();
+                }
+
+                void terminated() override{ simple("terminated"); }
+
+                void error(std::string_view message) override{
+                    out_.beginObject().member("event", "error").member("message", message).endObject();
+                    out_.endLine();
+                }
+
+                void output(const grs_executor::RobotCommand& cmd) override{
+                    out_.beginObject().member("event", "output")
+                        .member("type", kCommandTypeNames[static_cast<int>(cmd.type)]);
+                    if(cmd.type == grs_executor::RobotCommand::Type::OUTPUT){
+                        out_.member("index", (int)cmd.ioIndex).member("value", cmd.ioValue);
+                    } else if(cmd.type == grs_executor::RobotCommand::Type::WAIT){
+                        out_.member("time", cmd.waitTime);
+                    } else {
+                        out_.member("target", cmd.targetName);
+                        // Include position parameters in x,y,z,a,b,c order for IDE display
+                        if(!cmd.params.empty()){
+                            out_.key("params").beginObject();
+                            // Output in canonical order: x,y,z,a,b,c then a1-a6/A1-A6
+                            static const std::string orderedKeys[] = {
+                                "x","y","z","a","b","c",
+                                "a1","a2","a3","a4","a5","a6",
+                                "A1","A2","A3","A4","A5","A6"
+                            };
+                            // First: known keys in order
+                            for(const auto& ok : orderedKeys){
+                                for(const auto& [k, v] : cmd.params){
+                                    if(k == ok){
+                                        writeParam(out_, k, v);
+                                        break;
+                                    }
+                                }
+                            }
+                            // Then: any remaining keys not in ordered list
+                            for(const auto& [k, v] : cmd.params){
+                                bool found = false;
+                                for(const auto& ok : orderedKeys){
+                                    if(k == ok){ found = true; break; }
+                                }
+                                if(!found) writeParam(out_, k, v);
+                            }
+                            out_.endObject();
+                        }
+                    }
+                    out_.member("line", cmd.sourceLine).endObject();
+                    out_.endLine();
+                }
+
+                void breakpointSet(int line) override{
+                    out_.beginObject().member("event", "breakpointSet").member("line", line).endObject();
+                    out_.endLine();
+                }
+
+                void breakpointRemoved(int line) override{
+                    out_.beginObject().member("event", "breakpointRemoved").member("line", line).endObject();
+                    out_.endLine();
+                }
+
+                void breakpointsCleared() override{ simple("breakpointsCleared"); }
+
+                void variables(const VariableMap& vars) override{
+                    out_.beginObject().member("event", "variables").key("data").beginArray();
+                    for(const auto& [name, value] : vars){
+                        out_.beginObject().member("name", name).key("value");
+                        writeValueText(out_, value);
+                        out_.endObject();
+                    }
+                    out_.endArray().endObject();
+                    out_.endLine();
+                }
+
+                void io(const IOSnapshot& io) override{
+                    out_.beginObject().member("event", "io").member("inputs", io.inputs).member("outputs", io.outputs);
+                    if(io.hasReady) out_.member("ready", io.ready);
+                    out_.endObject();
+                    out_.endLine();
+                }
+
+                void latency(const common::LatencyHistogram* sendToAck,
+                             const common::LatencyHistogram* ackToDone) override{
+                    out_.beginObject().member("event", "latency").member("unit", "us");
+                    if(sendToAck && ackToDone){
+                        out_.key("sendToAck");
+                        writeHistogram(out_, *sendToAck);
+                        out_.key("ackToDone");
+                        writeHistogram(out_, *ackToDone);
+                    }
+                    out_.endObject();
+                    out_.endLine();
+                }
+
+                void latencyReset() override{ simple("latencyReset"); }
+
+                void loaded(std::string_view path, int line, bool parsed) override{
+                    out_.beginObject().member("event", "loaded").member("path", path)
+                        .member("line", line).member("parsed", parsed).endObject();
+                    out_.endLine();
+                }
+
+                void delta(const StateDelta& delta) override{
+                    out_.beginObject().member("event", "delta").member("version", delta.version)
+                        .member("base", delta.base).member("full", delta.full).key("data").beginArray();
+                    for(const auto* entry : delta.variables){
+                        out_.beginObject().member("name", entry->first).key("value");
+                        writeValueText(out_, entry->second);
+                        out_.endObject();
+                    }
+                    out_.endArray();
+                    if(delta.hasIO){
+                        out_.key("io").beginObject()
+                            .member("inputs", delta.io.inputs).member("outputs", delta.io.outputs);
+                        if(delta.io.hasReady) out_.member("ready", delta.io.ready);
+                        out_.member("changedInputs", delta.inputsChanged)
+                            .member("changedOutputs", delta.outputsChanged).endObject();
+                    }
+                    out_.endObject();
+                    out_.endLine();
+                }
+
+                void flush() override{ out_.flush(); }
+
+            protected:
+                size_t decodeRequest(const char* data, size_t len, bool atEof, DebugRequest& request) override{
+                    const char* nl = static_cast<const char*>(std::memchr(data, '\n', len));
+                    if(!nl && !(atEof && len > 0)) return 0;
+                    size_t used = nl ? static_cast<size_t>(nl - data) + 1 : len;
+                    std::string_view line(data, nl ? static_cast<size_t>(nl - data) : len);
+                    if(!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+                    request.clear();
+                    if(line.find_first_not_of(" \t") == std::string_view::npos) return used;
+                    if(!reader_.parse(line)){
+                        request.type = DebugRequest::Type::MALFORMED;
+                        return used;
+                    }
+                    std::string_view cmd = reader_.getString("cmd");
+                    for(const NamedRequest& r : kRequests){
+                        if(cmd == r.name){ request.type = r.type; break; }
+                    }
+                    long long line_no = 0;
+                    if(reader_.getInt("line", line_no)) request.line = static_cast<int>(line_no);
+                    else if(request.type == DebugRequest::Type::SET_BREAKPOINT ||
+                            request.type == DebugRequest::Type::REMOVE_BREAKPOINT){
+                        request.type = DebugRequest::Type::MALFORMED;
+                    }
+                    long long since = 0;
+                    if(reader_.getInt("since", since) && since > 0) request.since = static_cast<uint64_t>(since);
+                    // {"cmd":"load","path":"/abs/prog.grs"} or {"cmd":"load","source":"DEF ..."}
+                    if(request.type == DebugRequest::Type::LOAD || request.type == DebugRequest::Type::RELOAD){
+                        bool ok = true;
+                        if(reader_.has("source")){
+                            request.isSource = true;
+                            ok = reader_.getString("source", request.text);
+                        } else if(reader_.has("path")){
+                            ok = reader_.getString("path", request.text);
+                        } else if(request.type == DebugRequest::Type::LOAD){
+                            ok = false;
+                        }
+                        reader_.getBool("live", request.live);
+                        if(!ok) request.type = DebugRequest::Type::MALFORMED;
+                    }
+                    return used;
+                }
+
+            private:
+                common::JsonWriter out_;
+                common::JsonReader reader_;
+
+                void simple(const char* event){
+                    out_.beginObject().member("event", event).endObject();
+                    out_.endLine();
+                }
+        };
+
+    }
+
+    std::unique_ptr<DebugProtocol> makeJsonProtocol(int inFd, int outFd){
+        return std::make_unique<JsonProtocol>(inFd, outFd);
+    }
+
+}
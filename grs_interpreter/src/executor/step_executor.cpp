@@ -2,9 +2,257 @@
 #include "ast/ast.hpp"
 #include "common/utils.hpp"
 #include "io/io_provider.hpp"
+#include <algorithm>
+#include <cstdio>
 #include <memory>
 namespace grs_executor {
 
+namespace {
+
+// Statement identity for reload(): everything that affects what it does, not where it is
+void appendKey(std::string& key, const std::shared_ptr<grs_ast::ASTNode>& node);
+
+void appendText(std::string& key, const std::string& text){
+    key += std::to_string(text.size());
+    key += ':';
+    key += text;
+}
+
+void appendValue(std::string& key, const common::ValueType& value){
+    key += static_cast<char>('0' + value.index());
+    if (auto* d = std::get_if<double>(&value)) {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%.17g", *d);
+        appendText(key, buf);
+    } else {
+        appendText(key, common::valueToString(value));
+    }
+}
+
+void appendArgs(std::string& key, const std::vector<std::pair<std::string, std::shared_ptr<grs_ast::Expression>>>& args){
+    key += std::to_string(args.size());
+    for (const auto& [name, expr] : args) {
+        appendText(key, name);
+        appendKey(key, expr);
+    }
+}
+
+void appendKey(std::string& key, const std::shared_ptr<grs_ast::ASTNode>& node){
+    if (!node) {
+        key += '-';
+        return;
+    }
+    key += '(';
+    key += std::to_string(static_cast<int>(node->getType()));
+    switch (node->getType()) {
+        case grs_ast::ASTNodeType::Program:
+            for (const auto& stmt : std::static_pointer_cast<grs_ast::FunctionBlock>(node)->getStatements()) {
+                appendKey(key, stmt);
+            }
+            break;
+        case grs_ast::ASTNodeType::FunctionDeclaration:
+            appendText(key, std::static_pointer_cast<grs_ast::FunctionDeclaration>(node)->getName());
+            break;
+        case grs_ast::ASTNodeType::VariableDeclaration: {
+            auto decl = std::static_pointer_cast<grs_ast::VariableDeclaration>(node);
+            key += std::to_string(static_cast<int>(decl->getDataType()));
+            appendText(key, decl->getName());
+            appendKey(key, decl->getInitializer());
+            break;
+        }
+        case grs_ast::ASTNodeType::FrameDeclaration: {
+            auto decl = std::static_pointer_cast<grs_ast::FrameDeclaration>(node);
+            appendText(key, decl->getName());
+            appendArgs(key, decl->getArgs());
+            break;
+        }
+        case grs_ast::ASTNodeType::PositionDeclaration: {
+            auto decl = std::static_pointer_cast<grs_ast::PositionDeclaration>(node);
+            appendText(key, decl->getName());
+            appendArgs(key, decl->getArgs());
+            break;
+        }
+        case grs_ast::ASTNodeType::AxisDeclaration: {
+            auto decl = std::static_pointer_cast<grs_ast::AxisDeclaration>(node);
+            appendText(key, decl->getName());
+            appendArgs(key, decl->getArgs());
+            break;
+        }
+        case grs_ast::ASTNodeType::ExecutePosAndAxisExpression: {
+            auto expr = std::static_pointer_cast<grs_ast::ExecutePosAndAxisExpression>(node);
+            appendText(key, expr->getName());
+            appendText(key, expr->getArg());
+            appendKey(key, expr->getExpr());
+            break;
+        }
+        case grs_ast::ASTNodeType::Command: {
+            auto cmd = std::static_pointer_cast<grs_ast::MotionCommand>(node);
+            appendText(key, cmd->getCommand());
+            appendText(key, cmd->getName());
+            break;
+        }
+        case grs_ast::ASTNodeType::IfStatement: {
+            auto stmt = std::static_pointer_cast<grs_ast::IfStatement>(node);
+            appendKey(key, stmt->getCondition());
+            appendKey(key, stmt->getThenBranch());
+            appendKey(key, stmt->getElseBranch());
+            break;
+        }
+        case grs_ast::ASTNodeType::WaitStatement:
+            appendValue(key, std::static_pointer_cast<grs_ast::WaitStatement>(node)->waitTime_);
+            break;
+        case grs_ast::ASTNodeType::OutputStatement: {
+            auto stmt = std::static_pointer_cast<grs_ast::OutputStatement>(node);
+            key += std::to_string(stmt->getIndex());
+            appendKey(key, stmt->getValue());
+            break;
+        }
+        case grs_ast::ASTNodeType::BinaryExpression: {
+            auto expr = std::static_pointer_cast<grs_ast::BinaryExpression>(node);
+            key += std::to_string(static_cast<int>(expr->getOperator()));
+            appendKey(key, expr->getLeft());
+            appendKey(key, expr->getRight());
+            break;
+        }
+        case grs_ast::ASTNodeType::UnaryExpression: {
+            auto expr = std::static_pointer_cast<grs_ast::UnaryExpression>(node);
+            key += std::to_string(static_cast<int>(expr->getOperator()));
+            appendKey(key, expr->getExpression());
+            break;
+        }
+        case grs_ast::ASTNodeType::LiteralExpression:
+            appendValue(key, std::static_pointer_cast<grs_ast::LiteraExpression>(node)->getValue());
+            break;
+        case grs_ast::ASTNodeType::VariableExpression:
+            appendText(key, std::static_pointer_cast<grs_ast::VariableExpression>(node)->getName());
+            break;
+        case grs_ast::ASTNodeType::InputExpression:
+            key += std::to_string(std::static_pointer_cast<grs_ast::InputExpression>(node)->getIndex());
+            break;
+        default:
+            break;
+    }
+    key += ')';
+}
+
+std::vector<std::string> statementKeys(const std::vector<std::shared_ptr<grs_ast::ASTNode>>& statements){
+    std::vector<std::string> keys(statements.size());
+    for (size_t i = 0; i < statements.size(); i++) {
+        appendKey(keys[i], statements[i]);
+    }
+    return keys;
+}
+
+// Longest common subsequence of the two statement lists: for every old statement the
+// index of the same statement in the new list, or -1 if it was edited or removed.
+// Edits are local, so the common head and tail are matched first and only the part
+// between them goes through the quadratic table.
+constexpr size_t kMaxMatchCells = size_t(1) << 24;
+
+std::vector<long> matchStatements(const std::vector<std::string>& from, const std::vector<std::string>& to){
+    std::vector<long> match(from.size(), -1);
+    size_t head = 0;
+    while (head < from.size() && head < to.size() && from[head] == to[head]) {
+        match[head] = static_cast<long>(head);
+        head++;
+    }
+    size_t tail = 0;
+    while (tail < from.size() - head && tail < to.size() - head &&
+           from[from.size() - 1 - tail] == to[to.size() - 1 - tail]) {
+        match[from.size() - 1 - tail] = static_cast<long>(to.size() - 1 - tail);
+        tail++;
+    }
+
+    size_t n = from.size() - head - tail;
+    size_t m = to.size() - head - tail;
+    if (n == 0 || m == 0 || (n + 1) * (m + 1) > kMaxMatchCells) return match;
+
+    // lcs[i][j]: common length of from[head+i..] and to[head+j..]
+    std::vector<uint32_t> lcs((n + 1) * (m + 1), 0);
+    auto at = [&lcs, m](size_t i, size_t j) -> uint32_t& { return lcs[i * (m + 1) + j]; };
+    for (size_t i = n; i-- > 0;) {
+        for (size_t j = m; j-- > 0;) {
+            at(i, j) = from[head + i] == to[head + j] ? at(i + 1, j + 1) + 1
+                                                      : std::max(at(i + 1, j), at(i, j + 1));
+        }
+    }
+    for (size_t i = 0, j = 0; i < n && j < m;) {
+        if (from[head + i] == to[head + j]) {
+            match[head + i] = static_cast<long>(head + j);
+            i++;
+            j++;
+        } else if (at(i + 1, j) >= at(i, j + 1)) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+    return match;
+}
+
+using DeclarationArgs = std::vector<std::pair<std::string, std::shared_ptr<grs_ast::Expression>>>;
+
+// Name and fields of a POS/FRAME/AXIS declaration, false for any other statement
+bool positionDeclaration(const std::shared_ptr<grs_ast::ASTNode>& node, std::string& name, DeclarationArgs& args){
+    switch (node->getType()) {
+        case grs_ast::ASTNodeType::PositionDeclaration: {
+            auto decl = std::static_pointer_cast<grs_ast::PositionDeclaration>(node);
+            name = decl->getName();
+            args = decl->getArgs();
+            return true;
+        }
+        case grs_ast::ASTNodeType::FrameDeclaration: {
+            auto decl = std::static_pointer_cast<grs_ast::FrameDeclaration>(node);
+            name = decl->getName();
+            args = decl->getArgs();
+            return true;
+        }
+        case grs_ast::ASTNodeType::AxisDeclaration: {
+            auto decl = std::static_pointer_cast<grs_ast::AxisDeclaration>(node);
+            name = decl->getName();
+            args = decl->getArgs();
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+const char* kOrderedKeys[] = {
+    "x","y","z","a","b","c",
+    "a1","a2","a3","a4","a5","a6",
+    "A1","A2","A3","A4","A5","A6"
+};
+constexpr size_t kOrderedKeyCount = sizeof(kOrderedKeys) / sizeof(kOrderedKeys[0]);
+
+size_t paramRank(const std::string& key){
+    for (size_t i = 0; i < kOrderedKeyCount; i++) {
+        if (key == kOrderedKeys[i]) return i;
+    }
+    return kOrderedKeyCount;
+}
+
+}
+
+void orderParams(const RobotCommand& cmd, std::vector<const std::pair<std::string,common::ValueType>*>& out){
+    out.clear();
+    for (const auto& param : cmd.params) out.push_back(&param);
+    // A handful of params: insertion sort by rank, unknown keys by name
+    auto before = [](const std::pair<std::string,common::ValueType>* a, size_t rankA,
+                     const std::pair<std::string,common::ValueType>* b){
+        size_t rankB = paramRank(b->first);
+        if (rankA != rankB) return rankA < rankB;
+        return rankA == kOrderedKeyCount && a->first < b->first;
+    };
+    for (size_t i = 1; i < out.size(); i++) {
+        auto* param = out[i];
+        size_t rank = paramRank(param->first);
+        size_t j = i;
+        for (; j > 0 && before(param, rank, out[j - 1]); j--) out[j] = out[j - 1];
+        out[j] = param;
+    }
+}
+
 
 //Constructor - Destructor
     StepExecutor::StepExecutor(std::shared_ptr<grs_io::IOProvider> ioProvider) :
@@ -24,7 +272,7 @@ StepExecutor::~StepExecutor() = default;
         program_ = program;
         statements_.clear();
         pc_=0;
-        variables_.clear();
+        clearVariables();
         variableTypes_.clear();
         positionStore_.clear();
         errorMessage_.clear();
@@ -59,6 +307,90 @@ void StepExecutor::flattenStatements(const std::shared_ptr<grs_ast::FunctionBloc
     }
 }
 
+void StepExecutor::reload(const std::shared_ptr<grs_ast::FunctionBlock>& program){
+    std::vector<std::shared_ptr<grs_ast::ASTNode>> previous = std::move(statements_);
+    statements_.clear();
+    program_ = program;
+    flattenStatements(program);
+
+    std::vector<long> match = matchStatements(statementKeys(previous), statementKeys(statements_));
+    std::vector<bool> unchanged(statements_.size(), false);
+    for (long j : match) {
+        if (j >= 0) unchanged[j] = true;
+    }
+
+    // Nothing ran yet: start at the top of the new program
+    size_t next = 0;
+    if (pc_ > 0) {
+        if (pc_ < previous.size() && match[pc_] >= 0) {
+            next = static_cast<size_t>(match[pc_]);
+        } else {
+            for (size_t i = std::min(pc_, previous.size()); i-- > 0;) {
+                if (match[i] >= 0) {
+                    next = static_cast<size_t>(match[i]) + 1;
+                    break;
+                }
+            }
+        }
+    }
+    pc_ = next;
+    // A statement that failed can be fixed and retried
+    if (status_ == ExecutionStatus::ERROR) {
+        errorMessage_.clear();
+        status_ = ExecutionStatus::PAUSED;
+    }
+
+    // Declarations edited or added above the resume point; the rest runs when reached.
+    // Of an edited POS/FRAME/AXIS only the changed fields are set again, so values the
+    // program assigned to the others since (P1->a := ..) are kept.
+    std::string name, oldName;
+    DeclarationArgs args, oldArgs;
+    for (size_t j = 0; j < pc_; j++) {
+        const auto& stmt = statements_[j];
+        bool isPosition = positionDeclaration(stmt, name, args);
+        if (unchanged[j] || (!isPosition && stmt->getType() != grs_ast::ASTNodeType::VariableDeclaration)) continue;
+        if (!stmt->getLineColumn().empty()) {
+            currentLine_ = stmt->getLineColumn().front().first;
+        }
+        try {
+            if (!isPosition) {
+                stmt->accept(*this);
+            } else {
+                // The declaration it replaces: an edited one of the same kind and name
+                oldArgs.clear();
+                for (size_t i = 0; i < previous.size(); i++) {
+                    if (match[i] < 0 && previous[i]->getType() == stmt->getType() &&
+                        positionDeclaration(previous[i], oldName, oldArgs) && oldName == name) break;
+                    oldArgs.clear();
+                }
+                for (const auto& [field, expr] : args) {
+                    std::string key;
+                    appendKey(key, expr);
+                    bool same = false;
+                    for (const auto& [oldField, oldExpr] : oldArgs) {
+                        if (oldField != field) continue;
+                        std::string oldKey;
+                        appendKey(oldKey, oldExpr);
+                        same = key == oldKey;
+                        break;
+                    }
+                    if (!same) setPositionField(name, field, evaluateExpression(expr));
+                }
+            }
+        } catch (const std::exception& e) {
+            errorMessage_ = e.what();
+            setStatus(ExecutionStatus::ERROR);
+        }
+        if (status_ == ExecutionStatus::ERROR) return;
+    }
+
+    if (pc_ < statements_.size() && !statements_[pc_]->getLineColumn().empty()) {
+        currentLine_ = statements_[pc_]->getLineColumn().front().first;
+    }
+    if (status_ == ExecutionStatus::IDLE || waitingForAck_) return;
+    setStatus(pc_ < statements_.size() ? ExecutionStatus::PAUSED : ExecutionStatus::COMPLETED);
+}
+
 bool StepExecutor::step(){
     
     if(status_ == ExecutionStatus::COMPLETED || status_ == ExecutionStatus::ERROR){
@@ -73,7 +405,9 @@ bool StepExecutor::step(){
         setStatus(ExecutionStatus::COMPLETED);
         return false;
     }
-    setStatus(ExecutionStatus::RUNNING);
+    if(status_ != ExecutionStatus::RUNNING){
+        setStatus(ExecutionStatus::RUNNING);
+    }
     
     auto& stmt = statements_[pc_];
     
@@ -81,6 +415,8 @@ bool StepExecutor::step(){
     if(!stmt->getLineColumn().empty()){
         currentLine_ = stmt->getLineColumn().front().first;
     }
+    for (ExecutionListener* listener : listeners_) listener->statementStarted(pc_, currentLine_);
+    blockDepth_ = 0;
     try{
         stmt->accept(*this);
     }catch(const std::exception& e){
@@ -108,12 +444,15 @@ bool StepExecutor::step(){
         currentLine_ = statements_[pc_]->getLineColumn().front().first;
     }
 
-    setStatus(ExecutionStatus::PAUSED);
+    if(!inRun_){
+        setStatus(ExecutionStatus::PAUSED);
+    }
     return true;
 }
 
 void StepExecutor::run(){
     
+    inRun_ = true;
     while(step()){
         if(status_ == ExecutionStatus::WAITING_ACK){
             break; //wait ack
@@ -131,6 +470,7 @@ void StepExecutor::run(){
             }
         }
     }
+    inRun_ = false;
 }
 
 void StepExecutor::pause(){
@@ -144,7 +484,7 @@ void StepExecutor::stop(){
 
 void StepExecutor::reset(){
     pc_ = 0;
-    variables_.clear();
+    clearVariables();
     variableTypes_.clear();
     positionStore_.clear();
     errorMessage_.clear();
@@ -153,7 +493,63 @@ void StepExecutor::reset(){
     setStatus(ExecutionStatus::IDLE);
 }
 
+void StepExecutor::setVariable(const std::string& name, common::ValueType value){
+    common::ValueType& slot = variables_[name];
+    slot = std::move(value);
+    variableVersions_[name] = ++variablesVersion_;
+    for (ExecutionListener* listener : listeners_) listener->variableWritten(name, slot);
+}
+
+void StepExecutor::setPositionField(const std::string& name, const std::string& field, common::ValueType value){
+    common::ValueType& slot = positionStore_[name][field];
+    slot = std::move(value);
+    // "->" cannot occur in a variable name, so the key never shadows one
+    std::string key = name + "->" + field;
+    positionFields_[key] = slot;
+    variableVersions_[std::move(key)] = ++variablesVersion_;
+    for (ExecutionListener* listener : listeners_) listener->positionWritten(name, field, slot);
+}
+
+void StepExecutor::emitCommand(const RobotCommand& cmd){
+    for (ExecutionListener* listener : listeners_) listener->commandEmitted(cmd);
+    if (commandCallback_) {
+        waitingForAck_ = true;
+        commandCallback_(cmd);
+    }
+}
+
+void StepExecutor::addListener(ExecutionListener* listener){
+    if (std::find(listeners_.begin(), listeners_.end(), listener) == listeners_.end()) {
+        listeners_.push_back(listener);
+    }
+}
+
+void StepExecutor::removeListener(ExecutionListener* listener){
+    listeners_.erase(std::remove(listeners_.begin(), listeners_.end(), listener), listeners_.end());
+}
+
+void StepExecutor::clearVariables(){
+    variables_.clear();
+    positionFields_.clear();
+    variableVersions_.clear();
+    // The version keeps counting, so a client's version never matches the new program by accident
+    variablesResetVersion_ = ++variablesVersion_;
+}
+
+void StepExecutor::collectChangedVariables(uint64_t since, std::vector<const VariableEntry*>& out) const{
+    out.clear();
+    for(const auto& [name, version] : variableVersions_){
+        if(version <= since) continue;
+        auto it = variables_.find(name);
+        if(it != variables_.end()) out.push_back(&*it);
+        else if((it = positionFields_.find(name)) != positionFields_.end()) out.push_back(&*it);
+    }
+}
+
 void StepExecutor::acknowledgeCommand(){
+    if (waitingForAck_) {
+        for (ExecutionListener* listener : listeners_) listener->commandAcknowledged();
+    }
     waitingForAck_= false;
     if(status_ ==  ExecutionStatus::WAITING_ACK){
         setStatus(ExecutionStatus::PAUSED);
@@ -183,6 +579,10 @@ bool StepExecutor::isBreakPoint(int line)const{
 
 void StepExecutor::setStatus(ExecutionStatus status){
     status_ = status;
+    static const std::string noError;
+    for (ExecutionListener* listener : listeners_) {
+        listener->statusChanged(status, currentLine_, status == ExecutionStatus::ERROR ? errorMessage_ : noError);
+    }
     if(statusCallback_){
         statusCallback_(status,currentLine_);
     }
@@ -202,16 +602,20 @@ common::ValueType StepExecutor::evaluateExpression(const std::shared_ptr<grs_ast
 void StepExecutor::visit(grs_ast::FunctionBlock& node){
 
 
+blockDepth_++;
 for(const auto& stmt : node.getStatements()){
     if(!stmt->getLineColumn().empty()){
         currentLine_ = stmt->getLineColumn().front().first;
     }
+    for (ExecutionListener* listener : listeners_) listener->blockStatementStarted(currentLine_, blockDepth_);
     stmt->accept(*this);
 
     if(status_ == ExecutionStatus::ERROR || status_ == ExecutionStatus::COMPLETED){
+        blockDepth_--;
         return;
     }
  }
+blockDepth_--;
 
 }
 
@@ -222,15 +626,15 @@ void StepExecutor::visit(grs_ast::VariableDeclaration& node) {
 
     if (node.getInitializer()) {
         auto value = evaluateExpression(node.getInitializer());
-        variables_[node.getName()] = value;
+        setVariable(node.getName(), value);
     } else {
         // Default değerler
         switch (node.getDataType()) {
-            case grs_lexer::TokenType::INT:   variables_[node.getName()] = 0; break;
-            case grs_lexer::TokenType::REAL:  variables_[node.getName()] = 0.0; break;
-            case grs_lexer::TokenType::BOOL:  variables_[node.getName()] = false; break;
-            case grs_lexer::TokenType::CHAR:  variables_[node.getName()] = std::string(""); break;
-            default: variables_[node.getName()] = 0; break;
+            case grs_lexer::TokenType::INT:   setVariable(node.getName(), 0); break;
+            case grs_lexer::TokenType::REAL:  setVariable(node.getName(), 0.0); break;
+            case grs_lexer::TokenType::BOOL:  setVariable(node.getName(), false); break;
+            case grs_lexer::TokenType::CHAR:  setVariable(node.getName(), std::string("")); break;
+            default: setVariable(node.getName(), 0); break;
         }
     }
 }
@@ -250,10 +654,7 @@ void StepExecutor::visit(grs_ast::MotionCommand& node) {
         }
     }
 
-    if (commandCallback_) {
-        waitingForAck_ = true;
-        commandCallback_(cmd);
-    }
+    emitCommand(cmd);
 }
 
 // ─── Visitor: OutputStatement ───
@@ -281,10 +682,7 @@ void StepExecutor::visit(grs_ast::OutputStatement& node) {
     cmd.ioValue = boolValue;
     cmd.sourceLine = currentLine_;
 
-    if (commandCallback_) {
-        waitingForAck_ = true;
-        commandCallback_(cmd);
-    }
+    emitCommand(cmd);
 }
 
 // ─── Visitor: InputExpression ───
@@ -293,7 +691,9 @@ void StepExecutor::visit(grs_ast::InputExpression& node) {
     if (ioProvider_) {
         // KRL $IN is 1-based, hardware is 0-based
         uint8_t hwIndex = (node.getIndex() > 0) ? node.getIndex() - 1 : 0;
-        lastValue_ = ioProvider_->readDigitalInput(hwIndex);
+        bool value = ioProvider_->readDigitalInput(hwIndex);
+        for (ExecutionListener* listener : listeners_) listener->inputRead(hwIndex, value);
+        lastValue_ = value;
     } else {
         lastValue_ = false;
     }
@@ -313,6 +713,7 @@ void StepExecutor::visit(grs_ast::IfStatement& node) {
     } else if (auto* d = std::get_if<double>(&condValue)) {
         condResult = (*d != 0.0);
     }
+    for (ExecutionListener* listener : listeners_) listener->branchEvaluated(currentLine_, condResult);
 
     if (condResult && node.getThenBranch()) {
         // Then branch'i çalıştır — block'taki her statement step edilebilir
@@ -330,10 +731,7 @@ void StepExecutor::visit(grs_ast::WaitStatement& node) {
     cmd.waitTime = node.waitTime_;
     cmd.sourceLine = currentLine_;
 
-    if (commandCallback_) {
-        waitingForAck_ = true;
-        commandCallback_(cmd);
-    }
+    emitCommand(cmd);
 }
 
 // ─── Visitor: BinaryExpression ───
@@ -345,7 +743,7 @@ void StepExecutor::visit(grs_ast::BinaryExpression& node) {
         
         if (node.getLeft()->getType() == grs_ast::ASTNodeType::VariableExpression) {
             auto varExpr = std::static_pointer_cast<grs_ast::VariableExpression>(node.getLeft());
-            variables_[varExpr->getName()] = value;
+            setVariable(varExpr->getName(), value);
         }
         lastValue_ = value;
         return;
@@ -447,29 +845,29 @@ void StepExecutor::visit(grs_ast::VariableExpression& node) {
 // ─── Visitor: Position/Frame/Axis Declarations ───
 
 void StepExecutor::visit(grs_ast::FrameDeclaration& node) {
-    auto& store = positionStore_[node.getName()];
+    positionStore_[node.getName()];
     for (const auto& [name, expr] : node.getArgs()) {
-        store[name] = evaluateExpression(expr);
+        setPositionField(node.getName(), name, evaluateExpression(expr));
     }
 }
 
 void StepExecutor::visit(grs_ast::PositionDeclaration& node) {
-    auto& store = positionStore_[node.getName()];
+    positionStore_[node.getName()];
     for (const auto& [name, expr] : node.getArgs()) {
-        store[name] = evaluateExpression(expr);
+        setPositionField(node.getName(), name, evaluateExpression(expr));
     }
 }
 
 void StepExecutor::visit(grs_ast::AxisDeclaration& node) {
-    auto& store = positionStore_[node.getName()];
+    positionStore_[node.getName()];
     for (const auto& [name, expr] : node.getArgs()) {
-        store[name] = evaluateExpression(expr);
+        setPositionField(node.getName(), name, evaluateExpression(expr));
     }
 }
 
 void StepExecutor::visit(grs_ast::ExecutePosAndAxisExpression& node) {
     auto val = evaluateExpression(node.getExpr());
-    positionStore_[node.getName()][node.getArg()] = val;
+    setPositionField(node.getName(), node.getArg(), val);
 }
 
 // ─── Visitor: FunctionDeclaration (placeholder) ───
@@ -1,15 +1,18 @@
 #include "io/tcp_io_provider.hpp"
+#include "wire_codec.hpp"
 #include <iostream>
 #include <cstring>
 #include <netinet/tcp.h>
 #include <fcntl.h>
 #include <poll.h>
 #include <cerrno>
+#include <algorithm>
+#include <random>
 
 namespace grs_io {
 
-TcpIOProvider::TcpIOProvider(const std::string& host, int port)
-    : host_(host), port_(port) {
+TcpIOProvider::TcpIOProvider(const std::string& host, int port, Transport transport)
+    : host_(host), port_(port), transport_(transport) {
     std::memset(&state_, 0, sizeof(state_));
 }
 
@@ -17,11 +20,11 @@ TcpIOProvider::~TcpIOProvider() {
     disconnect();
 }
 
-bool TcpIOProvider::connect() {
-    socket_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
-    if (socket_fd_ < 0) {
+int TcpIOProvider::openSocket(int type, bool quiet) {
+    int fd = ::socket(AF_INET, type, 0);
+    if (fd < 0) {
         std::cerr << "[TCP] Socket creation failed" << std::endl;
-        return false;
+        return -1;
     }
 
     sockaddr_in addr{};
@@ -29,86 +32,668 @@ bool TcpIOProvider::connect() {
     addr.sin_port = htons(port_);
     if (inet_pton(AF_INET, host_.c_str(), &addr.sin_addr) <= 0) {
         std::cerr << "[TCP] Invalid address: " << host_ << std::endl;
-        ::close(socket_fd_);
-        socket_fd_ = -1;
-        return false;
+        ::close(fd);
+        return -1;
     }
 
     // Non-blocking connect with 2-second timeout
-    int flags = fcntl(socket_fd_, F_GETFL, 0);
-    fcntl(socket_fd_, F_SETFL, flags | O_NONBLOCK);
+    // (for UDP this only fixes the peer address and returns immediately)
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
 
-    int ret = ::connect(socket_fd_, (sockaddr*)&addr, sizeof(addr));
+    int ret = ::connect(fd, (sockaddr*)&addr, sizeof(addr));
     if (ret < 0 && errno != EINPROGRESS) {
-        std::cerr << "[TCP] Connection failed to " << host_ << ":" << port_ << std::endl;
-        ::close(socket_fd_);
-        socket_fd_ = -1;
-        return false;
+        if (!quiet) {
+            std::cerr << "[TCP] Connection failed to " << host_ << ":" << port_ << std::endl;
+        }
+        ::close(fd);
+        return -1;
     }
 
     if (ret != 0) {
         struct pollfd pfd;
-        pfd.fd = socket_fd_;
+        pfd.fd = fd;
         pfd.events = POLLOUT;
         int pollRet = poll(&pfd, 1, 2000);
 
         if (pollRet <= 0) {
-            std::cerr << "[TCP] Connection timeout to " << host_ << ":" << port_ << std::endl;
-            ::close(socket_fd_);
-            socket_fd_ = -1;
-            return false;
+            if (!quiet) {
+                std::cerr << "[TCP] Connection timeout to " << host_ << ":" << port_ << std::endl;
+            }
+            ::close(fd);
+            return -1;
         }
 
         int sockErr = 0;
         socklen_t errLen = sizeof(sockErr);
-        getsockopt(socket_fd_, SOL_SOCKET, SO_ERROR, &sockErr, &errLen);
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &sockErr, &errLen);
         if (sockErr != 0) {
-            std::cerr << "[TCP] Connection refused by " << host_ << ":" << port_ << std::endl;
+            if (!quiet) {
+                std::cerr << "[TCP] Connection refused by " << host_ << ":" << port_ << std::endl;
+            }
+            ::close(fd);
+            return -1;
+        }
+    }
+
+    // Restore blocking mode
+    fcntl(fd, F_SETFL, flags);
+
+    // Commands are small and latency bound; batching is done explicitly instead of by Nagle
+    if (type == SOCK_STREAM && noDelay_) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+bool TcpIOProvider::connect() {
+    GrsRobotCommand hello{};
+    hello.cmd_type = GRS_CMD_NOP;
+    hello.flags = GRS_CMD_FLAG_HELLO;
+
+    if (transport_ == Transport::TCP) {
+        socket_fd_ = openSocket(SOCK_STREAM);
+        if (socket_fd_ < 0) return false;
+
+        // Fresh session: the bridge forgets cmd_ids seen from a previous client.
+        // Only a resume with this token gets the command lease back after a drop.
+        std::random_device rd;
+        do {
+            session_ = (static_cast<uint64_t>(rd()) << 32) ^ rd() ^
+                       static_cast<uint64_t>(Clock::now().time_since_epoch().count());
+        } while (session_ == 0);
+        GrsRobotState first;
+        int format = handshake(socket_fd_, GRS_CMD_FLAG_HELLO, &first);
+        if (format < 0) {
+            std::cerr << "[TCP] Handshake failed with " << host_ << ":" << port_ << std::endl;
             ::close(socket_fd_);
             socket_fd_ = -1;
             return false;
         }
+        wireFormat_ = static_cast<uint8_t>(format);
+        startSession(first);
+
+        connected_ = true;
+        running_ = true;
+        recvThread_ = std::thread(&TcpIOProvider::recvLoop, this);
+
+        std::cerr << "[TCP] Connected to " << host_ << ":" << port_
+                  << (wireFormat_ == grs_wire::WIRE_COMPACT ? " (compact wire format v1)"
+                                                            : " (unified 128-byte protocol)")
+                  << std::endl;
+        // The format reply is built after the bridge handled the hello, so its
+        // lease flag is current
+        if ((first.wire_format & grs_wire::WIRE_REPLY) && !(first.link_flags & GRS_LINK_LEASE)) {
+            std::cerr << "[TCP] Warning: another client holds the command lease on "
+                      << host_ << ":" << port_ << " — commands will not be executed" << std::endl;
+        }
+        return true;
     }
 
-    // Restore blocking mode
-    fcntl(socket_fd_, F_SETFL, flags);
+    socket_fd_ = openSocket(SOCK_DGRAM);
+    if (socket_fd_ < 0) return false;
+
+    // UDP has no handshake: announce the session and wait for the first state frame.
+    // Datagrams always use the fixed 128-byte format.
+    wireFormat_ = grs_wire::WIRE_FIXED;
+    sendFrame(hello);
+
+    struct pollfd pfd;
+    pfd.fd = socket_fd_;
+    pfd.events = POLLIN;
+    GrsRobotState first;
+    if (poll(&pfd, 1, 2000) <= 0 ||
+        ::recv(socket_fd_, &first, sizeof(first), 0) != static_cast<ssize_t>(sizeof(first))) {
+        std::cerr << "[UDP] No state from " << host_ << ":" << port_ << std::endl;
+        ::close(socket_fd_);
+        socket_fd_ = -1;
+        return false;
+    }
+    startSession(first);
 
+    // The bridge accepts commands strictly in cmd_id order; tell it where this
+    // session starts, so even a lost first command is waited for and resent
+    hello.cmd_id = cmdIdCounter_ - 1;
+    sendFrame(hello);
+
+    haveFrame_ = false;
     connected_ = true;
     running_ = true;
+    recvThread_ = std::thread(&TcpIOProvider::recvLoopUdp, this);
 
-    recvThread_ = std::thread(&TcpIOProvider::recvLoop, this);
-
-    std::cerr << "[TCP] Connected to " << host_ << ":" << port_
-              << " (unified 128-byte protocol)" << std::endl;
+    std::cerr << "[UDP] Connected to " << host_ << ":" << port_
+              << " (unified 128-byte protocol, datagram mode)" << std::endl;
     return true;
 }
 
 void TcpIOProvider::disconnect() {
     running_ = false;
+    {
+        // Unblock recv() in the receive thread
+        std::lock_guard<std::mutex> lock(sendMutex_);
+        if (socket_fd_ >= 0) ::shutdown(socket_fd_, SHUT_RDWR);
+    }
     if (recvThread_.joinable()) {
         recvThread_.join();
     }
+    std::lock_guard<std::mutex> lock(sendMutex_);
     if (socket_fd_ >= 0) {
         ::close(socket_fd_);
         socket_fd_ = -1;
     }
     connected_ = false;
+    { std::lock_guard<std::mutex> track(trackMutex_); }  // no lost wakeup
+    doneCv_.notify_all();
+    pending_.clear();
+    txBuf_.clear();
+    txFrameEnds_.clear();
+    batchDepth_ = 0;
+    corked_ = false;
+}
+
+void TcpIOProvider::setAutoReconnect(bool enable) {
+    autoReconnect_ = enable;
+}
+
+size_t TcpIOProvider::getPendingCount() const {
+    std::lock_guard<std::mutex> lock(sendMutex_);
+    return pending_.size();
+}
+
+void TcpIOProvider::setCommandEventCallback(CommandEventCallback cb) {
+    std::lock_guard<std::mutex> lock(trackMutex_);
+    eventCallback_ = std::move(cb);
+}
+
+uint64_t TcpIOProvider::getLastCommandId() const {
+    std::lock_guard<std::mutex> lock(trackMutex_);
+    return lastCmdId_;
+}
+
+uint64_t TcpIOProvider::getDoneCommandId() const {
+    std::lock_guard<std::mutex> lock(trackMutex_);
+    return doneId_;
+}
+
+uint64_t TcpIOProvider::getFailedCommandId() const {
+    std::lock_guard<std::mutex> lock(trackMutex_);
+    return failedId_;
+}
+
+bool TcpIOProvider::waitForDone(uint64_t cmdId, int timeoutMs) {
+    std::unique_lock<std::mutex> lock(trackMutex_);
+    doneCv_.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                     [&] { return doneId_ >= cmdId || !running_; });
+    return doneId_ >= cmdId;
+}
+
+common::LatencyHistogram TcpIOProvider::getSendToAckHistogram() const {
+    std::lock_guard<std::mutex> lock(trackMutex_);
+    return sendToAck_;
+}
+
+common::LatencyHistogram TcpIOProvider::getAckToDoneHistogram() const {
+    std::lock_guard<std::mutex> lock(trackMutex_);
+    return ackToDone_;
+}
+
+void TcpIOProvider::resetLatency() {
+    std::lock_guard<std::mutex> lock(trackMutex_);
+    sendToAck_.reset();
+    ackToDone_.reset();
+}
+
+bool TcpIOProvider::waitForAck(int timeoutMs) {
+    auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (running_ && Clock::now() < deadline) {
+        {
+            std::lock_guard<std::mutex> lock(sendMutex_);
+            if (pending_.empty()) return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    return getPendingCount() == 0;
+}
+
+void TcpIOProvider::beginBatch() {
+    std::lock_guard<std::mutex> lock(sendMutex_);
+    if (batchDepth_++ == 0) batchStart_ = Clock::now();
+}
+
+bool TcpIOProvider::endBatch() {
+    std::lock_guard<std::mutex> lock(sendMutex_);
+    if (batchDepth_ == 0 || --batchDepth_ > 0) return true;
+    bool ok = flushFrames();
+    if (corked_) setCork(false);
+    return ok;
+}
+
+bool TcpIOProvider::flush() {
+    std::lock_guard<std::mutex> lock(sendMutex_);
+    bool ok = flushFrames();
+    if (corked_) setCork(false);
+    return ok;
+}
+
+void TcpIOProvider::setRetransmit(bool enable, int timeoutMs) {
+    retransmit_ = enable;
+    retransmitTimeout_ = std::chrono::milliseconds(timeoutMs);
 }
 
 void TcpIOProvider::recvLoop() {
-    GrsRobotState incoming;
-    while (running_ && connected_) {
-        int n = ::recv(socket_fd_, &incoming, sizeof(incoming), MSG_WAITALL);
-        if (n <= 0) {
-            connected_ = false;
+    // Frames are reassembled from the byte stream; one recv() may carry several
+    uint8_t buf[4096];
+    size_t len = 0;
+    struct pollfd pfd;
+    pfd.events = POLLIN;
+    while (running_) {
+        // Wake up at the batch age limit even without traffic
+        pfd.fd = socket_fd_;
+        int ready = poll(&pfd, 1, static_cast<int>(kMaxBatchAge.count()));
+        flushAgedBatch();
+        if (ready == 0 || (ready < 0 && errno == EINTR)) continue;
+
+        ssize_t n = ::recv(socket_fd_, buf + len, sizeof(buf) - len, 0);
+        if (n > 0) {
+            len += n;
+            size_t off = 0;
+            size_t used;
+            GrsRobotState incoming;
+            while ((used = grs_wire::decodeState(buf + off, len - off, wireFormat_, incoming)) != 0 &&
+                   used != grs_wire::BAD_FRAME) {
+                off += used;
+                {
+                    std::lock_guard<std::mutex> lock(stateMutex_);
+                    state_ = incoming;
+                }
+                acknowledgePending(incoming.seq_id);
+                trackState(incoming);
+            }
+            std::memmove(buf, buf + off, len - off);
+            len -= off;
+            if (used != grs_wire::BAD_FRAME) continue;
+            std::cerr << "[TCP] Malformed state frame from " << host_ << ":" << port_ << std::endl;
+        } else if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // Interrupted or a receive timeout, the link itself is fine
+            continue;
+        }
+
+        // Link lost: peer closed (0), hard error, bad frame, or disconnect() shut it down
+        connected_ = false;
+        len = 0;
+        if (!running_ || !autoReconnect_ || !reconnect()) {
             running_ = false;
+            { std::lock_guard<std::mutex> track(trackMutex_); }  // no lost wakeup
+            doneCv_.notify_all();
+            break;
+        }
+    }
+}
+
+int TcpIOProvider::handshake(int fd, uint8_t flags, GrsRobotState* first) {
+    GrsRobotCommand nop{};
+    nop.cmd_type = GRS_CMD_NOP;
+    nop.flags = flags;
+    nop.session = session_;
+    if (requestedFormat_ != grs_wire::WIRE_FIXED) {
+        nop.flags |= GRS_CMD_FLAG_FORMAT;
+        nop.io_value = requestedFormat_;
+    }
+    // Always sent fixed: the format only changes once the bridge has replied
+    if (::send(fd, &nop, sizeof(nop), MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(nop))) {
+        return -1;
+    }
+
+    // A bridge without format support never replies, so only wait briefly for it.
+    // A resuming client additionally needs one state frame for the acknowledged id.
+    const auto replyWait = std::chrono::milliseconds(300);
+    const auto firstWait = std::chrono::milliseconds(2000);
+    const bool wantReply = requestedFormat_ != grs_wire::WIRE_FIXED;
+    auto start = Clock::now();
+    bool gotState = false;
+
+    timeval tv{2, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    int result = grs_wire::WIRE_FIXED;
+    for (;;) {
+        auto elapsed = Clock::now() - start;
+        bool waitReply = wantReply && elapsed < replyWait;
+        bool waitFirst = first && !gotState && elapsed < firstWait;
+        if (!waitReply && !waitFirst) break;
+
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            (waitReply ? replyWait : firstWait) - elapsed);
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, std::max<int>(1, static_cast<int>(left.count()))) <= 0) continue;
+
+        GrsRobotState st;
+        if (::recv(fd, &st, sizeof(st), MSG_WAITALL) != static_cast<ssize_t>(sizeof(st))) {
+            result = -1;
+            break;
+        }
+        gotState = true;
+        if (first) *first = st;
+        if (st.wire_format & grs_wire::WIRE_REPLY) {
+            result = st.wire_format & ~grs_wire::WIRE_REPLY;
             break;
         }
-        if (n == sizeof(incoming)) {
-            std::lock_guard<std::mutex> lock(stateMutex_);
-            state_ = incoming;
+    }
+
+    tv = timeval{0, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    if (first && !gotState) return -1;
+    return result;
+}
+
+bool TcpIOProvider::reconnect() {
+    {
+        std::lock_guard<std::mutex> lock(sendMutex_);
+        ::close(socket_fd_);
+        socket_fd_ = -1;
+    }
+    std::cerr << "[TCP] Link to " << host_ << ":" << port_
+              << " lost — reconnecting" << std::endl;
+
+    auto backoff = std::chrono::milliseconds(100);
+    const auto maxBackoff = std::chrono::milliseconds(5000);
+
+    while (running_) {
+        int fd = openSocket(SOCK_STREAM, true);
+        if (fd >= 0) {
+            // Resume point: the first state frame tells which cmd_id the bridge got last.
+            // No hello flag — the bridge must keep its duplicate detection. The session
+            // token moves the lease over from the dead connection.
+            GrsRobotState first;
+            int format = handshake(fd, 0, &first);
+
+            if (format >= 0) {
+                {
+                    std::lock_guard<std::mutex> lock(stateMutex_);
+                    state_ = first;
+                }
+                trackState(first);
+
+                std::lock_guard<std::mutex> lock(sendMutex_);
+                socket_fd_ = fd;
+                wireFormat_ = static_cast<uint8_t>(format);
+                // Anything still buffered from the dead link is in pending_ as well
+                txBuf_.clear();
+                txFrameEnds_.clear();
+                corked_ = false;
+                while (!pending_.empty() && pending_.front().cmd.cmd_id <= first.seq_id) {
+                    pending_.pop_front();
+                }
+                // Replay what never reached the bridge, oldest first. The resend flag
+                // lets the bridge drop anything it had already queued.
+                auto now = Clock::now();
+                batchDepth_++;
+                for (auto& p : pending_) {
+                    p.cmd.flags |= GRS_CMD_FLAG_RESEND;
+                    sendFrame(p.cmd);
+                    p.lastSent = now;
+                }
+                batchDepth_--;
+                if (batchDepth_ == 0) {
+                    flushFrames();
+                    if (corked_) setCork(false);
+                }
+                connected_ = true;
+                reconnects_++;
+
+                std::cerr << "[TCP] Reconnected to " << host_ << ":" << port_
+                          << " — resuming after cmd #" << first.seq_id
+                          << ", resent " << pending_.size() << " command(s)" << std::endl;
+                return true;
+            }
+            ::close(fd);
+        }
+
+        // Sleep in short slices so disconnect() is never held up by the backoff
+        auto until = Clock::now() + backoff;
+        while (running_ && Clock::now() < until) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
         }
+        backoff = std::min(backoff * 2, maxBackoff);
     }
+    return false;
+}
+
+void TcpIOProvider::recvLoopUdp() {
+    GrsRobotState incoming;
+    struct pollfd pfd;
+    pfd.fd = socket_fd_;
+    pfd.events = POLLIN;
+    auto lastKeepalive = Clock::now();
+
+    while (running_) {
+        // Wake up periodically even without traffic so retransmission keeps
+        // going and an open batch is flushed at its age limit
+        int ready = poll(&pfd, 1, static_cast<int>(std::min(retransmitTimeout_, kMaxBatchAge).count()));
+        if (ready < 0 && errno != EINTR) break;
+        flushAgedBatch();
+
+        if (ready > 0) {
+            // Drain everything queued in the socket; only the newest frame matters
+            for (;;) {
+                ssize_t n = ::recv(socket_fd_, &incoming, sizeof(incoming), MSG_DONTWAIT);
+                if (n < 0) break;
+                if (n != sizeof(incoming)) continue;
+
+                // Wrap-safe "newer than" test on the 32-bit frame counter
+                if (haveFrame_ &&
+                    static_cast<int32_t>(incoming.frame_seq - lastFrameSeq_) <= 0) {
+                    staleFrames_++;
+                    continue;
+                }
+                haveFrame_ = true;
+                lastFrameSeq_ = incoming.frame_seq;
+                {
+                    std::lock_guard<std::mutex> lock(stateMutex_);
+                    state_ = incoming;
+                }
+                acknowledgePending(incoming.seq_id);
+                trackState(incoming);
+            }
+        }
+
+        if (retransmit_) retransmitPending();
+
+        // Keepalive so the bridge does not time the session out while idle
+        auto now = Clock::now();
+        if (now - lastKeepalive > std::chrono::milliseconds(500)) {
+            GrsRobotCommand keepalive{};
+            keepalive.cmd_type = GRS_CMD_NOP;
+            std::lock_guard<std::mutex> lock(sendMutex_);
+            sendFrame(keepalive);
+            lastKeepalive = now;
+        }
+    }
+}
+
+// seq_id echoes the last cmd_id the bridge accepted; everything up to it is acknowledged
+void TcpIOProvider::acknowledgePending(uint64_t ackedId) {
+    std::lock_guard<std::mutex> lock(sendMutex_);
+    while (!pending_.empty() && pending_.front().cmd.cmd_id <= ackedId) {
+        pending_.pop_front();
+    }
+}
+
+// The bridge's RT loop keeps its command ids across client sessions, so a new
+// session continues above them; otherwise its first commands would count as done.
+void TcpIOProvider::startSession(const GrsRobotState& first) {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        state_ = first;
+    }
+    {
+        std::lock_guard<std::mutex> lock(sendMutex_);
+        cmdIdCounter_ = std::max(cmdIdCounter_, first.seq_id + 1);
+    }
+    std::lock_guard<std::mutex> lock(trackMutex_);
+    doneId_ = std::max(doneId_, first.done_cmd_id);
+}
+
+void TcpIOProvider::trackState(const GrsRobotState& st) {
+    std::vector<std::pair<uint64_t, CommandEvent>> events;
+    CommandEventCallback cb;
+    bool advanced = false;
+    {
+        std::lock_guard<std::mutex> lock(trackMutex_);
+        auto now = Clock::now();
+        auto toUs = [](Clock::duration d) {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+        };
+
+        for (auto& f : inflight_) {
+            if (f.id > st.seq_id) break;
+            if (f.isAcked) continue;
+            f.isAcked = true;
+            f.acked = now;
+            sendToAck_.record(toUs(now - f.sent));
+            if (eventCallback_) events.emplace_back(f.id, CommandEvent::ACKED);
+        }
+
+        if (st.done_cmd_id > doneId_) {
+            doneId_ = st.done_cmd_id;
+            advanced = true;
+        }
+        if (st.cmd_status == GRS_STATUS_ERROR && st.done_cmd_id > failedId_) {
+            failedId_ = st.done_cmd_id;
+            uint64_t count = std::max<uint64_t>(st.failed_count, 1);
+            failedFrom_ = count < failedId_ ? failedId_ - count + 1 : 1;
+        }
+        while (!inflight_.empty() && inflight_.front().id <= doneId_) {
+            InFlight& f = inflight_.front();
+            if (!f.isAcked) {
+                // Finished within the same state frame that acknowledged it
+                f.acked = now;
+                sendToAck_.record(toUs(now - f.sent));
+                if (eventCallback_) events.emplace_back(f.id, CommandEvent::ACKED);
+            }
+            ackToDone_.record(toUs(now - f.acked));
+            if (eventCallback_) {
+                bool failed = f.id >= failedFrom_ && f.id <= failedId_;
+                events.emplace_back(f.id, failed ? CommandEvent::FAILED : CommandEvent::DONE);
+            }
+            inflight_.pop_front();
+        }
+        if (!events.empty()) cb = eventCallback_;
+    }
+
+    if (advanced) doneCv_.notify_all();
+    for (const auto& [id, ev] : events) cb(id, ev);
+}
+
+void TcpIOProvider::retransmitPending() {
+    auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(sendMutex_);
+    // Everything due goes out in one sendmmsg(). The bridge accepts commands strictly
+    // in order, so resending beyond the oldest few would only flood the link.
+    batchDepth_++;
+    size_t window = 0;
+    for (auto& p : pending_) {
+        if (++window > kRetransmitWindow) break;
+        if (now - p.lastSent < retransmitTimeout_) continue;
+        p.cmd.flags |= GRS_CMD_FLAG_RESEND;
+        sendFrame(p.cmd);
+        p.lastSent = now;
+        retransmits_++;
+    }
+    if (--batchDepth_ == 0) flushFrames();
+}
+
+// Appends one encoded frame to txBuf_ and writes it out unless a batch is open.
+// Caller holds sendMutex_ (or owns the socket exclusively, as in connect()).
+bool TcpIOProvider::sendFrame(const GrsRobotCommand& cmd) {
+    if (txFrameEnds_.empty()) {
+        txBuf_.reserve(kMaxBatchBytes);
+        if (batchDepth_ > 0) batchStart_ = Clock::now();
+    }
+    size_t off = txBuf_.size();
+    txBuf_.resize(off + grs_wire::MAX_FRAME);
+    txBuf_.resize(off + grs_wire::encodeCommand(cmd, wireFormat_, txBuf_.data() + off));
+    txFrameEnds_.push_back(txBuf_.size());
+
+    if (batchDepth_ > 0) {
+        bool full = txBuf_.size() + grs_wire::MAX_FRAME > kMaxBatchBytes;
+        if (!full && Clock::now() - batchStart_ < kMaxBatchAge) return true;
+        // Still inside the batch: hold the tail segment back until endBatch()
+        if (full && !corked_) setCork(true);
+    }
+    return flushFrames();
+}
+
+// Deadline flush for a batch nothing more is appended to (a long motion
+// computation, or the program stalled on the lookahead)
+void TcpIOProvider::flushAgedBatch() {
+    std::lock_guard<std::mutex> lock(sendMutex_);
+    if (batchDepth_ == 0 || txFrameEnds_.empty()) return;
+    if (Clock::now() - batchStart_ < kMaxBatchAge) return;
+    flushFrames();
+    if (corked_) setCork(false);
+}
+
+bool TcpIOProvider::flushFrames() {
+    if (txFrameEnds_.empty()) return true;
+    bool ok = (transport_ == Transport::TCP) ? writeStream() : writeDatagrams();
+    txBuf_.clear();
+    txFrameEnds_.clear();
+    return ok;
+}
+
+// Frames are already contiguous, so one send() carries the whole batch
+bool TcpIOProvider::writeStream() {
+    size_t off = 0;
+    while (off < txBuf_.size()) {
+        ssize_t n = ::send(socket_fd_, txBuf_.data() + off, txBuf_.size() - off, MSG_NOSIGNAL);
+        sendCalls_++;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        off += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// One datagram per frame, submitted together. Whatever the socket cannot take
+// right now is dropped — unacknowledged commands are retransmitted anyway.
+bool TcpIOProvider::writeDatagrams() {
+    constexpr size_t kChunk = 64;
+    mmsghdr msgs[kChunk];
+    iovec iov[kChunk];
+
+    size_t count = txFrameEnds_.size();
+    size_t first = 0;
+    while (first < count) {
+        size_t n = std::min(kChunk, count - first);
+        for (size_t i = 0; i < n; i++) {
+            size_t begin = (first + i == 0) ? 0 : txFrameEnds_[first + i - 1];
+            iov[i].iov_base = txBuf_.data() + begin;
+            iov[i].iov_len = txFrameEnds_[first + i] - begin;
+            std::memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int sent = ::sendmmsg(socket_fd_, msgs, static_cast<unsigned>(n), MSG_DONTWAIT | MSG_NOSIGNAL);
+        sendCalls_++;
+        if (sent <= 0) return false;
+        first += static_cast<size_t>(sent);
+        if (static_cast<size_t>(sent) < n) return false;
+    }
+    return true;
+}
+
+void TcpIOProvider::setCork(bool enable) {
+    if (transport_ != Transport::TCP || socket_fd_ < 0) return;
+    int value = enable ? 1 : 0;
+    setsockopt(socket_fd_, IPPROTO_TCP, TCP_CORK, &value, sizeof(value));
+    corked_ = enable;
 }
 
 // ─── IOProvider interface ───
@@ -120,7 +705,7 @@ bool TcpIOProvider::readDigitalInput(uint8_t index) {
 }
 
 void TcpIOProvider::writeDigitalOutput(uint8_t index, bool value) {
-    if (index >= 8 || !connected_) return;
+    if (index >= 8 || !canSend()) return;
 
     double zeroCoords[6] = {};
     double zeroAxes[6] = {};
@@ -170,6 +755,11 @@ uint8_t TcpIOProvider::getCommandStatus() const {
     return state_.cmd_status;
 }
 
+bool TcpIOProvider::hasCommandLease() const {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    return (state_.link_flags & GRS_LINK_LEASE) != 0;
+}
+
 // ─── Send commands ───
 
 bool TcpIOProvider::sendRobotCommand(uint8_t cmdType,
@@ -177,10 +767,9 @@ bool TcpIOProvider::sendRobotCommand(uint8_t cmdType,
                                       const double axes[6],
                                       double waitTime,
                                       uint8_t ioIndex, uint8_t ioValue) {
-    if (!connected_ || socket_fd_ < 0) return false;
+    if (!canSend()) return false;
 
     GrsRobotCommand cmd{};
-    cmd.cmd_id = cmdIdCounter_++;
     cmd.cmd_type = cmdType;
     cmd.io_index = ioIndex;
     cmd.io_value = ioValue;
@@ -194,8 +783,29 @@ bool TcpIOProvider::sendRobotCommand(uint8_t cmdType,
     if (coords) std::memcpy(cmd.coords, coords, sizeof(double) * 6);
     if (axes)   std::memcpy(cmd.axes, axes, sizeof(double) * 6);
 
-    int n = ::send(socket_fd_, &cmd, sizeof(cmd), 0);
-    return n == sizeof(cmd);
+    std::lock_guard<std::mutex> lock(sendMutex_);
+    cmd.cmd_id = cmdIdCounter_++;
+
+    // send→ack includes any time the command spends in an open batch
+    {
+        std::lock_guard<std::mutex> track(trackMutex_);
+        if (inflight_.size() >= kMaxInFlight) inflight_.pop_front();
+        inflight_.push_back({cmd.cmd_id, Clock::now(), Clock::time_point{}, false});
+        lastCmdId_ = cmd.cmd_id;
+    }
+
+    // Keep every command until the bridge acknowledges it, so it can be resent
+    // after packet loss (UDP) or a reconnect (TCP), and waitForAck() sees it
+    if (pending_.size() >= kMaxPending) {
+        std::cerr << "[TCP] Resend buffer full — dropping cmd #"
+                  << pending_.front().cmd.cmd_id << std::endl;
+        pending_.pop_front();
+    }
+    pending_.push_back({cmd, Clock::now()});
+
+    // While reconnecting the command stays buffered and goes out on resume
+    if (!connected_) return true;
+    return sendFrame(cmd);
 }
 
 } // namespace grs_io
@@ -0,0 +1,196 @@
+#include "profile/profiler.hpp"
+#include "common/json.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace grs_profile{
+
+    namespace{
+
+        uint64_t nowNs(){
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        // A program without commands still gets a clock read this often
+        constexpr size_t maxSlice = 4096;
+
+        uint64_t toUs(uint64_t ns){ return (ns + 500) / 1000; }
+
+        // Frames are separated by ';' and the count by the last space
+        std::string frameName(const std::string& program){
+            std::string name = program.substr(program.find_last_of('/') + 1);
+            for(char& c : name) if(c == ';') c = '_';
+            return name.empty() ? "program" : name;
+        }
+
+    }
+
+    Profiler::Profiler() : stack_(16, 0){
+        slice_.reserve(maxSlice);
+    }
+
+    void Profiler::reset(){
+        lines_.clear();
+        std::fill(stack_.begin(), stack_.end(), 0);
+        slice_.clear();
+        activeLine_ = ackLine_ = 0;
+        waiting_ = false;
+        clockRunning_ = false;
+        runs_ = 0;
+    }
+
+    LineProfile& Profiler::line(int line){
+        size_t index = line > 0 ? static_cast<size_t>(line) : 0;
+        if(index >= lines_.size()) lines_.resize(index + 64);
+        return lines_[index];
+    }
+
+    void Profiler::charge(uint64_t now){
+        if(clockRunning_ && sliceStart_ != 0){
+            uint64_t elapsed = now - sliceStart_;
+            if(waiting_) line(ackLine_).waitAckNs += elapsed;
+            else if(!slice_.empty()){
+                uint64_t share = elapsed / slice_.size();
+                for(int l : slice_) line(l).selfNs += share;
+                line(slice_.back()).selfNs += elapsed - share * slice_.size();
+            }
+            else if(activeLine_ > 0) line(activeLine_).selfNs += elapsed;
+        }
+        sliceStart_ = now;
+        slice_.clear();
+    }
+
+    // No clock read here: the statement only joins the slice charged at the next event
+    void Profiler::enter(int lineNo, int parent){
+        activeLine_ = lineNo;
+        LineProfile& p = line(lineNo);
+        p.hits++;
+        // A branch statement can carry the IF's own line
+        if(parent != lineNo) p.parent = parent;
+        if(!clockRunning_) return;
+        slice_.push_back(lineNo);
+        if(slice_.size() == maxSlice) charge(nowNs());
+    }
+
+    void Profiler::statementStarted(size_t, int lineNo){
+        stack_[0] = lineNo;
+        enter(lineNo, 0);
+    }
+
+    void Profiler::blockStatementStarted(int lineNo, size_t depth){
+        if(depth >= stack_.size()) stack_.resize(depth + 8);
+        stack_[depth] = lineNo;
+        enter(lineNo, stack_[depth - 1]);
+    }
+
+    void Profiler::commandEmitted(const grs_executor::RobotCommand&){
+        if(waiting_) return;
+        charge(nowNs());
+        waiting_ = true;
+        ackLine_ = activeLine_;
+    }
+
+    void Profiler::commandAcknowledged(){
+        charge(nowNs());
+        waiting_ = false;
+    }
+
+    // run() stays RUNNING from statement to statement, so this is only reached
+    // when the executor starts, stops or waits, not once per statement
+    void Profiler::statusChanged(grs_executor::ExecutionStatus status, int, const std::string&){
+        if(status == grs_executor::ExecutionStatus::RUNNING){
+            if(!clockRunning_) sliceStart_ = nowNs();
+            clockRunning_ = true;
+            return;
+        }
+        charge(nowNs());
+        clockRunning_ = status == grs_executor::ExecutionStatus::WAITING_ACK;
+        // Nothing is outstanding once the executor paused or ended
+        if(!clockRunning_) waiting_ = false;
+        if(status == grs_executor::ExecutionStatus::COMPLETED || status == grs_executor::ExecutionStatus::ERROR){
+            runs_++;
+            activeLine_ = 0;
+        }
+    }
+
+    bool Profiler::writeJson(const std::string& path, const std::string& program, std::string& error) const{
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if(fd < 0){
+            error = "cannot create " + path + ": " + std::strerror(errno);
+            return false;
+        }
+
+        uint64_t selfNs = 0, waitNs = 0;
+        for(const auto& p : lines_){
+            selfNs += p.selfNs;
+            waitNs += p.waitAckNs;
+        }
+        uint64_t totalNs = selfNs + waitNs;
+
+        {
+            common::JsonWriter out(fd);
+            out.beginObject()
+               .member("program", program)
+               .member("runs", runs_)
+               .member("totalUs", toUs(totalNs))
+               .member("selfUs", toUs(selfNs))
+               .member("waitAckUs", toUs(waitNs))
+               .key("lines").beginArray();
+            for(size_t lineNo = 1; lineNo < lines_.size(); lineNo++){
+                const LineProfile& p = lines_[lineNo];
+                if(p.hits == 0) continue;
+                double percent = totalNs > 0 ? 100.0 * (p.selfNs + p.waitAckNs) / totalNs : 0.0;
+                out.beginObject()
+                   .member("line", lineNo)
+                   .member("hits", p.hits)
+                   .member("selfUs", toUs(p.selfNs))
+                   .member("waitAckUs", toUs(p.waitAckNs))
+                   .member("percent", static_cast<double>(static_cast<int64_t>(percent * 10.0 + 0.5)) / 10.0)
+                   .endObject();
+            }
+            out.endArray().endObject();
+            out.endLine();
+        }
+        ::close(fd);
+        return true;
+    }
+
+    bool Profiler::writeFolded(const std::string& path, const std::string& program, std::string& error) const{
+        std::FILE* out = std::fopen(path.c_str(), "w");
+        if(!out){
+            error = "cannot create " + path + ": " + std::strerror(errno);
+            return false;
+        }
+
+        std::string root = frameName(program);
+        std::vector<int> chain;
+        for(size_t lineNo = 1; lineNo < lines_.size(); lineNo++){
+            const LineProfile& p = lines_[lineNo];
+            if(p.hits == 0) continue;
+
+            chain.clear();
+            for(int l = static_cast<int>(lineNo); l > 0; l = lines_[l].parent){
+                // Parser line numbers are approximate, don't trust them to be acyclic
+                if(std::find(chain.begin(), chain.end(), l) != chain.end()) break;
+                chain.push_back(l);
+            }
+            std::string stack = root;
+            for(auto it = chain.rbegin(); it != chain.rend(); ++it) stack += ";line " + std::to_string(*it);
+
+            if(toUs(p.selfNs) > 0) std::fprintf(out, "%s %llu\n", stack.c_str(), (unsigned long long)toUs(p.selfNs));
+            if(toUs(p.waitAckNs) > 0){
+                std::fprintf(out, "%s;WAITING_ACK %llu\n", stack.c_str(), (unsigned long long)toUs(p.waitAckNs));
+            }
+        }
+        std::fclose(out);
+        return true;
+    }
+
+}
@@ -0,0 +1,322 @@
+#include "sink/command_sink.hpp"
+#include "common/json.hpp"
+#include "trace/trace.hpp"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace grs_sink{
+
+    namespace{
+
+        const char* kCommandTypeNames[] = {
+            "PTP","PTP_REL","LIN","LIN_REL","CIRC","CIRC_REL",
+            "SPLINE","SPLINE_REL","WAIT","OUTPUT","UNKNOWN"
+        };
+
+        uint64_t nowNs(){
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        bool writeAll(int fd, const char* data, size_t size){
+            while(size > 0){
+                ssize_t n = ::write(fd, data, size);
+                if(n < 0 && errno == EINTR) continue;
+                if(n <= 0) return false;
+                data += n;
+                size -= static_cast<size_t>(n);
+            }
+            return true;
+        }
+
+        // The text grs_step has always printed for a command
+        class ConsoleSink : public CommandSink{
+            public:
+                explicit ConsoleSink(std::FILE* out) : out_(out){}
+
+                void write(const CommandRecord& record) override{
+                    const grs_executor::RobotCommand& cmd = record.cmd;
+                    std::fprintf(out_, "  [ROBOT CMD] %s", kCommandTypeNames[static_cast<int>(cmd.type)]);
+                    if(cmd.type == grs_executor::RobotCommand::Type::OUTPUT){
+                        std::fprintf(out_, " $OUT[%d] = %s", (int)cmd.ioIndex, cmd.ioValue ? "TRUE" : "FALSE");
+                    } else if(cmd.type == grs_executor::RobotCommand::Type::WAIT){
+                        std::fprintf(out_, " time=%g", cmd.waitTime);
+                    } else {
+                        std::fprintf(out_, " target=%s", cmd.targetName.c_str());
+                        grs_executor::orderParams(cmd, params_);
+                        for(const Param* param : params_){
+                            std::fprintf(out_, " %s=%s", param->first.c_str(),
+                                         common::valueToString(param->second).c_str());
+                        }
+                    }
+                    std::fprintf(out_, " (line %d)\n", cmd.sourceLine);
+                }
+
+                void flush() override{ std::fflush(out_); }
+
+            private:
+                std::FILE* out_;
+                std::vector<const Param*> params_;
+        };
+
+        // Also the tcp sink, on a connected socket
+        class JsonLinesSink : public CommandSink{
+            public:
+                explicit JsonLinesSink(int fd) : fd_(fd), out_(fd){}
+                ~JsonLinesSink() override{ close(); }
+
+                void write(const CommandRecord& record) override{
+                    const grs_executor::RobotCommand& cmd = record.cmd;
+                    out_.beginObject()
+                        .member("seq", record.seq)
+                        .member("tUs", record.timeNs / 1000)
+                        .member("type", kCommandTypeNames[static_cast<int>(cmd.type)]);
+                    if(cmd.type == grs_executor::RobotCommand::Type::OUTPUT){
+                        out_.member("index", (int)cmd.ioIndex).member("value", cmd.ioValue);
+                    } else if(cmd.type == grs_executor::RobotCommand::Type::WAIT){
+                        out_.member("time", cmd.waitTime);
+                    } else {
+                        out_.member("target", cmd.targetName);
+                        if(!cmd.params.empty()){
+                            out_.key("params").beginObject();
+                            grs_executor::orderParams(cmd, params_);
+                            for(const Param* param : params_) writeParam(*param);
+                            out_.endObject();
+                        }
+                    }
+                    out_.member("line", cmd.sourceLine).endObject();
+                    out_.endLine();
+                }
+
+                void flush() override{ out_.flush(); }
+
+                void close() override{
+                    if(fd_ < 0) return;
+                    out_.flush();
+                    ::close(fd_);
+                    fd_ = -1;
+                }
+
+            private:
+                int fd_;
+                common::JsonWriter out_;
+                std::vector<const Param*> params_;
+
+                // Numbers stay JSON numbers, as in the --debug output event
+                void writeParam(const Param& param){
+                    out_.key(param.first);
+                    if(auto* i = std::get_if<int>(&param.second)) out_.value(*i);
+                    else if(auto* d = std::get_if<double>(&param.second)) out_.value(*d);
+                    else if(auto* b = std::get_if<bool>(&param.second)) out_.value(*b);
+                    else out_.value(common::valueToString(param.second));
+                }
+        };
+
+        constexpr char kBinaryMagic[8] = {'G','R','S','C','M','D','0','1'};
+
+        class BinarySink : public CommandSink{
+            public:
+                explicit BinarySink(int fd) : fd_(fd){
+                    buffer_.append(kBinaryMagic, sizeof(kBinaryMagic));
+                }
+                ~BinarySink() override{ close(); }
+
+                void write(const CommandRecord& record) override{
+                    size_t start = buffer_.size();
+                    uint32_t len = 0;
+                    buffer_.append(reinterpret_cast<const char*>(&len), sizeof(len));
+                    buffer_.append(reinterpret_cast<const char*>(&record.timeNs), sizeof(record.timeNs));
+                    grs_trace::encodeCommand(buffer_, record.cmd);
+                    len = static_cast<uint32_t>(buffer_.size() - start - sizeof(len));
+                    std::memcpy(&buffer_[start], &len, sizeof(len));
+                }
+
+                void flush() override{
+                    if(fd_ >= 0 && !buffer_.empty()) writeAll(fd_, buffer_.data(), buffer_.size());
+                    buffer_.clear();
+                }
+
+                void close() override{
+                    if(fd_ < 0) return;
+                    flush();
+                    ::close(fd_);
+                    fd_ = -1;
+                }
+
+            private:
+                int fd_;
+                std::string buffer_;      // keeps its capacity between batches
+        };
+
+        int createFile(const std::string& path, std::string& error){
+            int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if(fd < 0) error = "cannot create " + path + ": " + std::strerror(errno);
+            return fd;
+        }
+
+        int connectTo(const std::string& spec, std::string& error){
+            std::string host = "127.0.0.1";
+            std::string port = spec;
+            auto colon = spec.rfind(':');
+            if(colon != std::string::npos){
+                host = spec.substr(0, colon);
+                port = spec.substr(colon + 1);
+            }
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(static_cast<uint16_t>(std::atoi(port.c_str())));
+            if(::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1){
+                error = "bad address: " + host;
+                return -1;
+            }
+            int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if(fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0){
+                error = "cannot connect to " + spec + ": " + std::strerror(errno);
+                if(fd >= 0) ::close(fd);
+                return -1;
+            }
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            // A client that goes away must not kill the run
+            std::signal(SIGPIPE, SIG_IGN);
+            return fd;
+        }
+
+    }
+
+    AsyncSink::AsyncSink(std::unique_ptr<CommandSink> inner, Overflow overflow, size_t capacity)
+        : inner_(std::move(inner)), overflow_(overflow), capacity_(capacity > 0 ? capacity : 1){
+        queue_.reserve(capacity_);
+        worker_ = std::thread(&AsyncSink::run, this);
+    }
+
+    AsyncSink::~AsyncSink(){ close(); }
+
+    void AsyncSink::write(const CommandRecord& record){
+        std::unique_lock<std::mutex> lock(mutex_);
+        if(closing_) return;
+        if(queue_.size() >= capacity_){
+            if(overflow_ == Overflow::DROP){
+                dropped_++;
+                return;
+            }
+            space_.wait(lock, [this]{ return queue_.size() < capacity_ || closing_; });
+        }
+        // The worker only sleeps on an empty queue
+        bool wake = queue_.empty();
+        queue_.push_back(record);
+        queued_++;
+        lock.unlock();
+        if(wake) ready_.notify_one();
+    }
+
+    void AsyncSink::flush(){
+        std::unique_lock<std::mutex> lock(mutex_);
+        uint64_t target = queued_;
+        written_.wait(lock, [this, target]{ return done_ >= target; });
+    }
+
+    void AsyncSink::close(){
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if(closing_) return;
+            closing_ = true;
+        }
+        ready_.notify_one();
+        space_.notify_all();
+        worker_.join();
+        inner_->close();
+    }
+
+    uint64_t AsyncSink::dropped() const{
+        std::lock_guard<std::mutex> lock(mutex_);
+        return dropped_ + inner_->dropped();
+    }
+
+    void AsyncSink::run(){
+        std::vector<CommandRecord> batch;
+        batch.reserve(capacity_);
+        std::unique_lock<std::mutex> lock(mutex_);
+        while(true){
+            ready_.wait(lock, [this]{ return !queue_.empty() || closing_; });
+            if(queue_.empty()) break;   // closing, and everything is written
+            batch.swap(queue_);
+            lock.unlock();
+            space_.notify_all();
+
+            for(const auto& record : batch) inner_->write(record);
+            inner_->flush();
+
+            lock.lock();
+            done_ += batch.size();
+            batch.clear();
+            written_.notify_all();
+        }
+    }
+
+    FanOutSink::FanOutSink() : startNs_(nowNs()){}
+
+    void FanOutSink::add(std::unique_ptr<CommandSink> sink){
+        sinks_.push_back(std::move(sink));
+    }
+
+    void FanOutSink::emit(const grs_executor::RobotCommand& cmd){
+        if(sinks_.empty()) return;
+        record_.seq++;
+        record_.timeNs = nowNs() - startNs_;
+        record_.cmd = cmd;
+        write(record_);
+    }
+
+    void FanOutSink::write(const CommandRecord& record){
+        for(auto& sink : sinks_) sink->write(record);
+    }
+
+    void FanOutSink::flush(){
+        for(auto& sink : sinks_) sink->flush();
+    }
+
+    void FanOutSink::close(){
+        for(auto& sink : sinks_) sink->close();
+    }
+
+    uint64_t FanOutSink::dropped() const{
+        uint64_t count = 0;
+        for(const auto& sink : sinks_) count += sink->dropped();
+        return count;
+    }
+
+    std::unique_ptr<CommandSink> openSink(const std::string& spec, std::string& error){
+        auto colon = spec.find(':');
+        std::string kind = spec.substr(0, colon);
+        std::string target = colon == std::string::npos ? "" : spec.substr(colon + 1);
+        using Overflow = AsyncSink::Overflow;
+
+        if(kind == "console" && target.empty()){
+            return std::make_unique<AsyncSink>(std::make_unique<ConsoleSink>(stdout), Overflow::BLOCK);
+        }
+        if((kind == "jsonl" || kind == "bin") && !target.empty()){
+            int fd = createFile(target, error);
+            if(fd < 0) return nullptr;
+            if(kind == "jsonl") return std::make_unique<AsyncSink>(std::make_unique<JsonLinesSink>(fd), Overflow::BLOCK);
+            return std::make_unique<AsyncSink>(std::make_unique<BinarySink>(fd), Overflow::BLOCK);
+        }
+        if(kind == "tcp" && !target.empty()){
+            int fd = connectTo(target, error);
+            if(fd < 0) return nullptr;
+            return std::make_unique<AsyncSink>(std::make_unique<JsonLinesSink>(fd), Overflow::DROP);
+        }
+        error = "unknown sink '" + spec + "' (console, jsonl:<file>, bin:<file>, tcp:[host:]port)";
+        return nullptr;
+    }
+
+}
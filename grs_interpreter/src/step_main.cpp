@@ -8,77 +8,81 @@
 #include <thread>
 #include <csignal>
 #include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 #include "lexer/lexer.hpp"
 #include "parser/parser.hpp"
 #include "executor/step_executor.hpp"
 #include "io/io_provider.hpp"
 #include "io/tcp_io_provider.hpp"
 #include "common/utils.hpp"
+#include "debug/debug_protocol.hpp"
+#include "batch/batch_runner.hpp"
+#include "trace/trace.hpp"
+#include "profile/profiler.hpp"
+#include "coverage/coverage.hpp"
+#include "sink/command_sink.hpp"
 
 namespace fs = std::filesystem;
 
 // Global pointer for signal handler cleanup
 static std::shared_ptr<grs_io::TcpIOProvider> g_tcpIO;
-static std::atomic<bool> g_terminated{false};
+static volatile std::sig_atomic_t g_terminated = 0;
 
-static void signalHandler(int sig) {
-    g_terminated = true;
-    // Clean shutdown: clear outputs and disconnect TCP
+// SIGINT/SIGTERM only raise the flag; the main thread acts on it in
+// exitIfTerminated(). Nothing else here is async-signal-safe.
+static void signalHandler(int) {
+    g_terminated = 1;
+}
+
+// Helper threads (TCP receive, sinks) are started with both signals blocked,
+// so they always interrupt the main thread's blocking reads
+static void blockTerminationSignals(bool block) {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    pthread_sigmask(block ? SIG_BLOCK : SIG_UNBLOCK, &set, nullptr);
+}
+
+static void installSignalHandler() {
+    struct sigaction sa{};
+    sa.sa_handler = signalHandler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;  // no SA_RESTART: the step prompt and debug reads return
+    sigaction(SIGTERM, &sa, nullptr);
+    sigaction(SIGINT, &sa, nullptr);
+}
+
+// Clean shutdown after a signal: clear outputs and disconnect TCP.
+// Called on the main thread between statements, in hardware waits and at prompts.
+static void exitIfTerminated() {
+    if (!g_terminated) return;
     if (g_tcpIO) {
         for (int i = 0; i < 8; i++) {
             g_tcpIO->writeDigitalOutput(i, false);
         }
-        // Small delay so the clear-outputs packet reaches Holly
-        usleep(50000);  // 50ms
+        // Run mode keeps a batch open — push the clear commands out now
+        g_tcpIO->flush();
+        // Give the clear-outputs packet a moment to reach Holly
+        g_tcpIO->waitForAck(50);
         g_tcpIO->disconnect();
         g_tcpIO.reset();
     }
     std::_Exit(0);
 }
 
-void printRobotCommand(const grs_executor::RobotCommand& cmd) {
-    static const char* typeNames[] = {
-        "PTP", "PTP_REL", "LIN", "LIN_REL", "CIRC", "CIRC_REL",
-        "SPLINE", "SPLINE_REL", "WAIT", "OUTPUT", "UNKNOWN"
-    };
-    
-    int idx = static_cast<int>(cmd.type);
-    std::cout << "  [ROBOT CMD] " << typeNames[idx];
-    
-    if (cmd.type == grs_executor::RobotCommand::Type::OUTPUT) {
-        std::cout << " $OUT[" << (int)cmd.ioIndex << "] = " << (cmd.ioValue ? "TRUE" : "FALSE");
-    } else if (cmd.type == grs_executor::RobotCommand::Type::WAIT) {
-        std::cout << " time=" << cmd.waitTime;
-    } else {
-        std::cout << " target=" << cmd.targetName;
-        // Output params in canonical order: x,y,z,a,b,c then a1-a6/A1-A6
-        static const std::string orderedKeys[] = {
-            "x","y","z","a","b","c",
-            "a1","a2","a3","a4","a5","a6",
-            "A1","A2","A3","A4","A5","A6"
-        };
-        // First: known keys in order
-        for (const auto& ok : orderedKeys) {
-            for (const auto& [k, v] : cmd.params) {
-                if (k == ok) {
-                    std::cout << " " << k << "=" << common::valueToString(v);
-                    break;
-                }
-            }
-        }
-        // Then: any remaining keys not in ordered list
-        for (const auto& [k, v] : cmd.params) {
-            bool found = false;
-            for (const auto& ok : orderedKeys) {
-                if (k == ok) { found = true; break; }
-            }
-            if (!found) {
-                std::cout << " " << k << "=" << common::valueToString(v);
-            }
-        }
-    }
-    std::cout << " (line " << cmd.sourceLine << ")" << std::endl;
-}
+// Lets a running program be interrupted even between commands
+class TerminationCheck : public grs_executor::ExecutionListener {
+    public:
+        void statementStarted(size_t, int) override { exitIfTerminated(); }
+};
 
 // Helper: send a RobotCommand to hardware via TCP
 // Used by all modes (debug, step, run) when --tcp is active
@@ -121,12 +125,558 @@ void sendTcpCommand(const std::shared_ptr<grs_io::TcpIOProvider>& tcpIO,
     tcpIO->sendRobotCommand(cmdType, coords, axes, cmd.waitTime, 0, 0);
 }
 
+// Hardware ACK: the RT loop must have executed everything sent so far.
+// Motions are acknowledged to the executor while the bridge is at most
+// kLookahead commands behind (waitForLookahead); WAIT and $OUT are
+// synchronization points that wait for all of them.
+// The bridge times WAIT itself, so reaching a WAIT's done is its pacing.
+static const int kDoneTimeoutMs = 60000;
+static const uint64_t kLookahead = 32;
+
+void waitForHardware(const std::shared_ptr<grs_io::TcpIOProvider>& tcpIO) {
+    static uint64_t reportedFailure = 0;
+    if (!tcpIO) return;
+    tcpIO->flush();
+    uint64_t id = tcpIO->getLastCommandId();
+    // In slices, so a signal is handled while the robot is still busy
+    bool done = id == 0;
+    for (int waited = 0; !done && waited < kDoneTimeoutMs; waited += 100) {
+        done = tcpIO->waitForDone(id, 100);
+        exitIfTerminated();
+    }
+    if (!done) {
+        std::cerr << "[TCP] cmd #" << id << " not reported done by the bridge" << std::endl;
+    }
+    uint64_t failed = tcpIO->getFailedCommandId();
+    if (failed > reportedFailure) {
+        std::cerr << "[TCP] cmd #" << failed << " failed on the bridge (see bridge log)" << std::endl;
+        reportedFailure = failed;
+    }
+}
+
+// Lookahead ACK: blocks until the bridge has finished all but the last
+// kLookahead commands sent, so a bridge that stops consuming stalls the program
+void waitForLookahead(const std::shared_ptr<grs_io::TcpIOProvider>& tcpIO) {
+    if (!tcpIO) return;
+    uint64_t id = tcpIO->getLastCommandId();
+    if (id <= kLookahead) return;
+    uint64_t needed = id - kLookahead;
+    if (tcpIO->getDoneCommandId() >= needed) return;
+    // The bridge cannot finish what is still waiting in an open batch
+    tcpIO->flush();
+    bool done = false;
+    for (int waited = 0; !done && waited < kDoneTimeoutMs; waited += 100) {
+        done = tcpIO->waitForDone(needed, 100);
+        exitIfTerminated();
+    }
+    if (!done) {
+        std::cerr << "[TCP] cmd #" << needed << " not reported done by the bridge" << std::endl;
+    }
+}
+
+bool isSyncPoint(const grs_executor::RobotCommand& cmd) {
+    return cmd.type == grs_executor::RobotCommand::Type::WAIT ||
+           cmd.type == grs_executor::RobotCommand::Type::OUTPUT;
+}
+
+bool readFile(const std::string& path, std::string& out) {
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
+    out.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// Lexes and parses; on failure errors holds one "Parse Error: ..." line per problem
+std::shared_ptr<grs_ast::FunctionBlock> parseProgram(const std::string& code, std::string& errors) {
+    // Suppress parser/lexer debug noise (Token matched, expression() called, etc.)
+    // These go to cerr so they don't flood ZeroBrane output or mix with JSON protocol
+    std::streambuf* origCoutBuf = std::cout.rdbuf();
+    std::cout.rdbuf(std::cerr.rdbuf());
+
+    // Lexer
+    grs_lexer::Lexer lexer;
+    auto tokens = lexer.tokenize(code);
+
+    // Parser
+    grs_parser::Parser parser;
+    auto ast = parser.parse(tokens);
+
+    // Restore stdout for actual program output
+    std::cout.rdbuf(origCoutBuf);
+
+    errors.clear();
+    if (parser.hasErrors()) {
+        for (const auto& error : parser.getErrors()) {
+            errors += "Parse Error: " + error.message + " (Line: " + std::to_string(error.line) + ")\n";
+        }
+        return nullptr;
+    }
+    if (!ast) errors = "AST generation failed!\n";
+    return ast;
+}
+
+// The program in the executor. A load whose source equals the previous one
+// reuses its AST, so re-running an unchanged file skips lexing and parsing.
+struct LoadedProgram {
+    std::string path;     // empty for source sent by the client
+    std::string source;
+    std::shared_ptr<grs_ast::FunctionBlock> ast;
+};
+
+// load/reload: takes the source from the request or reads the file (reload
+// without one re-reads the current path), parses it if it changed and restarts
+// the executor at the first line. live: the edited program continues where the
+// old one stopped, with its variables. Breakpoints are kept.
+bool loadProgram(LoadedProgram& program, const grs_debug::DebugRequest& request,
+                 grs_executor::StepExecutor& executor, std::string& error, bool& parsed) {
+    std::string source;
+    std::string path = program.path;
+    if (request.isSource) {
+        source = request.text;
+        path.clear();
+    } else {
+        if (!request.text.empty()) path = request.text;
+        if (path.empty()) {
+            error = "nothing to reload";
+            return false;
+        }
+        if (!readFile(path, source)) {
+            error = "Error opening file: " + path;
+            return false;
+        }
+    }
+
+    parsed = !program.ast || source != program.source;
+    std::shared_ptr<grs_ast::FunctionBlock> ast = program.ast;
+    if (parsed) {
+        ast = parseProgram(source, error);
+        if (!ast) return false;
+    }
+    program.path = path;
+    program.source = std::move(source);
+    program.ast = ast;
+    if (request.live) {
+        executor.reload(ast);
+    } else {
+        executor.load(ast);
+    }
+    return true;
+}
+
+struct DebugContext {
+    grs_executor::StepExecutor& executor;
+    std::shared_ptr<grs_io::TcpIOProvider> tcpIO;
+    std::shared_ptr<grs_io::LocalIOProvider> localIO;
+    LoadedProgram& program;
+    grs_sink::FanOutSink& sinks;
+};
+
+grs_debug::IOSnapshot readIO(const DebugContext& ctx) {
+    grs_debug::IOSnapshot io;
+    if (ctx.localIO) {
+        io.inputs = ctx.localIO->getInputWord();
+        io.outputs = ctx.localIO->getOutputWord();
+    } else if (ctx.tcpIO) {
+        io.inputs = ctx.tcpIO->getInputByte();
+        io.outputs = ctx.tcpIO->getOutputByte();
+        io.hasReady = true;
+        io.ready = ctx.tcpIO->isSystemReady();
+    }
+    return io;
+}
+
+// A client's delta subscription: the variables version and I/O it was last sent
+struct Subscription {
+    bool active = false;
+    uint64_t version = 0;
+    bool ioKnown = false;
+    grs_debug::IOSnapshot io;
+    grs_debug::StateDelta delta;   // reused, keeps its capacity
+};
+
+// Sends what changed since the last delta; nothing when nothing did, unless always
+void pushDelta(grs_debug::DebugProtocol& proto, const DebugContext& ctx, Subscription& sub, bool always) {
+    const grs_executor::StepExecutor& executor = ctx.executor;
+    grs_debug::StateDelta& d = sub.delta;
+    // A version from before the last load/reset, or from another server run, cannot be patched
+    d.full = sub.version == 0 || sub.version < executor.getVariablesResetVersion() ||
+             sub.version > executor.getVariablesVersion();
+    d.base = d.full ? 0 : sub.version;
+    d.version = executor.getVariablesVersion();
+    executor.collectChangedVariables(d.base, d.variables);
+
+    d.io = readIO(ctx);
+    d.inputsChanged = sub.ioKnown ? d.io.inputs ^ sub.io.inputs : ~0u;
+    d.outputsChanged = sub.ioKnown ? d.io.outputs ^ sub.io.outputs : ~0u;
+    d.hasIO = d.full || d.inputsChanged || d.outputsChanged ||
+              (sub.ioKnown && d.io.ready != sub.io.ready);
+
+    if (!always && !d.full && d.variables.empty() && !d.hasIO) return;
+    proto.delta(d);
+    sub.version = d.version;
+    sub.io = d.io;
+    sub.ioKnown = true;
+}
+
+// Answers one client's requests until it disconnects. endOnTermination: the
+// stdin/stdout session ends with the program, a server session outlives it.
+void runDebugSession(grs_debug::DebugProtocol& proto, DebugContext& ctx, bool endOnTermination) {
+    grs_executor::StepExecutor& executor = ctx.executor;
+    const std::shared_ptr<grs_io::TcpIOProvider>& tcpIO = ctx.tcpIO;
+    grs_sink::FanOutSink& sinks = ctx.sinks;
+
+    // Robot command callback — output event + TCP extended send
+    executor.setCommandCallback([&executor, &tcpIO, &proto, &sinks](const grs_executor::RobotCommand& cmd) {
+        proto.output(cmd);
+        sinks.emit(cmd);
+        
+        // Send motion/wait commands to hardware via TCP
+        sendTcpCommand(tcpIO, cmd);
+        if (isSyncPoint(cmd) && tcpIO) {
+            proto.flush();
+            waitForHardware(tcpIO);
+        } else {
+            waitForLookahead(tcpIO);
+        }
+        
+        // Auto-ACK in debug mode, once the bridge has caught up far enough
+        executor.acknowledgeCommand();
+    });
+
+    // Send initial ready event (include first line number for IDE cursor positioning)
+    proto.initialized(executor.getCurrentLine());
+    proto.flush();
+
+    using Request = grs_debug::DebugRequest::Type;
+    grs_debug::DebugRequest request;
+    std::string loadError;
+    Subscription sub;
+    bool done = false;
+    while (!done && proto.readRequest(request)) {
+        switch (request.type) {
+        case Request::STEP: {
+            if (executor.getStatus() == grs_executor::ExecutionStatus::WAITING_ACK) {
+                executor.acknowledgeCommand();
+            }
+            bool hasMore = executor.step();
+            if (executor.getStatus() == grs_executor::ExecutionStatus::ERROR) {
+                proto.error(executor.getErrorMessage());
+            } else if (!hasMore || executor.getStatus() == grs_executor::ExecutionStatus::COMPLETED) {
+                proto.terminated();
+                done = endOnTermination;
+            } else {
+                proto.stopped(executor.getCurrentLine(), grs_debug::StopReason::STEP);
+            }
+            break;
+        }
+        case Request::CONTINUE:
+            if (executor.getStatus() == grs_executor::ExecutionStatus::WAITING_ACK) {
+                executor.acknowledgeCommand();
+            }
+            // Everything up to the next breakpoint goes out as one batch
+            if (tcpIO) tcpIO->beginBatch();
+            executor.run();
+            if (tcpIO) tcpIO->endBatch();
+            if (executor.getStatus() == grs_executor::ExecutionStatus::COMPLETED) {
+                proto.terminated();
+                done = endOnTermination;
+            } else if (executor.getStatus() == grs_executor::ExecutionStatus::ERROR) {
+                proto.error(executor.getErrorMessage());
+            } else {
+                proto.stopped(executor.getCurrentLine(), grs_debug::StopReason::BREAKPOINT);
+            }
+            break;
+        case Request::SET_BREAKPOINT:
+            executor.addBreakpoint(request.line);
+            proto.breakpointSet(request.line);
+            break;
+        case Request::REMOVE_BREAKPOINT:
+            executor.removeBreaPoint(request.line);
+            proto.breakpointRemoved(request.line);
+            break;
+        case Request::CLEAR_BREAKPOINTS:
+            executor.clearBreakPoint();
+            proto.breakpointsCleared();
+            break;
+        case Request::GET_VARIABLES:
+            proto.variables(executor.getVariables());
+            break;
+        case Request::GET_IO:
+            proto.io(readIO(ctx));
+            break;
+        case Request::SUBSCRIBE:
+            // Answered with a delta from the client's version (a snapshot if it has none)
+            sub.active = true;
+            sub.version = request.since;
+            sub.ioKnown = false;
+            pushDelta(proto, ctx, sub, true);
+            break;
+        case Request::UNSUBSCRIBE:
+            sub.active = false;
+            break;
+        case Request::GET_LATENCY:
+            // Per-command latency from the hardware bridge, µs
+            if (tcpIO) {
+                common::LatencyHistogram sendToAck = tcpIO->getSendToAckHistogram();
+                common::LatencyHistogram ackToDone = tcpIO->getAckToDoneHistogram();
+                proto.latency(&sendToAck, &ackToDone);
+            } else {
+                proto.latency(nullptr, nullptr);
+            }
+            break;
+        case Request::RESET_LATENCY:
+            if (tcpIO) tcpIO->resetLatency();
+            proto.latencyReset();
+            break;
+        case Request::LOAD:
+        case Request::RELOAD: {
+            // The robot finishes what the old program sent before the new one starts
+            if (!request.live) waitForHardware(tcpIO);
+            bool parsed = false;
+            if (!loadProgram(ctx.program, request, executor, loadError, parsed)) {
+                if (!loadError.empty() && loadError.back() == '\n') loadError.pop_back();
+                proto.error(loadError);
+            } else if (executor.getStatus() == grs_executor::ExecutionStatus::ERROR) {
+                // A changed declaration failed to run again
+                proto.error(executor.getErrorMessage());
+            } else {
+                proto.loaded(ctx.program.path, executor.getCurrentLine(), parsed);
+            }
+            break;
+        }
+        case Request::DISCONNECT:
+            executor.stop();
+            proto.terminated();
+            done = true;
+            break;
+        case Request::MALFORMED:
+            proto.error("malformed request");
+            break;
+        case Request::UNKNOWN:
+            break;
+        }
+        // Subscribed clients get the changes right after the stop/terminated/loaded event
+        if (sub.active && (request.type == Request::STEP || request.type == Request::CONTINUE ||
+                           request.type == Request::LOAD || request.type == Request::RELOAD)) {
+            pushDelta(proto, ctx, sub, false);
+        }
+        proto.flush();
+    }
+}
+
+// "unix:/path" or "[host:]port"; -1 after reporting on failure
+int listenOn(const std::string& spec) {
+    int fd = -1;
+    if (spec.rfind("unix:", 0) == 0) {
+        std::string path = spec.substr(5);
+        sockaddr_un addr{};
+        if (path.size() >= sizeof(addr.sun_path)) {
+            std::cerr << "[SERVE] Socket path too long: " << path << std::endl;
+            return -1;
+        }
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        ::unlink(path.c_str());
+        if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            std::cerr << "[SERVE] Cannot bind " << path << ": " << std::strerror(errno) << std::endl;
+            if (fd >= 0) ::close(fd);
+            return -1;
+        }
+    } else {
+        std::string host = "127.0.0.1";
+        std::string port = spec;
+        auto colon = spec.rfind(':');
+        if (colon != std::string::npos) {
+            host = spec.substr(0, colon);
+            port = spec.substr(colon + 1);
+        }
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(std::atoi(port.c_str())));
+        if (::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+            std::cerr << "[SERVE] Bad address: " << host << std::endl;
+            return -1;
+        }
+        fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int one = 1;
+        if (fd >= 0) ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            std::cerr << "[SERVE] Cannot bind " << spec << ": " << std::strerror(errno) << std::endl;
+            if (fd >= 0) ::close(fd);
+            return -1;
+        }
+    }
+    if (::listen(fd, 4) != 0) {
+        std::cerr << "[SERVE] listen failed: " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// One client at a time. The robot link, the parsed program and the
+// breakpoints outlive each connection, so an IDE run is connect + load.
+int serveDebug(const std::string& spec, bool binary, DebugContext& ctx) {
+    int listenFd = listenOn(spec);
+    if (listenFd < 0) return 1;
+    std::signal(SIGPIPE, SIG_IGN);  // a client closing mid-response must not kill the server
+    std::cerr << "[SERVE] Debug server on " << spec << " (" << (binary ? "binary" : "JSON") << ")" << std::endl;
+
+    while (!g_terminated) {
+        int client = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "[SERVE] accept failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        if (spec.rfind("unix:", 0) != 0) {
+            int one = 1;
+            ::setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        {
+            std::unique_ptr<grs_debug::DebugProtocol> proto = binary
+                ? grs_debug::makeBinaryProtocol(client, client)
+                : grs_debug::makeJsonProtocol(client, client);
+            runDebugSession(*proto, ctx, false);
+        }
+        ctx.executor.setCommandCallback(nullptr);
+        ::close(client);
+    }
+    ::close(listenFd);
+    return 0;
+}
+
+// --replay: runs the program again with the trace's input values and checks
+// that it takes the recorded path. No robot, commands are acknowledged at once.
+int replayTrace(const std::string& tracePath, const fs::path& testFile) {
+    grs_trace::Trace trace;
+    std::string error;
+    if (!grs_trace::readTrace(tracePath, trace, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    std::string path = testFile.empty() ? trace.programPath : testFile.string();
+    std::string source;
+    if (!readFile(path, source)) {
+        std::cerr << "Error opening file: " << path << std::endl;
+        return 1;
+    }
+    if (grs_trace::hashSource(source) != trace.sourceHash) {
+        std::cerr << "[REPLAY] warning: " << path << " is not the program the trace was recorded with"
+                  << std::endl;
+    }
+    std::string parseErrors;
+    auto ast = parseProgram(source, parseErrors);
+    if (!ast) {
+        std::cerr << parseErrors;
+        return 1;
+    }
+
+    auto replayIO = std::make_shared<grs_trace::ReplayIOProvider>(trace);
+    grs_executor::StepExecutor executor(replayIO);
+    grs_trace::TraceVerifier verifier(trace);
+    executor.addListener(&verifier);
+    executor.setCommandCallback([&executor](const grs_executor::RobotCommand&) {
+        executor.acknowledgeCommand();
+    });
+    executor.load(ast);
+    executor.run();
+
+    std::cout << "\n=== Replay of " << tracePath << " ===" << std::endl;
+    std::cout << "  " << verifier.matched() << " records matched, "
+              << replayIO->inputsReplayed() << "/" << replayIO->inputsRecorded() << " input reads replayed"
+              << std::endl;
+    if (trace.dropped > 0) {
+        std::cout << "  " << trace.dropped << " records were dropped while recording, checked up to the gap"
+                  << std::endl;
+    }
+
+    const std::string& divergence = !replayIO->divergence().empty() ? replayIO->divergence()
+                                                                     : verifier.divergence();
+    if (!divergence.empty()) {
+        std::cout << "  DIVERGED: " << divergence << std::endl;
+        return 1;
+    }
+    if (!verifier.complete()) {
+        std::cout << "  DIVERGED: the replay stopped at line " << executor.getCurrentLine()
+                  << " before the recorded run did" << std::endl;
+        return 1;
+    }
+    std::cout << "  MATCH" << std::endl;
+    return 0;
+}
+
+// Flushes --trace and says where it went
+void finishTrace(std::unique_ptr<grs_trace::TraceRecorder>& recorder, const std::string& path) {
+    if (!recorder) return;
+    recorder->close();
+    std::cerr << "[TRACE] " << recorder->records() << " records written to " << path;
+    if (recorder->dropped() > 0) std::cerr << ", " << recorder->dropped() << " dropped (ring full)";
+    std::cerr << std::endl;
+    recorder.reset();
+}
+
+// Writes --profile / --profile-folded
+void finishProfile(std::unique_ptr<grs_profile::Profiler>& profiler, const std::string& program,
+                   const std::string& jsonPath, const std::string& foldedPath) {
+    if (!profiler) return;
+    std::string error;
+    if (!jsonPath.empty()) {
+        if (profiler->writeJson(jsonPath, program, error)) std::cerr << "[PROFILE] " << jsonPath << std::endl;
+        else std::cerr << error << std::endl;
+    }
+    if (!foldedPath.empty()) {
+        if (profiler->writeFolded(foldedPath, program, error)) std::cerr << "[PROFILE] " << foldedPath << std::endl;
+        else std::cerr << error << std::endl;
+    }
+    profiler.reset();
+}
+
+// Writes --coverage
+void finishCoverage(std::unique_ptr<grs_coverage::CoverageCollector>& collector, const std::string& program,
+                    const std::string& path, bool append) {
+    if (!collector) return;
+    grs_coverage::CoverageReport report;
+    report.merge(program, collector->result());
+    grs_coverage::CoverageSummary summary;
+    std::string error;
+    if (grs_coverage::saveLcov(path, report, append, summary, error)) {
+        grs_coverage::printSummary(stderr, summary, path);
+    } else {
+        std::cerr << error << std::endl;
+    }
+    collector.reset();
+}
+
+// Writes out what the --sink threads still hold
+void finishSinks(grs_sink::FanOutSink& sinks) {
+    sinks.close();
+    if (sinks.dropped() > 0) {
+        std::cerr << "[SINK] " << sinks.dropped() << " commands dropped (queue full)" << std::endl;
+    }
+}
+
 int main(int argc, char* argv[]) {
     fs::path testFile;
     bool stepMode = false;
     bool debugMode = false;   // --debug: JSON-line protocol for IDE
+    bool binaryProtocol = false;  // --debug-binary: debug mode with binary frames
+    std::string serveSpec;        // --serve unix:<path> | [host:]port: persistent debug server
+    grs_batch::BatchOptions batch;  // --batch <dir|glob>: headless regression run
+    std::string tracePath;        // --trace <file>: record the run
+    size_t traceRingKb = grs_trace::TraceRecorder::kDefaultRingBytes / 1024;
+    std::string replayPath;       // --replay <file>: run again from a trace and compare
+    std::string dumpPath;         // --trace-dump <file>: print a trace
+    std::string profilePath;      // --profile <file.json>: per-line time
+    std::string foldedPath;       // --profile-folded <file>: the same as flamegraph stacks
+    std::string coveragePath;     // --coverage <file.info>: lcov statement/branch coverage
+    bool coverageAppend = false;  // --coverage-append: add to the counts in that file
+    std::vector<std::string> sinkSpecs;  // --sink <spec>: where emitted commands go
     std::string tcpHost = "";
     int tcpPort = 12345;
+    grs_io::Transport transport = grs_io::Transport::TCP;
 
     // Argumentları parse et
     for (int i = 1; i < argc; i++) {
@@ -135,7 +685,44 @@ int main(int argc, char* argv[]) {
             stepMode = true;
         } else if (arg == "--debug" || arg == "-d") {
             debugMode = true;
-        } else if (arg == "--tcp") {
+        } else if (arg == "--debug-binary") {
+            debugMode = true;
+            binaryProtocol = true;
+        } else if (arg == "--serve" && i + 1 < argc) {
+            debugMode = true;
+            serveSpec = argv[++i];
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batch.patterns.push_back(argv[++i]);
+        } else if (arg == "--jobs" && i + 1 < argc) {
+            batch.jobs = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--golden" && i + 1 < argc) {
+            batch.goldenDir = argv[++i];
+        } else if (arg == "--update-golden") {
+            batch.updateGolden = true;
+        } else if (arg == "--timeout" && i + 1 < argc) {
+            batch.timeoutSeconds = std::stod(argv[++i]);
+        } else if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (arg == "--trace-buffer-kb" && i + 1 < argc) {
+            traceRingKb = std::stoul(argv[++i]);
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (arg == "--trace-dump" && i + 1 < argc) {
+            dumpPath = argv[++i];
+        } else if (arg == "--profile" && i + 1 < argc) {
+            profilePath = argv[++i];
+        } else if (arg == "--profile-folded" && i + 1 < argc) {
+            foldedPath = argv[++i];
+        } else if (arg == "--coverage" && i + 1 < argc) {
+            coveragePath = argv[++i];
+            batch.coveragePath = coveragePath;
+        } else if (arg == "--coverage-append") {
+            coverageAppend = true;
+            batch.coverageAppend = true;
+        } else if (arg == "--sink" && i + 1 < argc) {
+            sinkSpecs.push_back(argv[++i]);
+        } else if (arg == "--tcp" || arg == "--udp") {
+            if (arg == "--udp") transport = grs_io::Transport::UDP;
             if (i + 1 < argc && argv[i+1][0] != '-') {
                 tcpHost = argv[++i];
                 auto colon = tcpHost.find(':');
@@ -151,35 +738,39 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    if (testFile.empty()) {
-        testFile = "../tests/parser_test.txt";
+    if (!batch.patterns.empty()) {
+        return grs_batch::runBatch(batch);
     }
 
-    // Dosyayı oku
-    std::ifstream file(testFile);
-    if (!file.is_open()) {
-        std::cerr << "Error opening file: " << testFile << std::endl;
-        return 1;
+    if (!dumpPath.empty()) {
+        grs_trace::Trace trace;
+        std::string error;
+        if (!grs_trace::readTrace(dumpPath, trace, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        grs_trace::printTrace(trace, stdout);
+        return 0;
     }
-    std::string code((std::istreambuf_iterator<char>(file)),
-                     std::istreambuf_iterator<char>());
-    file.close();
 
-    // Suppress parser/lexer debug noise (Token matched, expression() called, etc.)
-    // These go to cerr so they don't flood ZeroBrane output or mix with JSON protocol
-    std::streambuf* origCoutBuf = std::cout.rdbuf();
-    std::cout.rdbuf(std::cerr.rdbuf());
+    if (!replayPath.empty()) return replayTrace(replayPath, testFile);
 
-    // Lexer
-    grs_lexer::Lexer lexer;
-    auto tokens = lexer.tokenize(code);
-
-    // Parser
-    grs_parser::Parser parser;
-    auto ast = parser.parse(tokens);
+    if (testFile.empty() && serveSpec.empty()) {
+        testFile = "../tests/parser_test.txt";
+    }
 
-    // Restore stdout for actual program output
-    std::cout.rdbuf(origCoutBuf);
+    // A server may start empty and get its program with "load"
+    LoadedProgram program;
+    if (!testFile.empty()) {
+        program.path = testFile.string();
+        // Dosyayı oku
+        if (!readFile(program.path, program.source)) {
+            std::cerr << "Error opening file: " << testFile << std::endl;
+            return 1;
+        }
+    }
+    std::string parseErrors;
+    if (!testFile.empty()) program.ast = parseProgram(program.source, parseErrors);
 
     if (!debugMode) {
         std::cout << "=== GRS Step Executor ===" << std::endl;
@@ -188,16 +779,8 @@ int main(int argc, char* argv[]) {
         std::cout << "=========================" << std::endl;
     }
 
-    if (parser.hasErrors()) {
-        for (const auto& error : parser.getErrors()) {
-            std::cerr << "Parse Error: " << error.message 
-                      << " (Line: " << error.line << ")" << std::endl;
-        }
-        return 1;
-    }
-
-    if (!ast) {
-        std::cerr << "AST generation failed!" << std::endl;
+    if (!testFile.empty() && !program.ast) {
+        std::cerr << parseErrors;
         return 1;
     }
 
@@ -207,7 +790,8 @@ int main(int argc, char* argv[]) {
     std::shared_ptr<grs_io::TcpIOProvider> tcpIO;
 
     if (!tcpHost.empty()) {
-        tcpIO = std::make_shared<grs_io::TcpIOProvider>(tcpHost, tcpPort);
+        blockTerminationSignals(true);
+        tcpIO = std::make_shared<grs_io::TcpIOProvider>(tcpHost, tcpPort, transport);
         if (tcpIO->connect()) {
             ioProvider = tcpIO;
             if (!debugMode) {
@@ -235,14 +819,57 @@ int main(int argc, char* argv[]) {
     // Step Executor
     grs_executor::StepExecutor executor(ioProvider);
 
-    // Register signal handler for clean TCP shutdown on kill
+    if (program.ast) executor.load(program.ast);
+
+    std::unique_ptr<grs_trace::TraceRecorder> recorder;
+    if (!tracePath.empty()) {
+        recorder = std::make_unique<grs_trace::TraceRecorder>();
+        std::string error;
+        if (!recorder->open(tracePath, program.path, program.source, traceRingKb * 1024, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        executor.addListener(recorder.get());
+    }
+
+    std::unique_ptr<grs_profile::Profiler> profiler;
+    if (!profilePath.empty() || !foldedPath.empty()) {
+        profiler = std::make_unique<grs_profile::Profiler>();
+        executor.addListener(profiler.get());
+    }
+
+    // Counts refer to the program given on the command line
+    std::unique_ptr<grs_coverage::CoverageCollector> coverage;
+    if (!coveragePath.empty() && program.ast) {
+        coverage = std::make_unique<grs_coverage::CoverageCollector>(program.ast);
+        executor.addListener(coverage.get());
+    }
+
+    // Step and run mode print commands unless told otherwise; in debug mode
+    // they already go to the IDE, and stdout is the protocol
+    if (sinkSpecs.empty() && !debugMode) sinkSpecs.push_back("console");
+    grs_sink::FanOutSink sinks;
+    for (const auto& spec : sinkSpecs) {
+        std::string error;
+        std::unique_ptr<grs_sink::CommandSink> sink;
+        if (debugMode && spec == "console") error = "the console sink cannot share stdout with --debug";
+        else sink = grs_sink::openSink(spec, error);
+        if (!sink) {
+            std::cerr << "[SINK] " << error << std::endl;
+            return 1;
+        }
+        sinks.add(std::move(sink));
+    }
+
+    // Register signal handler for clean TCP shutdown on kill; every helper
+    // thread is running by now
+    TerminationCheck terminationCheck;
     if (tcpIO) {
         g_tcpIO = tcpIO;
-        std::signal(SIGTERM, signalHandler);
-        std::signal(SIGINT, signalHandler);
+        installSignalHandler();
+        executor.addListener(&terminationCheck);
     }
-
-    executor.load(ast);
+    if (!tcpHost.empty()) blockTerminationSignals(false);
 
     // ═══════════════════════════════════════════════════════════
     // DEBUG MODE — JSON-line protocol over stdin/stdout
@@ -250,175 +877,44 @@ int main(int argc, char* argv[]) {
     // Protocol:
     //   IDE → grs_step (stdin):  {"cmd":"step"} | {"cmd":"continue"} | {"cmd":"setBreakpoint","line":5}
     //                            {"cmd":"getVariables"} | {"cmd":"getIO"} | {"cmd":"disconnect"}
+    //                            {"cmd":"getLatency"} | {"cmd":"resetLatency"}
+    //                            {"cmd":"load","path":".."} | {"cmd":"load","source":".."} | {"cmd":"reload"}
+    //                            {"cmd":"subscribe","since":0} | {"cmd":"unsubscribe"}
     //   grs_step → IDE (stdout): {"event":"stopped","line":3,"reason":"step"}
     //                            {"event":"output","type":"PTP","target":"P1","line":5}
     //                            {"event":"variables","data":[{"name":"x","value":"5","type":"INT"}]}
+    //                            {"event":"latency","unit":"us","sendToAck":{..},"ackToDone":{..}}
+    //                            {"event":"loaded","path":"..","line":3,"parsed":true}
+    //                            {"event":"delta","version":7,"base":4,"full":false,"data":[..],"io":{..}}
     //                            {"event":"terminated"}
+    // --debug-binary: the same requests and events as length-prefixed frames,
+    // see debug/debug_protocol.hpp
+    // --serve unix:<path> | [host:]port: the same protocol on a socket, one
+    // client at a time, in a process that keeps the robot link and program
     // ═══════════════════════════════════════════════════════════
     if (debugMode) {
-        // Robot command callback — JSON output event + TCP extended send
-        executor.setCommandCallback([&executor, &tcpIO](const grs_executor::RobotCommand& cmd) {
-            static const char* typeNames[] = {
-                "PTP","PTP_REL","LIN","LIN_REL","CIRC","CIRC_REL",
-                "SPLINE","SPLINE_REL","WAIT","OUTPUT","UNKNOWN"
-            };
-            int idx = static_cast<int>(cmd.type);
-            std::cout << "{\"event\":\"output\",\"type\":\"" << typeNames[idx] << "\"";
-            if (cmd.type == grs_executor::RobotCommand::Type::OUTPUT) {
-                std::cout << ",\"index\":" << (int)cmd.ioIndex 
-                          << ",\"value\":" << (cmd.ioValue ? "true" : "false");
-            } else if (cmd.type == grs_executor::RobotCommand::Type::WAIT) {
-                std::cout << ",\"time\":" << cmd.waitTime;
-            } else {
-                std::cout << ",\"target\":\"" << cmd.targetName << "\"";
-                // Include position parameters in x,y,z,a,b,c order for IDE display
-                if (!cmd.params.empty()) {
-                    std::cout << ",\"params\":{";
-                    // cmd.params is std::vector<std::pair<string, ValueType>>
-                    // Output in canonical order: x,y,z,a,b,c then a1-a6/A1-A6
-                    static const std::string orderedKeys[] = {
-                        "x","y","z","a","b","c",
-                        "a1","a2","a3","a4","a5","a6",
-                        "A1","A2","A3","A4","A5","A6"
-                    };
-                    bool first = true;
-                    // First: known keys in order
-                    for (const auto& ok : orderedKeys) {
-                        for (const auto& [k, v] : cmd.params) {
-                            if (k == ok) {
-                                if (!first) std::cout << ",";
-                                first = false;
-                                std::cout << "\"" << k << "\":" << common::valueToString(v);
-                                break;
-                            }
-                        }
-                    }
-                    // Then: any remaining keys not in ordered list
-                    for (const auto& [k, v] : cmd.params) {
-                        bool found = false;
-                        for (const auto& ok : orderedKeys) {
-                            if (k == ok) { found = true; break; }
-                        }
-                        if (!found) {
-                            if (!first) std::cout << ",";
-                            first = false;
-                            std::cout << "\"" << k << "\":" << common::valueToString(v);
-                        }
-                    }
-                    std::cout << "}";
-                }
-            }
-            std::cout << ",\"line\":" << cmd.sourceLine << "}" << std::endl;
-            
-            // Send motion/wait commands to hardware via TCP
-            sendTcpCommand(tcpIO, cmd);
-            
-            // Auto-ACK in debug mode
-            executor.acknowledgeCommand();
-        });
-
-        // Send initial ready event (include first line number for IDE cursor positioning)
-        std::cout << "{\"event\":\"initialized\",\"line\":" << executor.getCurrentLine() << "}" << std::endl;
-
-        std::string line;
-        while (std::getline(std::cin, line)) {
-            // Simple JSON parsing (no external library needed)
-            // Extract "cmd" field value
-            std::string cmd;
-            auto cmdPos = line.find("\"cmd\"");
-            if (cmdPos != std::string::npos) {
-                auto colonPos = line.find(':', cmdPos);
-                auto q1 = line.find('"', colonPos + 1);
-                auto q2 = line.find('"', q1 + 1);
-                if (q1 != std::string::npos && q2 != std::string::npos) {
-                    cmd = line.substr(q1 + 1, q2 - q1 - 1);
-                }
-            }
-
-            if (cmd == "step") {
-                if (executor.getStatus() == grs_executor::ExecutionStatus::WAITING_ACK) {
-                    executor.acknowledgeCommand();
-                }
-                bool hasMore = executor.step();
-                if (executor.getStatus() == grs_executor::ExecutionStatus::ERROR) {
-                    std::cout << "{\"event\":\"error\",\"message\":\"" 
-                              << executor.getErrorMessage() << "\"}" << std::endl;
-                } else if (!hasMore || executor.getStatus() == grs_executor::ExecutionStatus::COMPLETED) {
-                    std::cout << "{\"event\":\"terminated\"}" << std::endl;
-                    break;
-                } else {
-                    std::cout << "{\"event\":\"stopped\",\"line\":" << executor.getCurrentLine() 
-                              << ",\"reason\":\"step\"}" << std::endl;
-                }
-            }
-            else if (cmd == "continue") {
-                if (executor.getStatus() == grs_executor::ExecutionStatus::WAITING_ACK) {
-                    executor.acknowledgeCommand();
-                }
-                executor.run();
-                if (executor.getStatus() == grs_executor::ExecutionStatus::COMPLETED) {
-                    std::cout << "{\"event\":\"terminated\"}" << std::endl;
-                    break;
-                } else if (executor.getStatus() == grs_executor::ExecutionStatus::ERROR) {
-                    std::cout << "{\"event\":\"error\",\"message\":\"" 
-                              << executor.getErrorMessage() << "\"}" << std::endl;
-                } else {
-                    std::cout << "{\"event\":\"stopped\",\"line\":" << executor.getCurrentLine() 
-                              << ",\"reason\":\"breakpoint\"}" << std::endl;
-                }
-            }
-            else if (cmd == "setBreakpoint") {
-                // Extract "line" field
-                auto linePos = line.find("\"line\"");
-                if (linePos != std::string::npos) {
-                    auto colonPos = line.find(':', linePos);
-                    int bpLine = std::stoi(line.substr(colonPos + 1));
-                    executor.addBreakpoint(bpLine);
-                    std::cout << "{\"event\":\"breakpointSet\",\"line\":" << bpLine << "}" << std::endl;
-                }
-            }
-            else if (cmd == "removeBreakpoint") {
-                auto linePos = line.find("\"line\"");
-                if (linePos != std::string::npos) {
-                    auto colonPos = line.find(':', linePos);
-                    int bpLine = std::stoi(line.substr(colonPos + 1));
-                    executor.removeBreaPoint(bpLine);
-                    std::cout << "{\"event\":\"breakpointRemoved\",\"line\":" << bpLine << "}" << std::endl;
-                }
-            }
-            else if (cmd == "clearBreakpoints") {
-                executor.clearBreakPoint();
-                std::cout << "{\"event\":\"breakpointsCleared\"}" << std::endl;
-            }
-            else if (cmd == "getVariables") {
-                std::cout << "{\"event\":\"variables\",\"data\":[";
-                bool first = true;
-                for (const auto& [name, value] : executor.getVariables()) {
-                    if (!first) std::cout << ",";
-                    first = false;
-                    std::cout << "{\"name\":\"" << name 
-                              << "\",\"value\":\"" << common::valueToString(value) << "\"}";
-                }
-                std::cout << "]}" << std::endl;
-            }
-            else if (cmd == "getIO") {
-                if (localIO) {
-                    std::cout << "{\"event\":\"io\",\"inputs\":" << localIO->getInputWord()
-                              << ",\"outputs\":" << localIO->getOutputWord() << "}" << std::endl;
-                } else if (tcpIO) {
-                    std::cout << "{\"event\":\"io\",\"inputs\":" << (int)tcpIO->getInputByte()
-                              << ",\"outputs\":" << (int)tcpIO->getOutputByte() 
-                              << ",\"ready\":" << (tcpIO->isSystemReady() ? "true" : "false")
-                              << "}" << std::endl;
-                }
-            }
-            else if (cmd == "disconnect") {
-                executor.stop();
-                std::cout << "{\"event\":\"terminated\"}" << std::endl;
-                break;
-            }
+        DebugContext ctx{executor, tcpIO, localIO, program, sinks};
+        if (!serveSpec.empty()) {
+            int rc = serveDebug(serveSpec, binaryProtocol, ctx);
+            exitIfTerminated();
+            finishProfile(profiler, program.path, profilePath, foldedPath);
+            finishCoverage(coverage, program.path, coveragePath, coverageAppend);
+            finishSinks(sinks);
+            finishTrace(recorder, tracePath);
+            if (tcpIO) tcpIO->disconnect();
+            return rc;
         }
 
+        std::unique_ptr<grs_debug::DebugProtocol> proto = binaryProtocol
+            ? grs_debug::makeBinaryProtocol(STDIN_FILENO, STDOUT_FILENO)
+            : grs_debug::makeJsonProtocol(STDIN_FILENO, STDOUT_FILENO);
+        runDebugSession(*proto, ctx, true);
+        exitIfTerminated();
+
+        finishProfile(profiler, program.path, profilePath, foldedPath);
+        finishCoverage(coverage, program.path, coveragePath, coverageAppend);
+        finishSinks(sinks);
+        finishTrace(recorder, tracePath);
         if (tcpIO) tcpIO->disconnect();
         return 0;
     }
@@ -428,21 +924,24 @@ int main(int argc, char* argv[]) {
     // ═══════════════════════════════════════════════════════════
     
     // Robot command callback (step mode — run mode overrides this later)
-    executor.setCommandCallback([&tcpIO](const grs_executor::RobotCommand& cmd) {
-        printRobotCommand(cmd);
+    executor.setCommandCallback([&tcpIO, &sinks](const grs_executor::RobotCommand& cmd) {
+        sinks.emit(cmd);
         // Send motion/wait commands to hardware via TCP
         sendTcpCommand(tcpIO, cmd);
+        // One command per step — show the state after the robot executed it
+        waitForHardware(tcpIO);
     });
 
     // Status callback
     // Status callback — mod'a göre farklı davranış
-    executor.setStatusCallback([stepMode](grs_executor::ExecutionStatus status, int line) {
+    executor.setStatusCallback([stepMode, &sinks](grs_executor::ExecutionStatus status, int line) {
         static const char* statusNames[] = {
             "IDLE", "RUNNING", "PAUSED", "WAITING_ACK", "COMPLETED", "ERROR"
         };
         if (stepMode) {
             // Step modda her status'u göster (RUNNING hariç)
             if (status != grs_executor::ExecutionStatus::RUNNING) {
+                sinks.flush();
                 std::cout << "  [STATUS] " << statusNames[static_cast<int>(status)]
                           << " at line " << line << std::endl;
             }
@@ -450,6 +949,7 @@ int main(int argc, char* argv[]) {
             // RUN modda sadece COMPLETED ve ERROR göster
             if (status == grs_executor::ExecutionStatus::COMPLETED ||
                 status == grs_executor::ExecutionStatus::ERROR) {
+                sinks.flush();
                 std::cout << "  [STATUS] " << statusNames[static_cast<int>(status)]
                           << " at line " << line << std::endl;
             }
@@ -458,9 +958,11 @@ int main(int argc, char* argv[]) {
 
     // Helper: print I/O state
     auto printIOState = [&]() {
+        // Commands before the state they led to
+        sinks.flush();
         if (tcpIO) {
-            // Short sleep to let recvLoop pick up the updated state from hardware
-            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            // State as of everything sent so far having run on the robot
+            waitForHardware(tcpIO);
             std::cout << "  [I/O] IN: " << std::bitset<8>(tcpIO->getInputByte())
                       << " | OUT: " << std::bitset<8>(tcpIO->getOutputByte())
                       << " | Ready: " << (tcpIO->isSystemReady() ? "YES" : "NO")
@@ -475,7 +977,7 @@ int main(int argc, char* argv[]) {
     if (stepMode) {
         // ─── Interactive Step Mode ───
         std::cout << "\nCommands: [Enter]=step, r=run, b <line>=breakpoint, "
-                  << "v=variables, io=show I/O, q=quit" << std::endl;
+                  << "v=variables, io=show I/O, e=reload edited file, q=quit" << std::endl;
         if (tcpIO) {
             std::cout << "[TCP] Hardware mode — I/O changes are sent to robot" << std::endl;
             printIOState();
@@ -486,8 +988,10 @@ int main(int argc, char* argv[]) {
         while (executor.getStatus() != grs_executor::ExecutionStatus::COMPLETED &&
                executor.getStatus() != grs_executor::ExecutionStatus::ERROR) {
             
+            sinks.flush();
             std::cout << "[line " << executor.getCurrentLine() << "] > ";
             std::getline(std::cin, input);
+            exitIfTerminated();
 
             if (input.empty()) {
                 // Step
@@ -519,6 +1023,20 @@ int main(int argc, char* argv[]) {
             else if (input == "io") {
                 printIOState();
             }
+            else if (input == "e") {
+                // Edit and continue: re-read the file, keep variables and position
+                grs_debug::DebugRequest reload;
+                reload.type = grs_debug::DebugRequest::Type::RELOAD;
+                reload.live = true;
+                std::string error;
+                bool parsed = false;
+                if (!loadProgram(program, reload, executor, error, parsed)) {
+                    std::cerr << error;
+                } else if (executor.getStatus() != grs_executor::ExecutionStatus::ERROR) {
+                    std::cout << "  Reloaded " << program.path << (parsed ? "" : " (unchanged)")
+                              << ", continuing at line " << executor.getCurrentLine() << std::endl;
+                }
+            }
             else if (input == "q") {
                 // TCP modda çıkışları temizle
                 if (tcpIO) {
@@ -526,7 +1044,6 @@ int main(int argc, char* argv[]) {
                     for (int i = 0; i < 8; i++) {
                         tcpIO->writeDigitalOutput(i, false);
                     }
-                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
                     printIOState();
                 }
                 executor.stop();
@@ -546,27 +1063,43 @@ int main(int argc, char* argv[]) {
             std::cout << std::endl;
         }
 
-        executor.setCommandCallback([&executor, &printIOState, &tcpIO](const grs_executor::RobotCommand& cmd) {
-            printRobotCommand(cmd);
+        // Commands between synchronization points (WAIT, OUTPUT) are batched so
+        // motion sequences like spline point lists leave in a few large writes
+        executor.setCommandCallback([&executor, &printIOState, &tcpIO, &sinks](const grs_executor::RobotCommand& cmd) {
+            sinks.emit(cmd);
 
             // Send motion/wait commands to hardware via TCP
             sendTcpCommand(tcpIO, cmd);
 
-            // WAIT komutu: gerçek bekleme yap
-            if (cmd.type == grs_executor::RobotCommand::Type::WAIT) {
+            // Sync point: the ACK comes from the bridge once the RT loop is done;
+            // motions only wait when the bridge falls kLookahead commands behind
+            if (isSyncPoint(cmd)) waitForHardware(tcpIO);
+            else waitForLookahead(tcpIO);
+
+            // WAIT komutu: donanım yoksa burada bekle (bridge WAIT'i kendi zamanlar)
+            if (cmd.type == grs_executor::RobotCommand::Type::WAIT && !tcpIO) {
                 std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>(cmd.waitTime)));
             }
 
-            // OUTPUT komutu: kısa bekleme + durum göster
+            // OUTPUT komutu: durum göster
             if (cmd.type == grs_executor::RobotCommand::Type::OUTPUT && tcpIO) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
                 printIOState();
             }
 
             executor.acknowledgeCommand();
         });
         
+        if (tcpIO) tcpIO->beginBatch();
         executor.run();
+        if (tcpIO) {
+            tcpIO->endBatch();
+            // Commands can be far ahead of the robot; let it finish them all
+            // before outputs are cleared and the link is closed
+            waitForHardware(tcpIO);
+            std::cerr << "[TCP] " << tcpIO->getSendCallCount() << " command write(s), latency us"
+                      << " send->ack " << tcpIO->getSendToAckHistogram().toJson()
+                      << " ack->done " << tcpIO->getAckToDoneHistogram().toJson() << std::endl;
+        }
 
         // TCP modda çıkışta output'ları temizle
         if (tcpIO) {
@@ -574,17 +1107,20 @@ int main(int argc, char* argv[]) {
             for (int i = 0; i < 8; i++) {
                 tcpIO->writeDigitalOutput(i, false);
             }
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
             printIOState();
         }
     }
 
+    finishSinks(sinks);
     std::cout << "\n=== Execution Complete ===" << std::endl;
     std::cout << "Final Variables:" << std::endl;
     for (const auto& [name, value] : executor.getVariables()) {
         std::cout << "  " << name << " = " << common::valueToString(value) << std::endl;
     }
 
+    finishProfile(profiler, program.path, profilePath, foldedPath);
+    finishCoverage(coverage, program.path, coveragePath, coverageAppend);
+    finishTrace(recorder, tracePath);
     if (tcpIO) tcpIO->disconnect();
 
     return 0;
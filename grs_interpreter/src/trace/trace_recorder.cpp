@@ -0,0 +1,287 @@
+#include "trace/trace.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace grs_trace{
+
+    namespace{
+
+        void putU8(std::string& out, uint8_t v){ out.push_back(static_cast<char>(v)); }
+        void putRaw(std::string& out, const void* p, size_t n){ out.append(static_cast<const char*>(p), n); }
+        void putF64(std::string& out, double v){ putRaw(out, &v, 8); }
+
+        void putVarint(std::string& out, uint64_t v){
+            while(v >= 0x80){
+                out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+                v >>= 7;
+            }
+            out.push_back(static_cast<char>(v));
+        }
+
+        void putStr8(std::string& out, std::string_view s){
+            size_t n = s.size() < 0xFF ? s.size() : 0xFF;
+            putU8(out, static_cast<uint8_t>(n));
+            out.append(s.data(), n);
+        }
+
+        void putStr16(std::string& out, std::string_view s){
+            uint16_t n = s.size() < 0xFFFF ? static_cast<uint16_t>(s.size()) : 0xFFFF;
+            putRaw(out, &n, 2);
+            out.append(s.data(), n);
+        }
+
+        void putValue(std::string& out, const common::ValueType& value){
+            std::visit([&out](const auto& v){
+                using T = std::decay_t<decltype(v)>;
+                if constexpr (std::is_same_v<T, int>){
+                    putU8(out, (uint8_t)ValueTag::INT);
+                    putVarint(out, (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v < 0 ? -1 : 0));
+                }
+                else if constexpr (std::is_same_v<T, double>){ putU8(out, (uint8_t)ValueTag::DOUBLE); putF64(out, v); }
+                else if constexpr (std::is_same_v<T, bool>){ putU8(out, (uint8_t)ValueTag::BOOL); putU8(out, v ? 1 : 0); }
+                else if constexpr (std::is_same_v<T, std::string>){ putU8(out, (uint8_t)ValueTag::STRING); putStr16(out, v); }
+                else if constexpr (std::is_same_v<T, common::Position> || std::is_same_v<T, common::Frame>){
+                    putU8(out, (uint8_t)(std::is_same_v<T, common::Position> ? ValueTag::POSITION : ValueTag::FRAME));
+                    double f[6] = {v.x, v.y, v.z, v.a, v.b, v.c};
+                    putRaw(out, f, sizeof(f));
+                }
+                else if constexpr (std::is_same_v<T, common::Axis>){
+                    putU8(out, (uint8_t)ValueTag::AXIS);
+                    double f[6] = {v.A1, v.A2, v.A3, v.A4, v.A5, v.A6};
+                    putRaw(out, f, sizeof(f));
+                }
+                else putU8(out, (uint8_t)ValueTag::OTHER);
+            }, value);
+        }
+
+        uint64_t nowNs(){
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        constexpr char kMagic[8] = {'G','R','S','T','R','C','0','1'};
+
+    }
+
+    void encodeStatement(std::string& out, size_t pc, int line){
+        putU8(out, (uint8_t)RecordKind::STATEMENT);
+        putVarint(out, pc);
+        putVarint(out, static_cast<uint32_t>(line));
+    }
+
+    void encodeVariable(std::string& out, const std::string& name, const common::ValueType& value){
+        putU8(out, (uint8_t)RecordKind::VARIABLE);
+        putStr8(out, name);
+        putValue(out, value);
+    }
+
+    void encodePosition(std::string& out, const std::string& name, const std::string& field, const common::ValueType& value){
+        putU8(out, (uint8_t)RecordKind::POSITION);
+        putStr8(out, name);
+        putStr8(out, field);
+        putValue(out, value);
+    }
+
+    void encodeInput(std::string& out, uint8_t index, bool value){
+        putU8(out, (uint8_t)RecordKind::INPUT);
+        putU8(out, index);
+        putU8(out, value ? 1 : 0);
+    }
+
+    void encodeCommand(std::string& out, const grs_executor::RobotCommand& cmd){
+        putU8(out, (uint8_t)RecordKind::COMMAND);
+        putU8(out, static_cast<uint8_t>(cmd.type));
+        putVarint(out, static_cast<uint32_t>(cmd.sourceLine));
+        if(cmd.type == grs_executor::RobotCommand::Type::OUTPUT){
+            putU8(out, cmd.ioIndex);
+            putU8(out, cmd.ioValue ? 1 : 0);
+        } else if(cmd.type == grs_executor::RobotCommand::Type::WAIT){
+            putF64(out, cmd.waitTime);
+        } else {
+            putStr8(out, cmd.targetName);
+            size_t count = cmd.params.size() < 255 ? cmd.params.size() : 255;
+            putU8(out, static_cast<uint8_t>(count));
+            for(size_t i = 0; i < count; i++){
+                putStr8(out, cmd.params[i].first);
+                putValue(out, cmd.params[i].second);
+            }
+        }
+    }
+
+    void encodeAck(std::string& out){
+        putU8(out, (uint8_t)RecordKind::ACK);
+    }
+
+    void encodeStatus(std::string& out, grs_executor::ExecutionStatus status, int line, const std::string& error){
+        putU8(out, (uint8_t)RecordKind::STATUS);
+        putU8(out, static_cast<uint8_t>(status));
+        putVarint(out, static_cast<uint32_t>(line));
+        if(status == grs_executor::ExecutionStatus::ERROR) putStr16(out, error);
+    }
+
+    uint64_t hashSource(std::string_view source){
+        uint64_t h = 1469598103934665603ull;
+        for(char c : source){
+            h ^= static_cast<uint8_t>(c);
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    TraceRecorder::~TraceRecorder(){ close(); }
+
+    bool TraceRecorder::open(const std::string& path, const std::string& programPath, std::string_view source,
+                             size_t ringBytes, std::string& error){
+        close();
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if(fd_ < 0){
+            error = "cannot create " + path + ": " + std::strerror(errno);
+            return false;
+        }
+
+        size_t capacity = 4096;
+        while(capacity < ringBytes) capacity <<= 1;
+        ring_.reset(new char[capacity]);
+        // Touch it now rather than on the first records
+        std::memset(ring_.get(), 0, capacity);
+        mask_ = capacity - 1;
+        head_ = 0;
+        tail_ = 0;
+        scratch_.clear();
+        scratch_.reserve(4096);
+        records_ = droppedPending_ = droppedTotal_ = 0;
+
+        uint64_t startUnix = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        std::string header(kMagic, sizeof(kMagic));
+        putRaw(header, &startUnix, 8);
+        uint64_t hash = hashSource(source);
+        putRaw(header, &hash, 8);
+        putStr16(header, programPath);
+        if(::write(fd_, header.data(), header.size()) != static_cast<ssize_t>(header.size())){
+            error = "cannot write " + path + ": " + std::strerror(errno);
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+
+        lastNs_ = nowNs();
+        stop_ = false;
+        writer_ = std::thread(&TraceRecorder::writerLoop, this);
+        return true;
+    }
+
+    void TraceRecorder::close(){
+        if(fd_ < 0) return;
+        stop_ = true;
+        wake_.notify_one();
+        writer_.join();
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+    std::string& TraceRecorder::begin(){
+        scratch_.clear();
+        uint64_t now = nowNs();
+        if(droppedPending_ > 0){
+            putVarint(scratch_, now - lastNs_);
+            putU8(scratch_, (uint8_t)RecordKind::DROPPED);
+            putVarint(scratch_, droppedPending_);
+            putVarint(scratch_, 0);
+        } else {
+            putVarint(scratch_, now - lastNs_);
+        }
+        pendingNs_ = now;
+        return scratch_;
+    }
+
+    void TraceRecorder::commit(){
+        if(fd_ < 0) return;
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        uint64_t used = head - tail_.load(std::memory_order_acquire);
+        size_t n = scratch_.size();
+        size_t capacity = mask_ + 1;
+        if(n > capacity - used){
+            droppedPending_++;
+            droppedTotal_++;
+            wake_.notify_one();
+            return;
+        }
+        size_t pos = head & mask_;
+        size_t first = n < capacity - pos ? n : capacity - pos;
+        std::memcpy(ring_.get() + pos, scratch_.data(), first);
+        std::memcpy(ring_.get(), scratch_.data() + first, n - first);
+        head_.store(head + n, std::memory_order_release);
+
+        records_ += droppedPending_ > 0 ? 2 : 1;
+        droppedPending_ = 0;
+        lastNs_ = pendingNs_;
+        // The writer polls anyway; only hurry it when the ring fills up
+        if(used + n > capacity / 2) wake_.notify_one();
+    }
+
+    void TraceRecorder::drain(){
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        uint64_t head = head_.load(std::memory_order_acquire);
+        size_t capacity = mask_ + 1;
+        while(tail < head){
+            size_t pos = tail & mask_;
+            size_t n = head - tail < capacity - pos ? head - tail : capacity - pos;
+            ssize_t written = ::write(fd_, ring_.get() + pos, n);
+            if(written < 0 && errno == EINTR) continue;
+            // A full disk loses the rest of the trace rather than stalling the run
+            tail += written > 0 ? static_cast<uint64_t>(written) : n;
+            tail_.store(tail, std::memory_order_release);
+        }
+    }
+
+    void TraceRecorder::writerLoop(){
+        std::unique_lock<std::mutex> lock(mutex_);
+        while(!stop_){
+            wake_.wait_for(lock, std::chrono::milliseconds(10));
+            drain();
+        }
+        drain();
+    }
+
+    void TraceRecorder::statementStarted(size_t pc, int line){
+        encodeStatement(begin(), pc, line);
+        commit();
+    }
+
+    void TraceRecorder::variableWritten(const std::string& name, const common::ValueType& value){
+        encodeVariable(begin(), name, value);
+        commit();
+    }
+
+    void TraceRecorder::positionWritten(const std::string& name, const std::string& field, const common::ValueType& value){
+        encodePosition(begin(), name, field, value);
+        commit();
+    }
+
+    void TraceRecorder::inputRead(uint8_t index, bool value){
+        encodeInput(begin(), index, value);
+        commit();
+    }
+
+    void TraceRecorder::commandEmitted(const grs_executor::RobotCommand& cmd){
+        encodeCommand(begin(), cmd);
+        commit();
+    }
+
+    void TraceRecorder::commandAcknowledged(){
+        encodeAck(begin());
+        commit();
+    }
+
+    void TraceRecorder::statusChanged(grs_executor::ExecutionStatus status, int line, const std::string& error){
+        if(status != grs_executor::ExecutionStatus::COMPLETED && status != grs_executor::ExecutionStatus::ERROR) return;
+        encodeStatus(begin(), status, line, error);
+        commit();
+    }
+
+}
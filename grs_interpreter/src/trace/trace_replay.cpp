@@ -0,0 +1,363 @@
+#include "trace/trace.hpp"
+
+#include <cinttypes>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace grs_trace{
+
+    namespace{
+
+        // Bounds-checked cursor; any read past the end clears ok
+        struct Cursor{
+            const char* p;
+            const char* end;
+            bool ok = true;
+
+            bool have(size_t n){
+                if(!ok || static_cast<size_t>(end - p) < n){ ok = false; return false; }
+                return true;
+            }
+            uint8_t u8(){ return have(1) ? static_cast<uint8_t>(*p++) : 0; }
+            void raw(void* dst, size_t n){
+                if(!have(n)){ std::memset(dst, 0, n); return; }
+                std::memcpy(dst, p, n);
+                p += n;
+            }
+            double f64(){ double v; raw(&v, 8); return v; }
+            uint64_t varint(){
+                uint64_t v = 0;
+                for(int shift = 0; shift < 64; shift += 7){
+                    uint8_t b = u8();
+                    if(!ok) return 0;
+                    v |= static_cast<uint64_t>(b & 0x7F) << shift;
+                    if(!(b & 0x80)) return v;
+                }
+                ok = false;
+                return 0;
+            }
+            std::string str(size_t n){
+                if(!have(n)) return {};
+                std::string s(p, n);
+                p += n;
+                return s;
+            }
+            std::string str8(){ return str(u8()); }
+            std::string str16(){ uint16_t n; raw(&n, 2); return str(n); }
+
+            common::ValueType value(){
+                ValueTag tag = static_cast<ValueTag>(u8());
+                double f[6];
+                switch(tag){
+                    case ValueTag::INT:{
+                        uint64_t z = varint();
+                        return static_cast<int>(static_cast<int64_t>(z >> 1) ^ -static_cast<int64_t>(z & 1));
+                    }
+                    case ValueTag::DOUBLE: return f64();
+                    case ValueTag::BOOL: return u8() != 0;
+                    case ValueTag::STRING: return str16();
+                    case ValueTag::POSITION:
+                        raw(f, sizeof(f));
+                        return common::Position{f[0], f[1], f[2], f[3], f[4], f[5]};
+                    case ValueTag::FRAME:
+                        raw(f, sizeof(f));
+                        return common::Frame{f[0], f[1], f[2], f[3], f[4], f[5]};
+                    case ValueTag::AXIS:
+                        raw(f, sizeof(f));
+                        return common::Axis{f[0], f[1], f[2], f[3], f[4], f[5]};
+                    case ValueTag::OTHER: return std::string("<expr>");
+                }
+                ok = false;
+                return 0;
+            }
+        };
+
+        // kind + payload at c into event; raw is the consumed bytes
+        bool decodeRecord(Cursor& c, TraceEvent& event){
+            const char* start = c.p;
+            event.kind = static_cast<RecordKind>(c.u8());
+            switch(event.kind){
+                case RecordKind::STATEMENT:
+                    event.pc = c.varint();
+                    event.line = static_cast<int>(c.varint());
+                    break;
+                case RecordKind::VARIABLE:
+                    event.name = c.str8();
+                    event.data = c.value();
+                    break;
+                case RecordKind::POSITION:
+                    event.name = c.str8();
+                    event.field = c.str8();
+                    event.data = c.value();
+                    break;
+                case RecordKind::INPUT:
+                    event.index = c.u8();
+                    event.value = c.u8() != 0;
+                    break;
+                case RecordKind::COMMAND:{
+                    auto& cmd = event.command;
+                    uint8_t type = c.u8();
+                    if(type > static_cast<uint8_t>(grs_executor::RobotCommand::Type::UNKNOWN)) return false;
+                    cmd.type = static_cast<grs_executor::RobotCommand::Type>(type);
+                    cmd.sourceLine = static_cast<int>(c.varint());
+                    event.line = cmd.sourceLine;
+                    if(cmd.type == grs_executor::RobotCommand::Type::OUTPUT){
+                        cmd.ioIndex = c.u8();
+                        cmd.ioValue = c.u8() != 0;
+                    } else if(cmd.type == grs_executor::RobotCommand::Type::WAIT){
+                        cmd.waitTime = c.f64();
+                    } else {
+                        cmd.targetName = c.str8();
+                        uint8_t count = c.u8();
+                        for(uint8_t i = 0; i < count && c.ok; i++){
+                            std::string key = c.str8();
+                            cmd.params.emplace_back(std::move(key), c.value());
+                        }
+                    }
+                    break;
+                }
+                case RecordKind::ACK:
+                    break;
+                case RecordKind::STATUS:{
+                    uint8_t status = c.u8();
+                    if(status > static_cast<uint8_t>(grs_executor::ExecutionStatus::ERROR)) return false;
+                    event.status = static_cast<grs_executor::ExecutionStatus>(status);
+                    event.line = static_cast<int>(c.varint());
+                    if(event.status == grs_executor::ExecutionStatus::ERROR) event.text = c.str16();
+                    break;
+                }
+                case RecordKind::DROPPED:
+                    event.count = c.varint();
+                    break;
+                default:
+                    return false;
+            }
+            if(!c.ok) return false;
+            event.raw.assign(start, c.p);
+            return true;
+        }
+
+        const char* commandTypeName(grs_executor::RobotCommand::Type type){
+            static const char* names[] = {
+                "PTP", "PTP_REL", "LIN", "LIN_REL", "CIRC", "CIRC_REL",
+                "SPLINE", "SPLINE_REL", "WAIT", "OUTPUT", "UNKNOWN"
+            };
+            return names[static_cast<int>(type)];
+        }
+
+        TraceEvent decodeLive(const std::string& raw){
+            TraceEvent event;
+            Cursor c{raw.data(), raw.data() + raw.size()};
+            decodeRecord(c, event);
+            return event;
+        }
+
+        bool compared(RecordKind kind){
+            return kind != RecordKind::INPUT && kind != RecordKind::ACK;
+        }
+
+    }
+
+    bool readTrace(const std::string& path, Trace& trace, std::string& error){
+        std::ifstream file(path, std::ios::binary);
+        if(!file){
+            error = "cannot open " + path;
+            return false;
+        }
+        std::ostringstream buffer;
+        buffer << file.rdbuf();
+        const std::string data = buffer.str();
+
+        Cursor c{data.data(), data.data() + data.size()};
+        if(c.str(8) != "GRSTRC01"){
+            error = path + " is not a grs trace";
+            return false;
+        }
+        c.raw(&trace.startUnixNs, 8);
+        c.raw(&trace.sourceHash, 8);
+        trace.programPath = c.str16();
+        if(!c.ok){
+            error = path + ": truncated header";
+            return false;
+        }
+
+        uint64_t ns = 0;
+        trace.events.clear();
+        trace.dropped = 0;
+        trace.truncated = false;
+        while(c.p < c.end){
+            TraceEvent event;
+            ns += c.varint();
+            if(!c.ok || !decodeRecord(c, event)){
+                // A run that was killed leaves a partial record at the end
+                trace.truncated = true;
+                break;
+            }
+            event.ns = ns;
+            if(event.kind == RecordKind::DROPPED) trace.dropped += event.count;
+            trace.events.push_back(std::move(event));
+        }
+        return true;
+    }
+
+    std::string describe(const TraceEvent& event){
+        std::string out;
+        switch(event.kind){
+            case RecordKind::STATEMENT:
+                out = "STMT pc=" + std::to_string(event.pc) + " line " + std::to_string(event.line);
+                break;
+            case RecordKind::VARIABLE:
+                out = "VAR " + event.name + " = " + common::valueToString(event.data);
+                break;
+            case RecordKind::POSITION:
+                out = "POS " + event.name + "." + event.field + " = " + common::valueToString(event.data);
+                break;
+            case RecordKind::INPUT:
+                out = "IN $IN[" + std::to_string(event.index + 1) + "] = " + (event.value ? "TRUE" : "FALSE");
+                break;
+            case RecordKind::COMMAND:{
+                const auto& cmd = event.command;
+                out = std::string("CMD ") + commandTypeName(cmd.type);
+                if(cmd.type == grs_executor::RobotCommand::Type::OUTPUT){
+                    out += " $OUT[" + std::to_string(cmd.ioIndex) + "] = " + (cmd.ioValue ? "TRUE" : "FALSE");
+                } else if(cmd.type == grs_executor::RobotCommand::Type::WAIT){
+                    out += " " + common::valueToString(cmd.waitTime) + " ms";
+                } else {
+                    out += " " + cmd.targetName;
+                    for(const auto& [key, value] : cmd.params) out += " " + key + "=" + common::valueToString(value);
+                }
+                out += " (line " + std::to_string(cmd.sourceLine) + ")";
+                break;
+            }
+            case RecordKind::ACK:
+                out = "ACK";
+                break;
+            case RecordKind::STATUS:
+                out = event.status == grs_executor::ExecutionStatus::ERROR
+                    ? "ERROR line " + std::to_string(event.line) + ": " + event.text
+                    : "COMPLETED";
+                break;
+            case RecordKind::DROPPED:
+                out = "DROPPED " + std::to_string(event.count) + " records";
+                break;
+        }
+        return out;
+    }
+
+    void printTrace(const Trace& trace, std::FILE* out){
+        std::fprintf(out, "trace of %s, source hash %016" PRIx64 ", %zu records\n",
+                     trace.programPath.c_str(), trace.sourceHash, trace.events.size());
+        for(const auto& event : trace.events){
+            std::fprintf(out, "%12.3f  %s\n", event.ns / 1e6, describe(event).c_str());
+        }
+        if(trace.dropped > 0) std::fprintf(out, "%" PRIu64 " records were dropped while recording\n", trace.dropped);
+        if(trace.truncated) std::fprintf(out, "the trace ends inside a record\n");
+    }
+
+    ReplayIOProvider::ReplayIOProvider(const Trace& trace){
+        for(const auto& event : trace.events){
+            if(event.kind == RecordKind::INPUT) inputs_.push_back(&event);
+        }
+    }
+
+    bool ReplayIOProvider::readDigitalInput(uint8_t index){
+        if(next_ >= inputs_.size()){
+            if(divergence_.empty()){
+                divergence_ = "$IN[" + std::to_string(index + 1) + "] read after the "
+                            + std::to_string(inputs_.size()) + " recorded input reads";
+            }
+            return false;
+        }
+        const TraceEvent& recorded = *inputs_[next_++];
+        if(recorded.index != index && divergence_.empty()){
+            divergence_ = "input read " + std::to_string(next_) + " is $IN[" + std::to_string(index + 1)
+                        + "], recorded $IN[" + std::to_string(recorded.index + 1) + "]";
+        }
+        return recorded.value;
+    }
+
+    void ReplayIOProvider::writeDigitalOutput(uint8_t index, bool value){
+        if(index >= 32) return;
+        if(value) outputs_ |= (1u << index);
+        else outputs_ &= ~(1u << index);
+    }
+
+    bool ReplayIOProvider::readDigitalOutput(uint8_t index){
+        if(index >= 32) return false;
+        return (outputs_ >> index) & 1;
+    }
+
+    TraceVerifier::TraceVerifier(const Trace& trace) : trace_(trace){}
+
+    bool TraceVerifier::complete() const{
+        if(gap_) return true;
+        for(size_t i = next_; i < trace_.events.size(); i++){
+            RecordKind kind = trace_.events[i].kind;
+            if(kind == RecordKind::DROPPED) return true;
+            if(compared(kind)) return false;
+        }
+        return true;
+    }
+
+    void TraceVerifier::skipUncompared(){
+        const auto& events = trace_.events;
+        while(next_ < events.size() && !compared(events[next_].kind)) next_++;
+        if(next_ < events.size() && events[next_].kind == RecordKind::DROPPED) gap_ = true;
+    }
+
+    void TraceVerifier::check(){
+        if(diverged() || gap_) return;
+        skipUncompared();
+        if(gap_) return;
+        if(next_ >= trace_.events.size()){
+            // Without a final status the recording stopped before the program
+            // (quit in step mode, killed), so there is nothing more to compare
+            bool finished = !trace_.truncated && !trace_.events.empty()
+                          && trace_.events.back().kind == RecordKind::STATUS;
+            if(finished) divergence_ = "past the end of the trace: " + describe(decodeLive(live_));
+            else gap_ = true;
+            return;
+        }
+        const TraceEvent& recorded = trace_.events[next_];
+        if(recorded.raw != live_){
+            divergence_ = "record " + std::to_string(next_ + 1) + ": expected " + describe(recorded)
+                        + ", got " + describe(decodeLive(live_));
+            return;
+        }
+        next_++;
+        matched_++;
+    }
+
+    void TraceVerifier::statementStarted(size_t pc, int line){
+        live_.clear();
+        encodeStatement(live_, pc, line);
+        check();
+    }
+
+    void TraceVerifier::variableWritten(const std::string& name, const common::ValueType& value){
+        live_.clear();
+        encodeVariable(live_, name, value);
+        check();
+    }
+
+    void TraceVerifier::positionWritten(const std::string& name, const std::string& field, const common::ValueType& value){
+        live_.clear();
+        encodePosition(live_, name, field, value);
+        check();
+    }
+
+    void TraceVerifier::commandEmitted(const grs_executor::RobotCommand& cmd){
+        live_.clear();
+        encodeCommand(live_, cmd);
+        check();
+    }
+
+    void TraceVerifier::statusChanged(grs_executor::ExecutionStatus status, int line, const std::string& error){
+        if(status != grs_executor::ExecutionStatus::COMPLETED && status != grs_executor::ExecutionStatus::ERROR) return;
+        live_.clear();
+        encodeStatus(live_, status, line, error);
+        check();
+    }
+
+}